@@ -0,0 +1,580 @@
+#include "BlockEncoder.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace BlockEncoder
+{
+	using TextureContainer::Texture;
+	using TextureContainer::TextureFormat;
+
+	typedef uint8_t Block[16][4];
+
+	// Interpolation weights out of 64 for the 4 bit indices of BC7.
+	static const uint32_t Weights4[16] = {
+		0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+	};
+
+	// Share of the second endpoint in the four BC1 palette entries.
+	static const float BC1Weights[4] = {0.0f, 1.0f, 1.0f / 3, 2.0f / 3};
+
+	static void LoadBlock(
+		const uint8_t* image,
+		uint32_t width,
+		uint32_t height,
+		uint32_t blockX,
+		uint32_t blockY,
+		Block block)
+	{
+		for (uint32_t y = 0; y < 4; ++y) {
+			uint32_t row = std::min(blockY * 4 + y, height - 1);
+			const uint8_t* pixels = image + (size_t)row * width * 4;
+
+			for (uint32_t x = 0; x < 4; ++x) {
+				uint32_t column =
+					std::min(blockX * 4 + x, width - 1);
+
+				memcpy(
+					block[y * 4 + x],
+					pixels + column * 4,
+					4);
+			}
+		}
+	}
+
+	// Ends of the principal axis of the block colors, the axis through
+	// their mean along which they spread the most.
+	static void FindEndpoints(
+		const Block block,
+		uint32_t channels,
+		float low[4],
+		float high[4])
+	{
+		float mean[4] = {};
+
+		for (uint32_t i = 0; i < 16; ++i) {
+			for (uint32_t c = 0; c < channels; ++c) {
+				mean[c] += block[i][c] / 16.0f;
+			}
+		}
+
+		float covariance[4][4] = {};
+
+		for (uint32_t i = 0; i < 16; ++i) {
+			for (uint32_t a = 0; a < channels; ++a) {
+				for (uint32_t b = 0; b < channels; ++b) {
+					covariance[a][b] +=
+						(block[i][a] - mean[a]) *
+						(block[i][b] - mean[b]);
+				}
+			}
+		}
+
+		// Power iteration, converges to the largest eigenvector.
+		float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+		for (uint32_t iteration = 0; iteration < 8; ++iteration) {
+			float next[4] = {};
+			float length = 0;
+
+			for (uint32_t a = 0; a < channels; ++a) {
+				for (uint32_t b = 0; b < channels; ++b) {
+					next[a] += covariance[a][b] * axis[b];
+				}
+
+				length = std::max(length, std::abs(next[a]));
+			}
+
+			if (length < 1e-6f) {
+				break;
+			}
+
+			for (uint32_t c = 0; c < channels; ++c) {
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float lengthSquared = 0;
+
+		for (uint32_t c = 0; c < channels; ++c) {
+			lengthSquared += axis[c] * axis[c];
+		}
+
+		float minimum = 0;
+		float maximum = 0;
+
+		for (uint32_t i = 0; i < 16; ++i) {
+			float t = 0;
+
+			for (uint32_t c = 0; c < channels; ++c) {
+				t += (block[i][c] - mean[c]) * axis[c];
+			}
+
+			minimum = std::min(minimum, t / lengthSquared);
+			maximum = std::max(maximum, t / lengthSquared);
+		}
+
+		for (uint32_t c = 0; c < 4; ++c) {
+			low[c] = mean[c] + axis[c] * minimum;
+			high[c] = mean[c] + axis[c] * maximum;
+		}
+	}
+
+	// Least squares endpoints for the chosen indices, weights[i] being
+	// the share of high in pixel i. Fails when all weights are equal.
+	static bool RefineEndpoints(
+		const Block block,
+		uint32_t channels,
+		const float weights[16],
+		float low[4],
+		float high[4])
+	{
+		float lowLow = 0;
+		float lowHigh = 0;
+		float highHigh = 0;
+		float lowSum[4] = {};
+		float highSum[4] = {};
+
+		for (uint32_t i = 0; i < 16; ++i) {
+			float h = weights[i];
+			float l = 1.0f - h;
+
+			lowLow += l * l;
+			lowHigh += l * h;
+			highHigh += h * h;
+
+			for (uint32_t c = 0; c < channels; ++c) {
+				lowSum[c] += l * block[i][c];
+				highSum[c] += h * block[i][c];
+			}
+		}
+
+		float determinant = lowLow * highHigh - lowHigh * lowHigh;
+
+		if (std::abs(determinant) < 1e-6f) {
+			return false;
+		}
+
+		for (uint32_t c = 0; c < channels; ++c) {
+			low[c] = std::clamp(
+				(highHigh * lowSum[c] - lowHigh * highSum[c]) /
+					determinant,
+				0.0f,
+				255.0f);
+			high[c] = std::clamp(
+				(lowLow * highSum[c] - lowHigh * lowSum[c]) /
+					determinant,
+				0.0f,
+				255.0f);
+		}
+
+		return true;
+	}
+
+	static uint32_t Distance(const uint8_t* a, const int32_t* b)
+	{
+		uint32_t distance = 0;
+
+		for (uint32_t c = 0; c < 4; ++c) {
+			int32_t difference = a[c] - b[c];
+			distance += difference * difference;
+		}
+
+		return distance;
+	}
+
+	// Nearest palette entry for every pixel, returns the summed error.
+	static uint32_t PickIndices(
+		const Block block,
+		const int32_t palette[][4],
+		uint32_t paletteSize,
+		uint8_t indices[16])
+	{
+		uint32_t error = 0;
+
+		for (uint32_t i = 0; i < 16; ++i) {
+			uint32_t best = Distance(block[i], palette[0]);
+			indices[i] = 0;
+
+			for (uint32_t p = 1; p < paletteSize; ++p) {
+				uint32_t distance =
+					Distance(block[i], palette[p]);
+
+				if (distance < best) {
+					best = distance;
+					indices[i] = p;
+				}
+			}
+
+			error += best;
+		}
+
+		return error;
+	}
+
+	static uint16_t PackRGB565(const float color[4])
+	{
+		uint32_t r = std::lround(std::clamp(color[0], 0.0f, 255.0f) *
+			31 / 255);
+		uint32_t g = std::lround(std::clamp(color[1], 0.0f, 255.0f) *
+			63 / 255);
+		uint32_t b = std::lround(std::clamp(color[2], 0.0f, 255.0f) *
+			31 / 255);
+
+		return (r << 11) | (g << 5) | b;
+	}
+
+	static void UnpackRGB565(uint16_t packed, int32_t color[4])
+	{
+		uint32_t r = packed >> 11;
+		uint32_t g = (packed >> 5) & 0x3F;
+		uint32_t b = packed & 0x1F;
+
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+		color[3] = 255;
+	}
+
+	struct BC1Candidate
+	{
+		uint16_t Color0;
+		uint16_t Color1;
+		uint8_t Indices[16];
+		uint32_t Error;
+	};
+
+	// Four color mode needs Color0 > Color1, equal colors fall back to
+	// the three color mode with every pixel on Color0.
+	static BC1Candidate FitBC1(
+		const Block block,
+		const float low[4],
+		const float high[4])
+	{
+		BC1Candidate candidate;
+		candidate.Color0 = PackRGB565(high);
+		candidate.Color1 = PackRGB565(low);
+
+		if (candidate.Color0 < candidate.Color1) {
+			std::swap(candidate.Color0, candidate.Color1);
+		}
+
+		int32_t palette[4][4];
+		UnpackRGB565(candidate.Color0, palette[0]);
+		UnpackRGB565(candidate.Color1, palette[1]);
+
+		for (uint32_t c = 0; c < 3; ++c) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		palette[2][3] = 255;
+		palette[3][3] = 255;
+
+		uint32_t paletteSize =
+			candidate.Color0 == candidate.Color1 ? 1 : 4;
+
+		candidate.Error = PickIndices(
+			block,
+			palette,
+			paletteSize,
+			candidate.Indices);
+
+		return candidate;
+	}
+
+	static void EncodeBC1Block(Block block, uint8_t* out)
+	{
+		// Alpha is dropped, leaving it out of the fit.
+		for (uint32_t i = 0; i < 16; ++i) {
+			block[i][3] = 255;
+		}
+
+		float low[4];
+		float high[4];
+		FindEndpoints(block, 3, low, high);
+
+		BC1Candidate best = FitBC1(block, low, high);
+
+		for (uint32_t iteration = 0; iteration < 2; ++iteration) {
+			float weights[16];
+
+			for (uint32_t i = 0; i < 16; ++i) {
+				weights[i] = BC1Weights[best.Indices[i]];
+			}
+
+			// The fit maps Color0 to high and Color1 to low.
+			int32_t color[4];
+			UnpackRGB565(best.Color0, color);
+			std::copy(color, color + 4, high);
+			UnpackRGB565(best.Color1, color);
+			std::copy(color, color + 4, low);
+
+			if (!RefineEndpoints(block, 3, weights, high, low)) {
+				break;
+			}
+
+			BC1Candidate candidate = FitBC1(block, low, high);
+
+			if (candidate.Error >= best.Error) {
+				break;
+			}
+
+			best = candidate;
+		}
+
+		uint32_t indexBits = 0;
+
+		for (uint32_t i = 0; i < 16; ++i) {
+			indexBits |= best.Indices[i] << (i * 2);
+		}
+
+		memcpy(out, &best.Color0, 2);
+		memcpy(out + 2, &best.Color1, 2);
+		memcpy(out + 4, &indexBits, 4);
+	}
+
+	struct BC7Candidate
+	{
+		// 7 bit colors, the endpoint is the color followed by its
+		// p-bit.
+		uint8_t Color[2][4];
+		uint8_t PBit[2];
+		uint8_t Indices[16];
+		uint32_t Error;
+	};
+
+	static void QuantizeMode6(
+		const float value[4],
+		uint8_t color[4],
+		uint8_t& pBit)
+	{
+		float bestError = INFINITY;
+
+		for (uint8_t p = 0; p < 2; ++p) {
+			uint8_t quantized[4];
+			float error = 0;
+
+			for (uint32_t c = 0; c < 4; ++c) {
+				quantized[c] = std::clamp<long>(
+					std::lround((value[c] - p) / 2),
+					0,
+					127);
+
+				float difference =
+					(quantized[c] << 1 | p) - value[c];
+				error += difference * difference;
+			}
+
+			if (error < bestError) {
+				bestError = error;
+				memcpy(color, quantized, 4);
+				pBit = p;
+			}
+		}
+	}
+
+	static BC7Candidate FitBC7(
+		const Block block,
+		const float low[4],
+		const float high[4])
+	{
+		BC7Candidate candidate;
+		QuantizeMode6(low, candidate.Color[0], candidate.PBit[0]);
+		QuantizeMode6(high, candidate.Color[1], candidate.PBit[1]);
+
+		int32_t palette[16][4];
+
+		for (uint32_t c = 0; c < 4; ++c) {
+			int32_t first =
+				candidate.Color[0][c] << 1 | candidate.PBit[0];
+			int32_t second =
+				candidate.Color[1][c] << 1 | candidate.PBit[1];
+
+			for (uint32_t i = 0; i < 16; ++i) {
+				palette[i][c] = ((64 - Weights4[i]) * first +
+					Weights4[i] * second + 32) >> 6;
+			}
+		}
+
+		candidate.Error = PickIndices(
+			block,
+			palette,
+			16,
+			candidate.Indices);
+
+		return candidate;
+	}
+
+	static void WriteBits(
+		uint8_t* out,
+		uint32_t& offset,
+		uint32_t value,
+		uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i, ++offset) {
+			out[offset / 8] |= ((value >> i) & 1) << (offset % 8);
+		}
+	}
+
+	static void EncodeBC7Block(const Block block, uint8_t* out)
+	{
+		float low[4];
+		float high[4];
+		FindEndpoints(block, 4, low, high);
+
+		BC7Candidate best = FitBC7(block, low, high);
+
+		for (uint32_t iteration = 0; iteration < 2; ++iteration) {
+			float weights[16];
+
+			for (uint32_t i = 0; i < 16; ++i) {
+				weights[i] = Weights4[best.Indices[i]] / 64.0f;
+			}
+
+			if (!RefineEndpoints(block, 4, weights, low, high)) {
+				break;
+			}
+
+			BC7Candidate candidate = FitBC7(block, low, high);
+
+			if (candidate.Error >= best.Error) {
+				break;
+			}
+
+			best = candidate;
+		}
+
+		// The first index is stored without its top bit, so it has
+		// to be below 8. Swapping the endpoints mirrors the indices.
+		if (best.Indices[0] & 8) {
+			std::swap(best.Color[0], best.Color[1]);
+			std::swap(best.PBit[0], best.PBit[1]);
+
+			for (uint32_t i = 0; i < 16; ++i) {
+				best.Indices[i] = 15 - best.Indices[i];
+			}
+		}
+
+		memset(out, 0, 16);
+		uint32_t offset = 0;
+
+		WriteBits(out, offset, 1 << 6, 7);
+
+		for (uint32_t c = 0; c < 4; ++c) {
+			WriteBits(out, offset, best.Color[0][c], 7);
+			WriteBits(out, offset, best.Color[1][c], 7);
+		}
+
+		WriteBits(out, offset, best.PBit[0], 1);
+		WriteBits(out, offset, best.PBit[1], 1);
+		WriteBits(out, offset, best.Indices[0], 3);
+
+		for (uint32_t i = 1; i < 16; ++i) {
+			WriteBits(out, offset, best.Indices[i], 4);
+		}
+	}
+
+	template<typename EncodeBlock>
+	static std::vector<uint8_t> Encode(
+		const uint8_t* image,
+		uint32_t width,
+		uint32_t height,
+		uint32_t blockBytes,
+		EncodeBlock encodeBlock)
+	{
+		uint32_t blocksX = (width + 3) / 4;
+		uint32_t blocksY = (height + 3) / 4;
+
+		std::vector<uint8_t> out(
+			(size_t)blocksX * blocksY * blockBytes);
+		uint8_t* block = out.data();
+
+		for (uint32_t y = 0; y < blocksY; ++y) {
+			for (uint32_t x = 0; x < blocksX; ++x) {
+				Block pixels;
+				LoadBlock(image, width, height, x, y, pixels);
+
+				encodeBlock(pixels, block);
+				block += blockBytes;
+			}
+		}
+
+		return out;
+	}
+
+	std::vector<uint8_t> EncodeBC1(
+		const uint8_t* image,
+		uint32_t width,
+		uint32_t height)
+	{
+		return Encode(image, width, height, 8, EncodeBC1Block);
+	}
+
+	std::vector<uint8_t> EncodeBC7(
+		const uint8_t* image,
+		uint32_t width,
+		uint32_t height)
+	{
+		return Encode(image, width, height, 16, EncodeBC7Block);
+	}
+
+	Texture Compress(const Texture& texture, TextureFormat format)
+	{
+		if (texture.Format != TextureFormat::RGBA8_SRGB) {
+			throw std::runtime_error(
+				"Only RGBA8 textures can be compressed.");
+		}
+
+		if (format != TextureFormat::BC1_SRGB &&
+			format != TextureFormat::BC7_SRGB)
+		{
+			throw std::runtime_error("No encoder for this format.");
+		}
+
+		Texture compressed = texture;
+		compressed.Format = format;
+		compressed.Data.clear();
+
+		// Same order as the source, layer after layer with all levels.
+		for (uint32_t i = 0; i < texture.LayerCount * texture.MipLevels;
+			++i)
+		{
+			uint32_t layer = i / texture.MipLevels;
+			uint32_t level = i % texture.MipLevels;
+
+			uint64_t offset = TextureContainer::GetLevelOffset(
+				texture,
+				layer,
+				level);
+			const uint8_t* image = texture.Data.data() + offset;
+			uint32_t width = std::max(texture.Width >> level, 1u);
+			uint32_t height = std::max(texture.Height >> level, 1u);
+
+			std::vector<uint8_t> blocks =
+				format == TextureFormat::BC1_SRGB ?
+				EncodeBC1(image, width, height) :
+				EncodeBC7(image, width, height);
+
+			compressed.Data.insert(
+				compressed.Data.end(),
+				blocks.begin(),
+				blocks.end());
+		}
+
+		return compressed;
+	}
+
+	bool HasAlpha(const std::vector<uint8_t>& pixels)
+	{
+		for (size_t i = 3; i < pixels.size(); i += 4) {
+			if (pixels[i] != 255) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef _BLOCK_ENCODER_H
+#define _BLOCK_ENCODER_H
+
+#include <vector>
+#include <cstdint>
+
+#include "../Utils/TextureContainer.h"
+
+// CPU encoders for block compressed textures. Images are RGBA8 rows,
+// blocks past the right or bottom edge repeat the last column or row.
+namespace BlockEncoder
+{
+	// 4 bits per pixel, for opaque images. Alpha is dropped.
+	std::vector<uint8_t> EncodeBC1(
+		const uint8_t* image,
+		uint32_t width,
+		uint32_t height);
+
+	// 8 bits per pixel with alpha, every block in mode 6.
+	std::vector<uint8_t> EncodeBC7(
+		const uint8_t* image,
+		uint32_t width,
+		uint32_t height);
+
+	// Encodes every level of every layer of an RGBA8 texture. format is
+	// BC1_SRGB or BC7_SRGB.
+	TextureContainer::Texture Compress(
+		const TextureContainer::Texture& texture,
+		TextureContainer::TextureFormat format);
+
+	// Whether any of the RGBA8 pixels is not fully opaque.
+	bool HasAlpha(const std::vector<uint8_t>& pixels);
+}
+
+#endif
@@ -0,0 +1,306 @@
+#include "Cooker.h"
+
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "../Logger/logger.h"
+#include "../Utils/loader.h"
+#include "../Utils/MeshCache.h"
+#include "../Utils/MappedFile.h"
+#include "../Utils/ImageTransform.h"
+#include "../Utils/ImageDecoder.h"
+#include "../Utils/TextureContainer.h"
+#include "../Utils/CookedAssets.h"
+#include "BlockEncoder.h"
+
+namespace fs = std::filesystem;
+
+static std::string ToLower(std::string value)
+{
+	std::transform(value.begin(), value.end(), value.begin(),
+		[](unsigned char c) -> char {return std::tolower(c);});
+
+	return value;
+}
+
+Cooker::Cooker(
+	std::string sourceRoot,
+	std::string outputRoot,
+	ThreadPool* threadPool)
+{
+	_sourceRoot = sourceRoot;
+	_outputRoot = outputRoot;
+	_threadPool = threadPool;
+	_force = false;
+	_compress = true;
+}
+
+uint32_t Cooker::Run()
+{
+	std::vector<Entry> entries = Scan();
+	std::map<std::string, Entry> manifest;
+
+	if (!_force) {
+		manifest = CookedAssets::ReadManifest(_outputRoot);
+	}
+
+	std::vector<uint32_t> pending;
+
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		const Entry& entry = entries[i];
+		auto cooked = manifest.find(entry.Source);
+
+		bool upToDate = cooked != manifest.end() &&
+			cooked->second.Type == entry.Type &&
+			cooked->second.Size == entry.Size &&
+			cooked->second.TimeNS == entry.TimeNS &&
+			cooked->second.Output == entry.Output &&
+			fs::exists(fs::path(_outputRoot) / entry.Output);
+
+		if (upToDate) {
+			continue;
+		}
+
+		fs::create_directories(
+			(fs::path(_outputRoot) / entry.Output).parent_path());
+		pending.push_back(i);
+	}
+
+	// Every task writes only its own slot.
+	std::vector<std::string> errors(entries.size());
+	std::vector<char> failed(entries.size(), 0);
+
+	for (uint32_t index : pending) {
+		auto task = [this, &entries, &errors, &failed, index]() -> void
+		{
+			try {
+				Cook(entries[index]);
+			} catch (std::exception& e) {
+				errors[index] = e.what();
+				failed[index] = 1;
+			}
+		};
+
+		if (_threadPool) {
+			_threadPool->Enqueue(task);
+		} else {
+			task();
+		}
+	}
+
+	if (_threadPool) {
+		_threadPool->Wait();
+	}
+
+	uint32_t failedCount = 0;
+	std::vector<Entry> done;
+
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		if (failed[i]) {
+			LOG_ERROR << "Failed to cook " << entries[i].Source <<
+				": " << errors[i];
+			++failedCount;
+			continue;
+		}
+
+		done.push_back(entries[i]);
+	}
+
+	// Outputs whose source is gone or now cooks to another file.
+	for (auto& cooked : manifest) {
+		bool stillUsed = std::any_of(done.begin(), done.end(),
+			[&cooked](const Entry& entry) -> bool
+		{
+			return entry.Output == cooked.second.Output;
+		});
+
+		if (!stillUsed) {
+			const std::string& output = cooked.second.Output;
+
+			LOG_VERBOSE << "Removing " << output;
+			fs::remove(fs::path(_outputRoot) / output);
+		}
+	}
+
+	CookedAssets::WriteManifest(_outputRoot, done);
+
+	LOG_VERBOSE << "Cooked " << (uint32_t)pending.size() - failedCount <<
+		" of " << (uint32_t)entries.size() << " assets, " <<
+		failedCount << " failed.";
+
+	return failedCount;
+}
+
+std::vector<Cooker::Entry> Cooker::Scan()
+{
+	std::vector<Entry> entries;
+
+	for (auto& file : fs::recursive_directory_iterator(_sourceRoot)) {
+		if (!file.is_regular_file()) {
+			continue;
+		}
+
+		fs::path relative = fs::relative(file.path(), _sourceRoot);
+		std::string extension = ToLower(relative.extension().string());
+
+		Entry entry;
+		entry.Source = relative.generic_string();
+
+		if (extension == ".obj") {
+			entry.Type = AssetType::Mesh;
+			entry.Output = entry.Source + ".meshcache";
+		} else if (extension == ".png" || extension == ".jpg") {
+			bool skybox = ToLower(
+				relative.parent_path().filename().string()) ==
+				"skybox";
+
+			entry.Type = skybox ?
+				AssetType::Cubemap :
+				AssetType::Texture;
+			entry.Output = entry.Source + ".dds";
+		} else {
+			continue;
+		}
+
+		if (!StatFile(file.path().string(), entry.Size, entry.TimeNS)) {
+			throw std::runtime_error(
+				"Failed to stat " + file.path().string());
+		}
+
+		entries.push_back(entry);
+	}
+
+	std::sort(entries.begin(), entries.end(),
+		[](const Entry& a, const Entry& b) -> bool
+	{
+		return a.Source < b.Source;
+	});
+
+	return entries;
+}
+
+void Cooker::Cook(const Entry& entry)
+{
+	std::string source = (fs::path(_sourceRoot) / entry.Source).string();
+	std::string output = (fs::path(_outputRoot) / entry.Output).string();
+
+	switch (entry.Type) {
+	case AssetType::Mesh:
+		CookMesh(source, output);
+		break;
+	case AssetType::Texture:
+		CookTexture(source, output);
+		break;
+	case AssetType::Cubemap:
+		CookCubemap(source, output);
+		break;
+	}
+
+	LOG_VERBOSE << "Cooked " << entry.Source;
+}
+
+void Cooker::CookMesh(std::string source, std::string output)
+{
+	// Runs on a pool thread, so the model is parsed serially.
+	Loader::VertexData data = Loader::LoadModel(source);
+	Loader::Bounds bounds = Loader::CalculateBounds(data.Vertices);
+
+	MeshCache::WriteTo(output, source, data, &bounds);
+}
+
+void Cooker::CookTexture(std::string source, std::string output)
+{
+	DecodedImage image = DecodedImage::Decode(source);
+
+	std::vector<ImageTransform::MipLevel> chain =
+		ImageTransform::GenerateMipChain(
+			image.GetData(),
+			image.GetWidth(),
+			image.GetHeight());
+
+	TextureContainer::Texture texture;
+	texture.Format = TextureContainer::TextureFormat::RGBA8_SRGB;
+	texture.Width = image.GetWidth();
+	texture.Height = image.GetHeight();
+	texture.LayerCount = 1;
+	texture.MipLevels = chain.size();
+	texture.Cube = false;
+
+	for (const ImageTransform::MipLevel& level : chain) {
+		texture.Data.insert(
+			texture.Data.end(),
+			level.Data.begin(),
+			level.Data.end());
+	}
+
+	WriteTexture(output, texture);
+}
+
+void Cooker::CookCubemap(std::string source, std::string output)
+{
+	DecodedImage image = DecodedImage::Decode(source);
+
+	uint32_t layerCount = 6;
+
+	if (image.GetWidth() % layerCount != 0) {
+		throw std::runtime_error(
+			"Skybox width is not a multiple of six faces.");
+	}
+
+	std::vector<uint8_t> cube = ImageTransform::SkyboxToCube(
+		image.GetWidth(),
+		image.GetHeight(),
+		image.GetData(),
+		image.GetSize());
+
+	TextureContainer::Texture texture;
+	texture.Format = TextureContainer::TextureFormat::RGBA8_SRGB;
+	texture.Width = image.GetWidth() / layerCount;
+	texture.Height = image.GetHeight();
+	texture.LayerCount = layerCount;
+	texture.MipLevels = ImageTransform::GetMipLevelCount(
+		texture.Width,
+		texture.Height);
+	texture.Cube = true;
+
+	uint32_t faceSize = texture.Width * texture.Height * 4;
+
+	for (uint32_t layer = 0; layer < layerCount; ++layer) {
+		std::vector<ImageTransform::MipLevel> chain =
+			ImageTransform::GenerateMipChain(
+				cube.data() + faceSize * layer,
+				texture.Width,
+				texture.Height);
+
+		for (const ImageTransform::MipLevel& level : chain) {
+			texture.Data.insert(
+				texture.Data.end(),
+				level.Data.begin(),
+				level.Data.end());
+		}
+	}
+
+	WriteTexture(output, texture);
+}
+
+void Cooker::WriteTexture(
+	std::string output,
+	const TextureContainer::Texture& texture)
+{
+	if (!_compress) {
+		TextureContainer::Write(output, texture);
+		return;
+	}
+
+	// BC1 has no usable alpha, but takes half the space of BC7.
+	TextureContainer::TextureFormat format =
+		BlockEncoder::HasAlpha(texture.Data) ?
+		TextureContainer::TextureFormat::BC7_SRGB :
+		TextureContainer::TextureFormat::BC1_SRGB;
+
+	TextureContainer::Write(
+		output,
+		BlockEncoder::Compress(texture, format));
+}
@@ -0,0 +1,68 @@
+#ifndef _COOKER_H
+#define _COOKER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "../Utils/ThreadPool.h"
+#include "../Utils/TextureContainer.h"
+#include "../Utils/CookedAssets.h"
+
+// Converts the source assets of a directory tree into their runtime
+// formats:
+//   *.obj               -> *.obj.meshcache, welded mesh with bounds
+//   *.png, *.jpg        -> *.dds, full mip chain, BC1 when opaque and
+//                          BC7 otherwise, or RGBA8 when uncompressed
+//   Skybox/*.png, *.jpg -> *.dds, six layer cube map, compressed alike
+// Outputs mirror the source tree under the output directory. The manifest
+// there records every cooked source, only new or changed sources are
+// cooked again and outputs of deleted sources are removed. The runtime
+// finds the outputs through the manifest, see Utils/CookedAssets.h.
+class Cooker
+{
+public:
+	typedef CookedAssets::AssetType AssetType;
+	typedef CookedAssets::ManifestEntry Entry;
+
+	Cooker(
+		std::string sourceRoot,
+		std::string outputRoot,
+		ThreadPool* threadPool);
+
+	// Ignores the manifest and cooks everything again.
+	void SetForce(bool force)
+	{
+		_force = force;
+	}
+
+	// Textures are block compressed by default.
+	void SetCompress(bool compress)
+	{
+		_compress = compress;
+	}
+
+	// Returns the number of assets that failed to cook.
+	uint32_t Run();
+
+private:
+	std::string _sourceRoot;
+	std::string _outputRoot;
+	ThreadPool* _threadPool;
+	bool _force;
+	bool _compress;
+
+	std::vector<Entry> Scan();
+
+	void Cook(const Entry& entry);
+	void CookMesh(std::string source, std::string output);
+	void CookTexture(std::string source, std::string output);
+	void CookCubemap(std::string source, std::string output);
+
+	void WriteTexture(
+		std::string output,
+		const TextureContainer::Texture& texture);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+
+#include "Cooker.h"
+#include "../Logger/logger.h"
+
+// assetcook <source dir> <output dir> [--force] [--uncompressed]
+//           [--threads N]
+int main(int argc, char** argv)
+{
+	Logger::SetLevel(Logger::Level::Verbose);
+
+	if (argc < 3) {
+		LOG_ERROR << "Usage: " << argv[0] <<
+			" <source dir> <output dir> [--force] [--uncompressed]"
+			" [--threads N]";
+		Logger::Flush();
+		return 2;
+	}
+
+	bool force = false;
+	bool compress = true;
+	uint32_t threadCount =
+		std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (int i = 3; i < argc; ++i) {
+		if (strcmp(argv[i], "--force") == 0) {
+			force = true;
+		} else if (strcmp(argv[i], "--uncompressed") == 0) {
+			compress = false;
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threadCount = std::max(atoi(argv[++i]), 1);
+		}
+	}
+
+	uint32_t failedCount;
+
+	try {
+		ThreadPool threadPool(threadCount);
+
+		Cooker cooker(argv[1], argv[2], &threadPool);
+		cooker.SetForce(force);
+		cooker.SetCompress(compress);
+
+		failedCount = cooker.Run();
+	} catch (std::exception& e) {
+		LOG_ERROR << e.what();
+		Logger::Flush();
+		return 1;
+	}
+
+	Logger::Flush();
+
+	return failedCount == 0 ? 0 : 1;
+}
@@ -1,6 +1,7 @@
 #include "ExternModel.h"
 
 #include "../Utils/loader.h"
+#include "../Utils/MeshCache.h"
 #include "../Logger/logger.h"
 
 ExternModel::ExternModel(
@@ -9,17 +10,31 @@ ExternModel::ExternModel(
 	uint32_t specularIndex,
 	glm::mat4 matrix)
 {
-	auto model = Loader::LoadModel(modelFile);
+	auto mesh = Loader::OpenModelCached(modelFile);
+	const MeshCache::Vertex* vertices = mesh->GetVertices();
 
-	SetModelVertices(model.Vertices);
-	SetModelNormals(model.Normals);
-	SetModelTexCoords(model.TexCoords);
-	SetModelIndices(model.Indices);
+	// Collision keeps positions of its own, the mesh is drawn as it is.
+	std::vector<glm::vec3> positions(mesh->GetVertexCount());
 
-	SetObjectVertices(model.Vertices);
-	SetObjectIndices(model.Indices);
-	SetObjectCenter();
+	for (size_t i = 0; i < positions.size(); ++i) {
+		positions[i] = vertices[i].Pos;
+	}
 
+	Loader::Bounds bounds;
+
+	if (!mesh->GetBounds(bounds)) {
+		bounds = Loader::CalculateBounds(positions);
+	}
+
+	SetObjectVertices(positions);
+	SetObjectIndices(std::vector<uint32_t>(
+		mesh->GetIndices(),
+		mesh->GetIndices() + mesh->GetIndexCount()));
+	SetObjectCenter(bounds.Center);
+	_SetObjectRadius(bounds.Radius);
+	_SetObjectInitialized(true);
+
+	SetModelMesh(mesh);
 	SetTexture({textureIndex, specularIndex});
 
 	SetModelMatrix(matrix);
@@ -2,6 +2,7 @@
 #define _MOVING_LIGHT_H
 
 #include "../UniverseEngine/actor.h"
+#include "../UniverseEngine/universe.h"
 #include "../VideoEngine/light.h"
 
 class MovingLight : public Light, public Actor
@@ -16,12 +17,17 @@ public:
 
 	void Tick()
 	{
-		SetLightPosition(glm::vec3(
+		glm::vec3 position(
 			sinf(_angle) * _radius,
 			cosf(_angle) * _radius,
-			3.0f));
-
-		SetLightAngleFade(10.0 + sinf(_angle * 8) * 5.0);
+			3.0f);
+		float angleFade = 10.0 + sinf(_angle * 8) * 5.0;
+
+		Universe::Defer([this, position, angleFade]() -> void
+		{
+			SetLightPosition(position);
+			SetLightAngleFade(angleFade);
+		});
 
 		_angle += _speed;
 	}
@@ -1,11 +1,19 @@
 #include "ScriptHandler.h"
 
+#include <list>
+
 #include "../Utils/TextFileParser.h"
 #include "../Utils/loader.h"
+#include "../Utils/ImageDecoder.h"
+#include "../Utils/CookedAssets.h"
+#include "../Utils/TextureContainer.h"
 
 #include "../Logger/logger.h"
 
-ScriptHandler::Scene ScriptHandler::LoadScene(std::string file, Video* video)
+ScriptHandler::Scene ScriptHandler::LoadScene(
+	std::string file,
+	Video* video,
+	StreamingLoader* streaming)
 {
 	TextFileParser::File script = TextFileParser::ParseFile(file);
 
@@ -13,23 +21,57 @@ ScriptHandler::Scene ScriptHandler::LoadScene(std::string file, Video* video)
 
 	std::map<std::string, uint32_t> textureNames;
 
+	// Without streaming every texture of the script is requested up
+	// front, the ones not cooked decode concurrently while the lines
+	// are processed.
+	struct PendingTexture
+	{
+		std::string Cooked;
+		std::future<DecodedImage> Image;
+	};
+
+	ImageDecoder decoder(streaming ? 0 : 3);
+	std::list<PendingTexture> textures;
+
+	for (auto& line : script) {
+		if (!streaming && line.size() != 0 && line[0] == "texture") {
+			PendingTexture texture;
+			texture.Cooked = CookedAssets::Find(line[2]);
+
+			if (texture.Cooked.empty()) {
+				texture.Image = decoder.Decode(line[2]);
+			}
+
+			textures.push_back(std::move(texture));
+		}
+	}
+
 	for (auto& line : script) {
 		if (line.size() == 0) {
 			continue;
 		}
 
 		if (line[0] == "texture") {
-			int texWidth;
-			int texHeight;
-			auto texData = Loader::LoadImage(
-				line[2],
-				texWidth,
-				texHeight);
-
-			uint32_t texId = video->GetTextures()->AddTexture(
-				texWidth,
-				texHeight,
-				texData);
+			uint32_t texId;
+
+			if (streaming) {
+				texId = streaming->RequestTexture(line[2]);
+			} else if (!textures.front().Cooked.empty()) {
+				texId = video->GetTextures()->AddTexture(
+					TextureContainer::Read(
+						textures.front().Cooked));
+				textures.pop_front();
+			} else {
+				DecodedImage image =
+					textures.front().Image.get();
+				textures.pop_front();
+
+				texId = video->GetTextures()->AddTexture(
+					image.GetWidth(),
+					image.GetHeight(),
+					image.GetData(),
+					image.GetSize());
+			}
 
 			textureNames[line[1]] = texId;
 			scene.Textures.push_back(texId);
@@ -106,7 +148,7 @@ ScriptHandler::Scene ScriptHandler::LoadScene(std::string file, Video* video)
 
 			scene.Lights.push_back(light);
 		} else {
-			Logger::Verbose() << "Unknown command " << line[0];
+			LOG_VERBOSE << "Unknown command " << line[0];
 
 			throw std::runtime_error(
 				"Unsupported command in scene script.");
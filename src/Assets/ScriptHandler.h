@@ -6,6 +6,7 @@
 #include "ExternModel.h"
 #include "animation.h"
 #include "../VideoEngine/video.h"
+#include "../VideoEngine/StreamingLoader.h"
 
 // Scene script line syntax.
 // texture <texture name> <path to image>
@@ -29,7 +30,14 @@ public:
 		std::vector<Light*> Lights;
 	};
 
-	static Scene LoadScene(std::string file, Video* video);
+	// With a streaming loader textures are requested from it and
+	// filled in while the scene is already drawn. Either way textures
+	// and models come from the cooked assets when they are up to date,
+	// see CookedAssets.
+	static Scene LoadScene(
+		std::string file,
+		Video* video,
+		StreamingLoader* streaming = nullptr);
 	static Animation LoadAnimation(std::string file);
 
 private:
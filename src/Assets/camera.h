@@ -4,6 +4,7 @@
 #include <cmath>
 
 #include "../UniverseEngine/actor.h"
+#include "../UniverseEngine/universe.h"
 #include "../VideoEngine/video.h"
 #include "../Logger/logger.h"
 
@@ -19,14 +20,19 @@ public:
 	void Tick()
 	{
 		float angleInRad = glm::radians(_angle);
-		_video->SetCameraPosition(glm::vec3(
+		glm::vec3 position(
 			sinf(angleInRad) * 6,
 			cosf(angleInRad) * 6,
-			4));
-		_video->SetCameraTarget(glm::vec3(
-			0.0f,
-			0.0f,
-			0.0f));
+			4);
+
+		Universe::Defer([this, position]() -> void
+		{
+			_video->SetCameraPosition(position);
+			_video->SetCameraTarget(glm::vec3(
+				0.0f,
+				0.0f,
+				0.0f));
+		});
 
 		_angle += 0.1;
 
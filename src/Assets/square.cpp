@@ -5,6 +5,7 @@
 #include <cmath>
 
 #include "../Utils/loader.h"
+#include "../UniverseEngine/universe.h"
 
 Square::Square(uint32_t textureIndex, float depthMod)
 {
@@ -50,15 +51,21 @@ void Square::SetRectangleScreenRatio(float value)
 
 void Square::Tick()
 {
-	SetRectangleTexCoords(glm::vec4(
+	glm::vec4 texCoords(
 		0.0f,
 		0.0f,
 		1.0f + sinf(_time),
-		1.0f + sinf(_time)));
+		1.0f + sinf(_time));
 
 	_time += 0.01;
 
-	SetRectangleDepth(_depthMod * sinf(_time));
+	float depth = _depthMod * sinf(_time);
+
+	Universe::Defer([this, texCoords, depth]() -> void
+	{
+		SetRectangleTexCoords(texCoords);
+		SetRectangleDepth(depth);
+	});
 
 	if (_time >= 2 * M_PI) {
 		_time = 0;
@@ -14,26 +14,26 @@ public:
 	void Tick() override;
 	bool MouseMove(double xpos, double ypos, bool inArea) override
 	{
-		Logger::Verbose() << inArea << " " << xpos << " " << ypos;
+		LOG_VERBOSE << inArea << " " << xpos << " " << ypos;
 		return true;
 	}
 
 	void Key(int key, int scancode, int action, int mods) override
 	{
-		Logger::Verbose() << key << " " << scancode << " " <<
+		LOG_VERBOSE << key << " " << scancode << " " <<
 			action << " " << mods;
 	}
 
 	bool MouseButton(int button, int action, int mods) override
 	{
-		Logger::Verbose() << button << " " <<
+		LOG_VERBOSE << button << " " <<
 			action << " " << mods;
 		return true;
 	}
 
 	bool Scroll(double xoffset, double yoffset) override
 	{
-		Logger::Verbose() << xoffset << " " << yoffset;
+		LOG_VERBOSE << xoffset << " " << yoffset;
 		return true;
 	}
 
@@ -1,10 +1,280 @@
 #include "logger.h"
 
-#include <iostream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
 
 namespace Logger
 {
-	static Level _logLevel = Level::Silent;
+	static std::atomic<Level> _logLevel = Level::Silent;
+
+	// Messages keeping more text are freed instead of recycled.
+	static const size_t MaxRecycledSize = 4096;
+
+	// Intrusive multi-producer single-consumer queue (D. Vyukov). Push is
+	// one atomic exchange, the consumer never takes a lock either.
+	struct Message
+	{
+		std::atomic<Message*> Next;
+		std::string Text;
+	};
+
+	// Messages a thread took from the free list, freed with the thread.
+	struct MessageCache
+	{
+		Message* Head = nullptr;
+
+		~MessageCache()
+		{
+			while (Head) {
+				Message* next = Head->Next.load(
+					std::memory_order_relaxed);
+				delete Head;
+				Head = next;
+			}
+		}
+	};
+
+	class Backend
+	{
+	public:
+		Backend()
+		{
+			_stub.Next = nullptr;
+			_head = &_stub;
+			_tail = &_stub;
+			_free = nullptr;
+			_pushed = 0;
+			_written = 0;
+			_output = stdout;
+			_work = true;
+			_thread = std::thread(&Backend::ThreadFunction, this);
+		}
+
+		~Backend()
+		{
+			_work = false;
+			_thread.join();
+
+			if (_output != stdout) {
+				fclose(_output);
+			}
+
+			// Freed along with the cache.
+			MessageCache cache;
+			cache.Head = _free.exchange(nullptr);
+		}
+
+		// An empty message, recycled when one is free. Producers take
+		// the whole free list at once into a cache of their own, so
+		// the list is only ever pushed to and emptied, never popped.
+		Message* Acquire()
+		{
+			static thread_local MessageCache cache;
+
+			if (!cache.Head) {
+				cache.Head = _free.exchange(
+					nullptr,
+					std::memory_order_acquire);
+			}
+
+			Message* message = cache.Head;
+
+			if (!message) {
+				message = new Message();
+				message->Text.reserve(128);
+				return message;
+			}
+
+			cache.Head = message->Next.load(
+				std::memory_order_relaxed);
+
+			return message;
+		}
+
+		void Push(Message* message)
+		{
+			message->Next.store(nullptr, std::memory_order_relaxed);
+
+			Message* prev = _head.exchange(
+				message,
+				std::memory_order_acq_rel);
+			prev->Next.store(message, std::memory_order_release);
+
+			_pushed.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void SetOutputFile(std::string file)
+		{
+			FILE* output = fopen(file.c_str(), "a");
+
+			if (!output) {
+				throw std::runtime_error(
+					"Failed to open log file.");
+			}
+
+			_outputMutex.lock();
+
+			if (_output != stdout) {
+				fclose(_output);
+			}
+
+			_output = output;
+			_outputMutex.unlock();
+		}
+
+		void Flush()
+		{
+			uint64_t target = _pushed.load(
+				std::memory_order_relaxed);
+
+			while (_written.load(
+				std::memory_order_acquire) < target)
+			{
+				std::this_thread::sleep_for(
+					std::chrono::milliseconds(1));
+			}
+		}
+
+	private:
+		std::atomic<Message*> _head;
+		Message* _tail;
+		Message _stub;
+
+		// Written messages ready for reuse.
+		std::atomic<Message*> _free;
+
+		std::atomic<uint64_t> _pushed;
+		std::atomic<uint64_t> _written;
+
+		FILE* _output;
+		std::mutex _outputMutex;
+
+		std::atomic<bool> _work;
+		std::thread _thread;
+
+		Message* Pop()
+		{
+			Message* tail = _tail;
+			Message* next = tail->Next.load(
+				std::memory_order_acquire);
+
+			if (tail == &_stub) {
+				if (!next) {
+					return nullptr;
+				}
+
+				_tail = next;
+				tail = next;
+				next = next->Next.load(
+					std::memory_order_acquire);
+			}
+
+			if (next) {
+				_tail = next;
+				return tail;
+			}
+
+			if (tail != _head.load(std::memory_order_acquire)) {
+				// A producer is between exchange and link.
+				return nullptr;
+			}
+
+			_stub.Next.store(nullptr, std::memory_order_relaxed);
+			Message* prev = _head.exchange(
+				&_stub,
+				std::memory_order_acq_rel);
+			prev->Next.store(&_stub, std::memory_order_release);
+
+			next = tail->Next.load(std::memory_order_acquire);
+
+			if (next) {
+				_tail = next;
+				return tail;
+			}
+
+			return nullptr;
+		}
+
+		void Recycle(Message* message)
+		{
+			if (message->Text.capacity() > MaxRecycledSize) {
+				delete message;
+				return;
+			}
+
+			message->Text.clear();
+
+			Message* head = _free.load(std::memory_order_relaxed);
+
+			do {
+				message->Next.store(
+					head,
+					std::memory_order_relaxed);
+			} while (!_free.compare_exchange_weak(
+				head,
+				message,
+				std::memory_order_release,
+				std::memory_order_relaxed));
+		}
+
+		// Drains everything available into one write.
+		bool WriteBatch(std::string& batch)
+		{
+			uint64_t count = 0;
+			Message* message;
+
+			while ((message = Pop())) {
+				batch += message->Text;
+				Recycle(message);
+				++count;
+			}
+
+			if (count == 0) {
+				return false;
+			}
+
+			_outputMutex.lock();
+			fwrite(batch.data(), 1, batch.size(), _output);
+			fflush(_output);
+			_outputMutex.unlock();
+
+			batch.clear();
+			_written.fetch_add(count, std::memory_order_release);
+
+			return true;
+		}
+
+		void ThreadFunction()
+		{
+			std::string batch;
+
+			while (_work) {
+				if (!WriteBatch(batch)) {
+					std::this_thread::sleep_for(
+						std::chrono::milliseconds(5));
+				}
+			}
+
+			while (_written.load(std::memory_order_relaxed) <
+				_pushed.load(std::memory_order_relaxed))
+			{
+				if (!WriteBatch(batch)) {
+					std::this_thread::yield();
+				}
+			}
+		}
+	};
+
+	static Backend& GetBackend()
+	{
+		static Backend backend;
+		return backend;
+	}
 
 	const char* StrLevel(Level level)
 	{
@@ -22,26 +292,46 @@ namespace Logger
 		return "";
 	}
 
+	template<typename T>
+	static void AppendNumber(std::string& message, T value)
+	{
+		char buffer[32];
+		auto result = std::to_chars(
+			buffer,
+			buffer + sizeof(buffer),
+			value);
+		message.append(buffer, result.ptr);
+	}
+
 	Logger::Logger(Level level)
 	{
 		_level = level;
+		_message = nullptr;
 
-		if (_logLevel >= _level) {
-			std::cout << StrLevel(_level) << ": ";
+		if (IsEnabled(_level)) {
+			_message = GetBackend().Acquire();
+			_message->Text += StrLevel(_level);
+			_message->Text += ": ";
 		}
 	}
 
 	Logger::~Logger()
 	{
-		if (_logLevel >= _level) {
-			std::cout << std::endl;
+		if (_message) {
+			_message->Text += '\n';
+			GetBackend().Push(_message);
+
+			// Errors usually precede a throw, get them out now.
+			if (_level == Level::Error) {
+				GetBackend().Flush();
+			}
 		}
 	}
 
 	Logger& Logger::operator<<(const std::string& message)
 	{
-		if (_logLevel >= _level) {
-			std::cout << message;
+		if (_message) {
+			_message->Text += message;
 		}
 
 		return *this;
@@ -49,8 +339,8 @@ namespace Logger
 
 	Logger& Logger::operator<<(const char* message)
 	{
-		if (_logLevel >= _level) {
-			std::cout << message;
+		if (_message) {
+			_message->Text += message;
 		}
 
 		return *this;
@@ -58,8 +348,8 @@ namespace Logger
 
 	Logger& Logger::operator<<(int32_t message)
 	{
-		if (_logLevel >= _level) {
-			std::cout << message;
+		if (_message) {
+			AppendNumber(_message->Text, message);
 		}
 
 		return *this;
@@ -67,8 +357,26 @@ namespace Logger
 
 	Logger& Logger::operator<<(uint32_t message)
 	{
-		if (_logLevel >= _level) {
-			std::cout << message;
+		if (_message) {
+			AppendNumber(_message->Text, message);
+		}
+
+		return *this;
+	}
+
+	Logger& Logger::operator<<(int64_t message)
+	{
+		if (_message) {
+			AppendNumber(_message->Text, message);
+		}
+
+		return *this;
+	}
+
+	Logger& Logger::operator<<(uint64_t message)
+	{
+		if (_message) {
+			AppendNumber(_message->Text, message);
 		}
 
 		return *this;
@@ -76,8 +384,8 @@ namespace Logger
 
 	Logger& Logger::operator<<(float message)
 	{
-		if (_logLevel >= _level) {
-			std::cout << message;
+		if (_message) {
+			AppendNumber(_message->Text, message);
 		}
 
 		return *this;
@@ -85,8 +393,8 @@ namespace Logger
 
 	Logger& Logger::operator<<(double message)
 	{
-		if (_logLevel >= _level) {
-			std::cout << message;
+		if (_message) {
+			AppendNumber(_message->Text, message);
 		}
 
 		return *this;
@@ -97,6 +405,21 @@ namespace Logger
 		_logLevel = level;
 	}
 
+	bool IsEnabled(Level level)
+	{
+		return _logLevel.load(std::memory_order_relaxed) >= level;
+	}
+
+	void SetOutputFile(std::string file)
+	{
+		GetBackend().SetOutputFile(file);
+	}
+
+	void Flush()
+	{
+		GetBackend().Flush();
+	}
+
 	Logger Error()
 	{
 		return Logger(Level::Error);
@@ -4,8 +4,16 @@
 #include <string>
 #include <cstdint>
 
+// Highest level compiled in, lower it with -DLOGGER_COMPILE_LEVEL=N to
+// strip the LOG_* statements of more verbose levels from the binary.
+#ifndef LOGGER_COMPILE_LEVEL
+#define LOGGER_COMPILE_LEVEL 3
+#endif
+
 namespace Logger
 {
+	struct Message;
+
 	enum class Level
 	{
 		Silent = 0,
@@ -14,28 +22,53 @@ namespace Logger
 		Verbose = 3
 	};
 
+	// Formats one line into a message buffer recycled by the backend. The
+	// destructor hands the line to a lock-free queue drained by a
+	// background writer thread, so the calling thread never blocks on
+	// output.
 	class Logger
 	{
 	public:
 		Logger(Level level);
+		Logger(const Logger& logger) = delete;
 		~Logger();
 
 		Logger& operator<<(const std::string& message);
 		Logger& operator<<(const char* message);
 		Logger& operator<<(int32_t message);
 		Logger& operator<<(uint32_t message);
+		Logger& operator<<(int64_t message);
+		Logger& operator<<(uint64_t message);
 		Logger& operator<<(float message);
 		Logger& operator<<(double message);
 
 	private:
 		Level _level;
+		// Null when the level is disabled.
+		Message* _message;
 	};
 
 	void SetLevel(Level level);
+	bool IsEnabled(Level level);
+
+	// Lines go to stdout until an output file is set.
+	void SetOutputFile(std::string file);
+
+	// Blocks until every line logged before the call is written.
+	void Flush();
 
 	Logger Error();
 	Logger Warning();
 	Logger Verbose();
 }
 
+#define _LOGGER_STATEMENT(level, function) \
+	if constexpr (LOGGER_COMPILE_LEVEL < (int)::Logger::Level::level) {} \
+	else if (!::Logger::IsEnabled(::Logger::Level::level)) {} \
+	else ::Logger::function()
+
+#define LOG_ERROR _LOGGER_STATEMENT(Error, Error)
+#define LOG_WARNING _LOGGER_STATEMENT(Warning, Warning)
+#define LOG_VERBOSE _LOGGER_STATEMENT(Verbose, Verbose)
+
 #endif
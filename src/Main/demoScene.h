@@ -2,10 +2,12 @@
 #define _DEMO_H
 
 #include <algorithm>
+#include <future>
 
 #include "../VideoEngine/video.h"
 #include "../UniverseEngine/universe.h"
 #include "../Utils/loader.h"
+#include "../VideoEngine/StreamingLoader.h"
 #include "../Assets/square.h"
 #include "../Assets/ExternModel.h"
 #include "../Assets/animation.h"
@@ -19,27 +21,12 @@ public:
 		_video = video;
 		_maxLength = 1.0;
 
-		int texWidth;
-		int texHeight;
-		auto texData = Loader::LoadImage(
-			"../src/Assets/Resources/Models/sword.png",
-			texWidth,
-			texHeight);
-
 		_swordTexture = video->GetTextures()->AddTexture(
-			texWidth,
-			texHeight,
-			texData);
-
-		texData = Loader::LoadImage(
-			"../src/Assets/Resources/Models/blade.png",
-			texWidth,
-			texHeight);
-
+			Loader::LoadTexture(
+				"../src/Assets/Resources/Models/sword.png"));
 		_bladeTexture = video->GetTextures()->AddTexture(
-			texWidth,
-			texHeight,
-			texData);
+			Loader::LoadTexture(
+				"../src/Assets/Resources/Models/blade.png"));
 
 		_state = 0;
 		_prevState = 0;
@@ -91,13 +78,14 @@ public:
 			_intensity -= 360;
 		}
 
-		_bladeLight1.SetLightColor(
-			glm::vec3(0.0f, 0.3f, 0.0f) *
-			(1.0f + sinf(glm::radians(_intensity)) * 0.05f));
+		glm::vec3 bladeColor = glm::vec3(0.0f, 0.3f, 0.0f) *
+			(1.0f + sinf(glm::radians(_intensity)) * 0.05f);
 
-		_bladeLight2.SetLightColor(
-			glm::vec3(0.0f, 0.3f, 0.0f) *
-			(1.0f + sinf(glm::radians(_intensity)) * 0.05f));
+		Universe::Defer([this, bladeColor]() -> void
+		{
+			_bladeLight1.SetLightColor(bladeColor);
+			_bladeLight2.SetLightColor(bladeColor);
+		});
 
 		switch (_state) {
 		case 1:
@@ -110,9 +98,7 @@ public:
 
 
 				if (_prevState == 0) {
-					_bladeLight1.SetLightActive(true);
-					_bladeLight2.SetLightActive(true);
-					_blade->SetDrawEnabled(true);
+					SetBladeActive(true);
 					_prevState = 1;
 				}
 			}
@@ -127,9 +113,7 @@ public:
 				}
 
 				if (_length <= 0 && _prevState == 1) {
-					_bladeLight1.SetLightActive(false);
-					_bladeLight2.SetLightActive(false);
-					_blade->SetDrawEnabled(false);
+					SetBladeActive(false);
 					_prevState = 0;
 				}
 			}
@@ -216,6 +200,16 @@ public:
 	}
 
 private:
+	void SetBladeActive(bool active)
+	{
+		Universe::Defer([this, active]() -> void
+		{
+			_bladeLight1.SetLightActive(active);
+			_bladeLight2.SetLightActive(active);
+			_blade->SetDrawEnabled(active);
+		});
+	}
+
 	ExternModel* _sword;
 	ExternModel* _blade;
 	uint32_t _swordTexture;
@@ -451,16 +445,24 @@ public:
 			hspeed.y / 20,
 			_vspeed / 200));
 
-		_video->SetCameraPosition(_pos + glm::vec3(0, 0, 1.85));
-		_video->SetCameraDirection(glm::vec3(
-				hdir * cosf(glm::radians(_angleV)),
-				sinf(glm::radians(_angleV))));
-
-		_light->SetLightPosition(_pos + glm::vec3(0, 0, 1.2) +
-				glm::vec3(-hdirStrafe * 0.3f, 0.0f));
-		_light->SetLightDirection(glm::vec3(
-				hdir * cosf(glm::radians(_angleV)),
-				sinf(glm::radians(_angleV))));
+		glm::vec3 viewPosition = _pos + glm::vec3(0, 0, 1.85);
+		glm::vec3 viewDirection(
+			hdir * cosf(glm::radians(_angleV)),
+			sinf(glm::radians(_angleV)));
+		glm::vec3 lightPosition = _pos + glm::vec3(0, 0, 1.2) +
+			glm::vec3(-hdirStrafe * 0.3f, 0.0f);
+
+		Universe::Defer([
+			this,
+			viewPosition,
+			viewDirection,
+			lightPosition]() -> void
+		{
+			_video->SetCameraPosition(viewPosition);
+			_video->SetCameraDirection(viewDirection);
+			_light->SetLightPosition(lightPosition);
+			_light->SetLightDirection(viewDirection);
+		});
 		_mutex.unlock();
 
 		_rayEngine->RayCast(
@@ -483,7 +485,10 @@ public:
 
 		swp = _animation.Step(swp);
 
-		_sword->SetPosition(swp);
+		Universe::Defer([this, swp]() -> void
+		{
+			_sword->SetPosition(swp);
+		});
 	}
 
 private:
@@ -533,7 +538,7 @@ public:
 		SetModelInnerMatrix(glm::mat4(1.0));
 		SetModelInstances({glm::mat4(1.0)});
 
-		auto model = Loader::LoadModel(
+		auto model = Loader::LoadModelCached(
 			"../src/Assets/Resources/Models/field.obj");
 
 		for (auto& coord : model.TexCoords) {
@@ -556,6 +561,19 @@ class Demo
 public:
 	static void Run()
 	{
+		// Read from the cooked assets, or decoded and laid out, while
+		// the window and the other assets load.
+		auto skybox = std::async(
+			std::launch::async,
+			[]() -> TextureContainer::Texture
+		{
+			ThreadPool threadPool(3);
+
+			return Loader::LoadSkybox(
+				"../src/Assets/Resources/Skybox/skybox.png",
+				&threadPool);
+		});
+
 		std::mutex sceneMutex;
 
 		CollisionEngine collisionEngine;
@@ -572,47 +590,25 @@ public:
 
 		universe.RegisterCollisionEngine(&collisionEngine);
 
-		int texWidth;
-		int texHeight;
-		auto texData = Loader::LoadImage(
-			"../src/Assets/Resources/Models/floor.jpg",
-			texWidth,
-			texHeight);
-
-		uint32_t woodenTiles = video.GetTextures()->AddTexture(
-			texWidth,
-			texHeight,
-			texData);
+		// Textures show a placeholder until streamed in, the frame
+		// callback uploads them between frames.
+		StreamingLoader streaming(video.GetTextures(), 2);
+		video.SetFrameCallback([&streaming]() -> void
+		{
+			streaming.Update();
+		});
 
-		texData = Loader::LoadImage(
+		uint32_t woodenTiles = streaming.RequestTexture(
+			"../src/Assets/Resources/Models/floor.jpg",
+			StreamingLoader::Priority::High);
+		uint32_t wallTexture = streaming.RequestTexture(
 			"../src/Assets/Resources/Models/wall.png",
-			texWidth,
-			texHeight);
-
-		uint32_t wallTexture = video.GetTextures()->AddTexture(
-			texWidth,
-			texHeight,
-			texData);
-
-		texData = Loader::LoadImage(
-			"../src/Assets/Resources/Models/wall_specular.png",
-			texWidth,
-			texHeight);
-
-		uint32_t wallSpecular = video.GetTextures()->AddTexture(
-			texWidth,
-			texHeight,
-			texData);
-
-		texData = Loader::LoadImage(
+			StreamingLoader::Priority::High);
+		uint32_t wallSpecular = streaming.RequestTexture(
+			"../src/Assets/Resources/Models/wall_specular.png");
+		uint32_t squareTexture = streaming.RequestTexture(
 			"../src/Assets/Resources/Images/transparent.png",
-			texWidth,
-			texHeight);
-
-		uint32_t squareTexture = video.GetTextures()->AddTexture(
-			texWidth,
-			texHeight,
-			texData);
+			StreamingLoader::Priority::Low);
 
 		Light light;
 		light.SetLightType(Light::Type::Spot);
@@ -623,13 +619,7 @@ public:
 
 		video.SetFOV(80);
 		video.SetCameraUp({0, 0, 1});
-		int skbTWidth;
-		int skbTHeight;
-		auto skbTData = Loader::LoadImage(
-			"../src/Assets/Resources/Skybox/skybox.png",
-			skbTWidth,
-			skbTHeight);
-		video.CreateSkybox(skbTWidth, skbTHeight, skbTData);
+		video.CreateSkybox(skybox.get());
 		video.SetSkyboxColor({0.1, 0.05, 0.05});
 
 		Sword sword(&video);
@@ -736,7 +726,8 @@ public:
 
 		auto scene = ScriptHandler::LoadScene(
 			"../src/Assets/Scripts/TestScene.script",
-			&video);
+			&video,
+			&streaming);
 
 		for (auto model : scene.Models) {
 			video.RegisterModel(model);
@@ -750,6 +741,7 @@ public:
 		std::thread universeThread(UniverseThread, &universe);
 
 		video.MainLoop();
+		video.SetFrameCallback(nullptr);
 
 		universe.Stop();
 		universeThread.join();
@@ -1,10 +1,60 @@
 #include "demoScene.h"
 
+#include <cstring>
+
+#include "../Utils/Profiler.h"
+#include "../Utils/Metrics.h"
+
 int main(int argc, char** argv)
 {
 	Logger::SetLevel(Logger::Level::Verbose);
 
+	// --profile [file] records zones and writes a Chrome trace on exit.
+	const char* profileFile = nullptr;
+	// --metrics [file] appends a metrics snapshot every second, needs
+	// a build with METRICS=1.
+	const char* metricsFile = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--profile") == 0) {
+			profileFile = "profile.json";
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				profileFile = argv[++i];
+			}
+		} else if (strcmp(argv[i], "--metrics") == 0) {
+			metricsFile = "metrics.jsonl";
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				metricsFile = argv[++i];
+			}
+		}
+	}
+
+	if (profileFile) {
+		Profiler::SetThreadName("Main");
+		Profiler::SetEnabled(true);
+	}
+
+	if (metricsFile) {
+#ifndef ENABLE_METRICS
+		LOG_WARNING << "Metrics are not compiled in.";
+#endif
+		Metrics::StartDump(metricsFile, 1000);
+	}
+
 	Demo::Run();
 
+	if (metricsFile) {
+		Metrics::StopDump();
+		Metrics::Dump(metricsFile);
+	}
+
+	if (profileFile) {
+		Profiler::SetEnabled(false);
+		Profiler::ExportChromeTrace(profileFile);
+		LOG_VERBOSE << "Profile written to " << profileFile;
+	}
+
 	return 0;
 }
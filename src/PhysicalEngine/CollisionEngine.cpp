@@ -3,6 +3,8 @@
 #include "PlaneHelper.h"
 
 #include "../Logger/logger.h"
+#include "../Utils/Profiler.h"
+#include "../Utils/Metrics.h"
 
 using namespace PlaneHelper;
 
@@ -32,6 +34,8 @@ void CollisionEngine::RemoveObject(Object* object)
 
 void CollisionEngine::Run()
 {
+	PROFILE_ZONE("CollisionEngine::Run");
+
 	std::vector<Object*> objects(_objects.size());
 
 	size_t i = 0;
@@ -46,6 +50,12 @@ void CollisionEngine::Run()
 		++i;
 	}
 
+	METRIC_COUNTER_ADD("collision.objects_tested", objects.size());
+
+	// Counted here and added once, the counters are atomics.
+	uint64_t pairsTested = 0;
+	uint64_t pairsCulled = 0;
+
 	for (size_t objIdx1 = 0; objIdx1 < objects.size(); ++objIdx1)
 	{
 		bool object1Dynamic = objects[objIdx1]->IsObjectDynamic();
@@ -68,6 +78,8 @@ void CollisionEngine::Run()
 				continue;
 			}
 
+			++pairsTested;
+
 			glm::vec3 center2 =
 				objects[objIdx2]->GetObjectCenter();
 			float radius2 =
@@ -82,6 +94,7 @@ void CollisionEngine::Run()
 				glm::length(center2World - center1World);
 
 			if (distance > radius1 + radius2) {
+				++pairsCulled;
 				continue;
 			}
 
@@ -102,6 +115,9 @@ void CollisionEngine::Run()
 		}
 	}
 
+	METRIC_COUNTER_ADD("collision.pairs_tested", pairsTested);
+	METRIC_COUNTER_ADD("collision.pairs_culled", pairsCulled);
+
 	_threadPool->Wait();
 }
 
@@ -0,0 +1,264 @@
+// Time of the image transforms on a 4096x4096 RGBA8 image, against the
+// byte at a time loops ImageHelper had before. Every result is checked
+// against the old loops. Rotate, flip and swap have no caller in the game
+// since SkyboxToCube orients the faces itself, they are kept for tools.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../Utils/ImageTransform.h"
+#include "../Logger/logger.h"
+
+#define BENCH_SIZE 4096
+
+namespace Baseline
+{
+	void RotateClockWise(uint8_t* image, uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> buffer((size_t)width * height * 4);
+
+		for (uint32_t y = 0; y < height; ++y) {
+			for (uint32_t x = 0; x < width; ++x) {
+				for (uint32_t c = 0; c < 4; ++c) {
+					buffer[((size_t)height * x + height -
+						1 - y) * 4 + c] =
+					image[((size_t)width * y + x) * 4 + c];
+				}
+			}
+		}
+
+		memcpy(image, buffer.data(), buffer.size());
+	}
+
+	void RotateCounterClockWise(
+		uint8_t* image,
+		uint32_t width,
+		uint32_t height)
+	{
+		std::vector<uint8_t> buffer((size_t)width * height * 4);
+
+		for (uint32_t y = 0; y < height; ++y) {
+			for (uint32_t x = 0; x < width; ++x) {
+				for (uint32_t c = 0; c < 4; ++c) {
+					buffer[((size_t)height *
+						(width - 1 - x) + y) * 4 + c] =
+					image[((size_t)width * y + x) * 4 + c];
+				}
+			}
+		}
+
+		memcpy(image, buffer.data(), buffer.size());
+	}
+
+	void FlipVertically(uint8_t* image, uint32_t width, uint32_t height)
+	{
+		for (uint32_t y = 0; y < height / 2; ++y) {
+			for (uint32_t x = 0; x < width; ++x) {
+				for (uint32_t c = 0; c < 4; ++c) {
+					size_t up = ((size_t)width * y + x) *
+						4 + c;
+					size_t down = ((size_t)width *
+						(height - 1 - y) + x) * 4 + c;
+
+					std::swap(image[up], image[down]);
+				}
+			}
+		}
+	}
+
+	void FlipHorizontally(uint8_t* image, uint32_t width, uint32_t height)
+	{
+		for (uint32_t y = 0; y < height; ++y) {
+			for (uint32_t x = 0; x < width / 2; ++x) {
+				for (uint32_t c = 0; c < 4; ++c) {
+					size_t left = ((size_t)width * y + x) *
+						4 + c;
+					size_t right = ((size_t)width * y +
+						width - 1 - x) * 4 + c;
+
+					std::swap(image[left], image[right]);
+				}
+			}
+		}
+	}
+
+	void Swap(
+		uint8_t* image1,
+		uint8_t* image2,
+		uint32_t width,
+		uint32_t height)
+	{
+		std::vector<uint8_t> buffer((size_t)width * height * 4);
+
+		memcpy(buffer.data(), image1, buffer.size());
+		memcpy(image1, image2, buffer.size());
+		memcpy(image2, buffer.data(), buffer.size());
+	}
+}
+
+// Runs transform on a fresh copy of source, best of three runs in
+// milliseconds. The copy is not timed.
+static double Time(
+	const std::vector<uint8_t>& source,
+	std::vector<uint8_t>& image,
+	std::function<void(uint8_t* image)> transform)
+{
+	double best = 0.0;
+
+	for (uint32_t repeat = 0; repeat < 3; ++repeat) {
+		image = source;
+
+		auto start = std::chrono::steady_clock::now();
+		transform(image.data());
+		auto end = std::chrono::steady_clock::now();
+
+		double ms = std::chrono::duration<double, std::milli>(
+			end - start).count();
+
+		best = repeat == 0 ? ms : std::min(best, ms);
+	}
+
+	return best;
+}
+
+static void Bench(
+	std::string name,
+	const std::vector<uint8_t>& source,
+	std::function<void(uint8_t* image)> transform,
+	std::function<void(uint8_t* image)> baseline)
+{
+	std::vector<uint8_t> result;
+	std::vector<uint8_t> expected;
+
+	double current = Time(source, result, transform);
+	double old = Time(source, expected, baseline);
+
+	if (result != expected) {
+		throw std::runtime_error(name + " differs from the old loop.");
+	}
+
+	std::cout << name << ", " << current << ", " << old << std::endl;
+}
+
+int main()
+{
+	const uint32_t size = BENCH_SIZE;
+
+	std::vector<uint8_t> source((size_t)size * size * 4);
+	std::mt19937 random(1);
+
+	for (auto& byte : source) {
+		byte = random();
+	}
+
+	std::vector<uint8_t> out(source.size());
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "transform " << size << "x" << size <<
+		", ms, byte loop ms" << std::endl;
+
+	try {
+		Bench("rotate cw", source,
+			[size](uint8_t* image) -> void
+		{
+			ImageTransform::RotateClockWise(image, size, size);
+		},
+			[size](uint8_t* image) -> void
+		{
+			Baseline::RotateClockWise(image, size, size);
+		});
+
+		Bench("rotate cw, out of place", source,
+			[size, &out](uint8_t* image) -> void
+		{
+			ImageTransform::RotateClockWise(
+				image,
+				out.data(),
+				size,
+				size);
+			memcpy(image, out.data(), out.size());
+		},
+			[size](uint8_t* image) -> void
+		{
+			Baseline::RotateClockWise(image, size, size);
+		});
+
+		Bench("rotate ccw", source,
+			[size](uint8_t* image) -> void
+		{
+			ImageTransform::RotateCounterClockWise(
+				image,
+				size,
+				size);
+		},
+			[size](uint8_t* image) -> void
+		{
+			Baseline::RotateCounterClockWise(image, size, size);
+		});
+
+		Bench("rotate cw, 4096x2048", source,
+			[size](uint8_t* image) -> void
+		{
+			ImageTransform::RotateClockWise(image, size, size / 2);
+		},
+			[size](uint8_t* image) -> void
+		{
+			Baseline::RotateClockWise(image, size, size / 2);
+		});
+
+		Bench("flip vertically", source,
+			[size](uint8_t* image) -> void
+		{
+			ImageTransform::FlipVertically(image, size, size);
+		},
+			[size](uint8_t* image) -> void
+		{
+			Baseline::FlipVertically(image, size, size);
+		});
+
+		Bench("flip horizontally", source,
+			[size](uint8_t* image) -> void
+		{
+			ImageTransform::FlipHorizontally(image, size, size);
+		},
+			[size](uint8_t* image) -> void
+		{
+			Baseline::FlipHorizontally(image, size, size);
+		});
+
+		// The top half swapped with the bottom half.
+		Bench("swap, 4096x2048 halves", source,
+			[size](uint8_t* image) -> void
+		{
+			ImageTransform::Swap(
+				image,
+				image + (size_t)size * size * 2,
+				size,
+				size / 2);
+		},
+			[size](uint8_t* image) -> void
+		{
+			Baseline::Swap(
+				image,
+				image + (size_t)size * size * 2,
+				size,
+				size / 2);
+		});
+	} catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		Logger::Flush();
+		return 1;
+	}
+
+	Logger::Flush();
+
+	return 0;
+}
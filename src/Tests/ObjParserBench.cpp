@@ -0,0 +1,208 @@
+// OBJ parse time of the bundled sword and of a synthetic grid of several
+// million triangles, written next to the benchmark first. ObjParser is
+// run serially and split over a thread pool. On the sword it is compared
+// against the TextFileParser and std::stof loop Loader used before, the
+// synthetic mesh is too large for that one.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Utils/ObjParser.h"
+#include "../Utils/TextFileParser.h"
+#include "../Utils/ThreadPool.h"
+#include "../Logger/logger.h"
+
+#define BENCH_SWORD "../Assets/Resources/Models/sword.obj"
+#define BENCH_SYNTHETIC "../../build/Tests/synthetic.obj"
+// Quads per side of the synthetic grid, two triangles each.
+#define BENCH_GRID 1200
+
+// The parse Loader::LoadModel did before ObjParser, without the weld.
+static size_t ParseTextFile(std::string path)
+{
+	auto file = TextFileParser::ParseFile(path, {' ', '/'});
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::vec3> normals;
+	std::vector<ObjParser::Corner> corners;
+
+	for (auto& line : file) {
+		if (line[0] == "v") {
+			positions.push_back(glm::vec3(
+				std::stof(line[1]),
+				std::stof(line[2]),
+				std::stof(line[3])));
+		} else if (line[0] == "vt") {
+			texCoords.push_back(glm::vec2(
+				std::stof(line[1]),
+				1.0 - std::stof(line[2])));
+		} else if (line[0] == "vn") {
+			normals.push_back(glm::vec3(
+				std::stof(line[1]),
+				std::stof(line[2]),
+				std::stof(line[3])));
+		} else if (line[0] == "f") {
+			for (uint32_t i = 1; i < 10; i += 3) {
+				corners.push_back({
+					(uint32_t)std::stoi(line[i]) - 1,
+					(uint32_t)std::stoi(line[i + 1]) - 1,
+					(uint32_t)std::stoi(line[i + 2]) - 1});
+			}
+		}
+	}
+
+	return corners.size() / 3;
+}
+
+// Height field over a square grid, every corner as v/vt/vn.
+static void WriteSynthetic(std::string path)
+{
+	FILE* file = fopen(path.c_str(), "w");
+
+	if (!file) {
+		throw std::runtime_error("Failed to create " + path);
+	}
+
+	uint32_t side = BENCH_GRID + 1;
+
+	for (uint32_t y = 0; y < side; ++y) {
+		for (uint32_t x = 0; x < side; ++x) {
+			fprintf(file, "v %f %f %f\n",
+				x * 0.01f,
+				y * 0.01f,
+				((x * 7 + y * 13) % 100) * 0.001f);
+		}
+	}
+
+	for (uint32_t y = 0; y < side; ++y) {
+		for (uint32_t x = 0; x < side; ++x) {
+			fprintf(file, "vt %f %f\n",
+				(float)x / BENCH_GRID,
+				(float)y / BENCH_GRID);
+		}
+	}
+
+	fprintf(file, "vn 0.000000 0.000000 1.000000\n");
+
+	for (uint32_t y = 0; y < BENCH_GRID; ++y) {
+		for (uint32_t x = 0; x < BENCH_GRID; ++x) {
+			uint32_t a = y * side + x + 1;
+			uint32_t b = a + 1;
+			uint32_t c = a + side;
+			uint32_t d = c + 1;
+
+			fprintf(file, "f %u/%u/1 %u/%u/1 %u/%u/1\n",
+				a, a, b, b, d, d);
+			fprintf(file, "f %u/%u/1 %u/%u/1 %u/%u/1\n",
+				a, a, d, d, c, c);
+		}
+	}
+
+	if (fclose(file) != 0) {
+		throw std::runtime_error("Failed to write " + path);
+	}
+}
+
+// Best of repeats, in milliseconds per call.
+static double Time(
+	std::function<size_t()> parse,
+	uint32_t calls,
+	size_t& triangles)
+{
+	double best = 0.0;
+
+	for (uint32_t repeat = 0; repeat < 3; ++repeat) {
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < calls; ++i) {
+			triangles = parse();
+		}
+
+		auto end = std::chrono::steady_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(
+			end - start).count() / calls;
+
+		best = repeat == 0 ? ms : std::min(best, ms);
+	}
+
+	return best;
+}
+
+static void Bench(
+	std::string name,
+	std::string path,
+	uint32_t calls,
+	ThreadPool* threadPool,
+	bool baseline)
+{
+	size_t triangles;
+
+	double serial = Time([&path]() -> size_t
+	{
+		return ObjParser::ParseFile(path).Corners.size() / 3;
+	}, calls, triangles);
+
+	double parallel = Time([&path, threadPool]() -> size_t
+	{
+		return ObjParser::ParseFile(path, threadPool).Corners.size() /
+			3;
+	}, calls, triangles);
+
+	std::cout << name << ", " << triangles << ", " <<
+		serial << ", " << parallel << ", ";
+
+	if (baseline) {
+		size_t baselineTriangles;
+
+		std::cout << Time([&path]() -> size_t
+		{
+			return ParseTextFile(path);
+		}, calls, baselineTriangles);
+
+		if (baselineTriangles != triangles) {
+			throw std::runtime_error("Triangle counts differ.");
+		}
+	} else {
+		std::cout << "-";
+	}
+
+	std::cout << std::endl;
+}
+
+int main()
+{
+	uint32_t threadCount =
+		std::max(std::thread::hardware_concurrency(), 1u);
+
+	try {
+		WriteSynthetic(BENCH_SYNTHETIC);
+
+		ThreadPool threadPool(threadCount);
+
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << "mesh, triangles, serial ms, " << threadCount <<
+			" threads ms, textfileparser ms" << std::endl;
+
+		Bench("sword", BENCH_SWORD, 200, &threadPool, true);
+		Bench("synthetic", BENCH_SYNTHETIC, 1, &threadPool, false);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		remove(BENCH_SYNTHETIC);
+		Logger::Flush();
+		return 1;
+	}
+
+	remove(BENCH_SYNTHETIC);
+	Logger::Flush();
+
+	return 0;
+}
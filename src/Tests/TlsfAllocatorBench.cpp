@@ -0,0 +1,234 @@
+// Allocate and free throughput of page sub-allocation, TLSF against the
+// first fit scan over a sector bitmap that MemoryManager used before.
+// Pages are host buffers standing in for device memory, every range is
+// written to once so both allocators hand out usable memory.
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../VideoEngine/TlsfAllocator.h"
+
+#define BENCH_PAGE_SIZE (16 * 1024 * 1024)
+#define BENCH_ALIGNMENT 256
+#define BENCH_CHURN 5000
+
+// Host memory in place of vkAllocateMemory.
+class MockBackingStore
+{
+public:
+	~MockBackingStore()
+	{
+		for (auto page : _pages) {
+			delete[] page;
+		}
+	}
+
+	uint32_t AddPage()
+	{
+		_pages.push_back(new uint8_t[BENCH_PAGE_SIZE]);
+
+		return _pages.size() - 1;
+	}
+
+	void Touch(uint32_t page, uint32_t offset, uint32_t size)
+	{
+		_pages[page][offset] = 1;
+		_pages[page][offset + size - 1] = 1;
+	}
+
+	uint32_t GetPageCount()
+	{
+		return _pages.size();
+	}
+
+private:
+	std::vector<uint8_t*> _pages;
+};
+
+struct Range
+{
+	uint32_t Page;
+	uint32_t Offset;
+	uint32_t Size;
+	uint32_t Block;
+};
+
+class TlsfPages
+{
+public:
+	TlsfPages(MockBackingStore* store)
+	{
+		_store = store;
+	}
+
+	~TlsfPages()
+	{
+		for (auto allocator : _allocators) {
+			delete allocator;
+		}
+	}
+
+	Range Allocate(uint32_t size)
+	{
+		Range range{0, 0, size, TlsfAllocator::NoBlock};
+
+		for (; range.Page < _allocators.size(); ++range.Page) {
+			range.Block = _allocators[range.Page]->Allocate(
+				size,
+				range.Offset);
+
+			if (range.Block != TlsfAllocator::NoBlock) {
+				break;
+			}
+		}
+
+		if (range.Block == TlsfAllocator::NoBlock) {
+			range.Page = _store->AddPage();
+			_allocators.push_back(new TlsfAllocator(
+				BENCH_PAGE_SIZE,
+				BENCH_ALIGNMENT));
+			range.Block = _allocators.back()->Allocate(
+				size,
+				range.Offset);
+		}
+
+		_store->Touch(range.Page, range.Offset, size);
+
+		return range;
+	}
+
+	void Free(const Range& range)
+	{
+		_allocators[range.Page]->Free(range.Block);
+	}
+
+private:
+	MockBackingStore* _store;
+	std::vector<TlsfAllocator*> _allocators;
+};
+
+// The sector scan of the former MemoryManager::Allocate and Free.
+class BitmapPages
+{
+public:
+	BitmapPages(MockBackingStore* store)
+	{
+		_store = store;
+	}
+
+	Range Allocate(uint32_t size)
+	{
+		uint32_t required = (size - 1) / BENCH_ALIGNMENT + 1;
+
+		for (uint32_t page = 0; page < _sectors.size(); ++page) {
+			uint32_t span = 0;
+
+			for (uint32_t i = 0; i < SectorCount; ++i) {
+				span = _sectors[page][i] ? 0 : span + 1;
+
+				if (span == required) {
+					uint32_t first = i + 1 - required;
+
+					return Take(page, first, size);
+				}
+			}
+		}
+
+		_store->AddPage();
+		_sectors.emplace_back(SectorCount, false);
+
+		return Take(_sectors.size() - 1, 0, size);
+	}
+
+	void Free(const Range& range)
+	{
+		uint32_t first = range.Offset / BENCH_ALIGNMENT;
+		uint32_t count = (range.Size - 1) / BENCH_ALIGNMENT + 1;
+
+		for (uint32_t i = first; i < first + count; ++i) {
+			_sectors[range.Page][i] = false;
+		}
+	}
+
+private:
+	static const uint32_t SectorCount = BENCH_PAGE_SIZE / BENCH_ALIGNMENT;
+
+	MockBackingStore* _store;
+	std::vector<std::vector<bool>> _sectors;
+
+	Range Take(uint32_t page, uint32_t first, uint32_t size)
+	{
+		uint32_t count = (size - 1) / BENCH_ALIGNMENT + 1;
+
+		for (uint32_t i = first; i < first + count; ++i) {
+			_sectors[page][i] = true;
+		}
+
+		Range range{page, first * BENCH_ALIGNMENT, size, 0};
+		_store->Touch(range.Page, range.Offset, size);
+
+		return range;
+	}
+};
+
+// Fills up to live ranges, then frees a random one and allocates a new
+// one BENCH_CHURN times. Returns nanoseconds per allocate and free pair.
+template <typename Pages>
+double Churn(uint32_t live, uint32_t& pages)
+{
+	std::mt19937 random(live);
+	MockBackingStore store;
+	Pages allocator(&store);
+
+	auto getSize = [&random]() {
+		return 256 + random() % (8 * 1024);
+	};
+
+	std::vector<Range> ranges;
+
+	for (uint32_t i = 0; i < live; ++i) {
+		ranges.push_back(allocator.Allocate(getSize()));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t i = 0; i < BENCH_CHURN; ++i) {
+		Range& range = ranges[random() % ranges.size()];
+
+		allocator.Free(range);
+		range = allocator.Allocate(getSize());
+	}
+
+	auto end = std::chrono::steady_clock::now();
+
+	pages = store.GetPageCount();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() /
+		BENCH_CHURN;
+}
+
+int main()
+{
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "live ranges, tlsf ns/pair (pages), " <<
+		"bitmap ns/pair (pages)" << std::endl;
+
+	for (uint32_t live : {1000, 10000, 20000}) {
+		uint32_t tlsfPages;
+		uint32_t bitmapPages;
+
+		double tlsf = Churn<TlsfPages>(live, tlsfPages);
+		double bitmap = Churn<BitmapPages>(live, bitmapPages);
+
+		std::cout << live << ", " <<
+			tlsf << " (" << tlsfPages << "), " <<
+			bitmap << " (" << bitmapPages << ")" << std::endl;
+	}
+
+	return 0;
+}
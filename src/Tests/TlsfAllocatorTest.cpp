@@ -0,0 +1,254 @@
+// Random allocate and free sequences checked against a reference model
+// of the live intervals. Every live range is tagged in a host buffer with
+// an entry per granule standing in for the device memory, overlapping
+// ranges show up as a clobbered tag when the range is freed.
+
+#include <bit>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../VideoEngine/TlsfAllocator.h"
+
+#define TLSF_TEST_SEEDS 200
+#define TLSF_TEST_OPERATIONS 5000
+
+struct Interval
+{
+	uint32_t End;
+	uint32_t Block;
+	uint8_t Tag;
+};
+
+class TlsfAllocatorTest
+{
+public:
+	TlsfAllocatorTest(uint32_t seed)
+	{
+		_seed = seed;
+		_random.seed(seed);
+		_operation = 0;
+
+		static const uint32_t granularities[] = {1, 16, 256, 4096};
+
+		_granularity = granularities[_random() % 4];
+		_size = _granularity * (256 + _random() % 4096);
+		_allocator = new TlsfAllocator(_size, _granularity);
+		_store.assign(_size / _granularity, 0);
+		_used = 0;
+	}
+
+	~TlsfAllocatorTest()
+	{
+		delete _allocator;
+	}
+
+	void Run()
+	{
+		for (; _operation < TLSF_TEST_OPERATIONS; ++_operation) {
+			if (_live.empty() || _random() % 100 < 55) {
+				Allocate();
+			} else {
+				FreeRandom();
+			}
+
+			Check(
+				_allocator->GetFreeSize() == _size - _used,
+				"free size does not match the model");
+		}
+
+		while (!_live.empty()) {
+			Free(_live.begin());
+		}
+
+		Check(_allocator->IsEmpty(), "not empty after freeing all");
+
+		uint32_t offset = UINT32_MAX;
+		uint32_t block = _allocator->Allocate(_size, offset);
+
+		Check(
+			block != TlsfAllocator::NoBlock && offset == 0,
+			"free ranges were not merged back into one");
+
+		_allocator->Free(block);
+
+		bool thrown = false;
+
+		try {
+			_allocator->Free(block);
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+
+		Check(thrown, "double free was not detected");
+	}
+
+private:
+	uint32_t _seed;
+	uint32_t _operation;
+	std::mt19937 _random;
+
+	uint32_t _size;
+	uint32_t _granularity;
+	TlsfAllocator* _allocator;
+
+	// Offset to the interval allocated there.
+	std::map<uint32_t, Interval> _live;
+	std::vector<uint8_t> _store;
+	uint64_t _used;
+
+	void Check(bool condition, const char* message)
+	{
+		if (!condition) {
+			throw std::runtime_error(
+				"seed " + std::to_string(_seed) +
+				", operation " + std::to_string(_operation) +
+				": " + message);
+		}
+	}
+
+	// Mostly small requests, some large enough to fail now and then.
+	uint32_t GetRequestSize()
+	{
+		switch (_random() % 8) {
+		case 0:
+			return 1 + _random() % (_size / 4);
+		case 1:
+			return _granularity * (1 + _random() % 4);
+		default:
+			return 1 + _random() % (_granularity * 64);
+		}
+	}
+
+	void Allocate()
+	{
+		uint32_t size = GetRequestSize();
+		uint64_t granules = (size + (uint64_t)_granularity - 1) /
+			_granularity;
+
+		uint32_t offset;
+		uint32_t block = _allocator->Allocate(size, offset);
+
+		if (block == TlsfAllocator::NoBlock) {
+			Check(
+				GetLargestGap() < GetGuaranteedFit(granules),
+				"allocation failed with a fitting free range");
+			return;
+		}
+
+		uint32_t end = offset + granules * _granularity;
+
+		Check(offset % _granularity == 0, "offset is not aligned");
+		Check(end <= _size, "range ends past the allocator size");
+
+		auto next = _live.lower_bound(offset);
+
+		if (next != _live.end()) {
+			Check(next->first >= end, "overlaps the next range");
+		}
+
+		if (next != _live.begin()) {
+			Check(
+				std::prev(next)->second.End <= offset,
+				"overlaps the previous range");
+		}
+
+		uint8_t tag = 1 + _random() % 255;
+
+		std::fill(
+			_store.begin() + offset / _granularity,
+			_store.begin() + end / _granularity,
+			tag);
+
+		_live[offset] = Interval{end, block, tag};
+		_used += end - offset;
+	}
+
+	void FreeRandom()
+	{
+		auto interval = _live.lower_bound(_random() % _size);
+
+		if (interval == _live.end()) {
+			interval = _live.begin();
+		}
+
+		Free(interval);
+	}
+
+	void Free(std::map<uint32_t, Interval>::iterator interval)
+	{
+		uint32_t offset = interval->first;
+		Interval& live = interval->second;
+
+		auto first = _store.begin() + offset / _granularity;
+		auto last = _store.begin() + live.End / _granularity;
+
+		Check(
+			std::count(first, last, live.Tag) == last - first,
+			"range was overwritten");
+		std::fill(first, last, 0);
+
+		_allocator->Free(live.Block);
+		_used -= live.End - offset;
+		_live.erase(interval);
+	}
+
+	// In granules.
+	uint64_t GetLargestGap()
+	{
+		uint64_t largest = 0;
+		uint32_t start = 0;
+
+		for (auto& live : _live) {
+			largest = std::max<uint64_t>(
+				largest,
+				live.first - start);
+			start = live.second.End;
+		}
+
+		largest = std::max<uint64_t>(largest, _size - start);
+
+		return largest / _granularity;
+	}
+
+	// Free ranges at least this large are always found: the request is
+	// rounded up to the next size class and any block of that class or
+	// above fits it.
+	static uint64_t GetGuaranteedFit(uint64_t granules)
+	{
+		if (granules < 32) {
+			return granules;
+		}
+
+		uint32_t shift = std::bit_width(granules) - 1 - 5;
+		uint64_t rounded = granules + (1ull << shift) - 1;
+
+		shift = std::bit_width(rounded) - 1 - 5;
+
+		return rounded >> shift << shift;
+	}
+};
+
+int main()
+{
+	try {
+		for (uint32_t seed = 1; seed <= TLSF_TEST_SEEDS; ++seed) {
+			TlsfAllocatorTest test(seed);
+			test.Run();
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "TlsfAllocatorTest failed, " << e.what() <<
+			std::endl;
+		return 1;
+	}
+
+	std::cout << "TlsfAllocatorTest passed, " << TLSF_TEST_SEEDS <<
+		" seeds of " << TLSF_TEST_OPERATIONS << " operations" <<
+		std::endl;
+
+	return 0;
+}
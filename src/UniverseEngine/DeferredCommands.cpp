@@ -0,0 +1,26 @@
+#include "DeferredCommands.h"
+
+DeferredCommands::DeferredCommands(uint32_t bufferCount)
+{
+	_buffers.resize(bufferCount);
+}
+
+DeferredCommands::~DeferredCommands()
+{
+}
+
+void DeferredCommands::Record(uint32_t buffer, Command command)
+{
+	_buffers[buffer].push_back(command);
+}
+
+void DeferredCommands::Apply()
+{
+	for (auto& buffer : _buffers) {
+		for (auto& command : buffer) {
+			command();
+		}
+
+		buffer.clear();
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef _DEFERRED_COMMANDS_H
+#define _DEFERRED_COMMANDS_H
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+// One command list per pool thread. Each thread only appends to its own
+// list, so recording needs no locking. Apply() must be called while no
+// thread records, it runs the lists in thread index order.
+class DeferredCommands
+{
+public:
+	typedef std::function<void()> Command;
+
+	DeferredCommands(uint32_t bufferCount);
+	~DeferredCommands();
+
+	void Record(uint32_t buffer, Command command);
+	void Apply();
+
+private:
+	std::vector<std::vector<Command>> _buffers;
+};
+
+#endif
@@ -1,32 +1,92 @@
 #include "universe.h"
 
+#include <stdexcept>
+
 #include "../Logger/logger.h"
+#include "../Utils/Profiler.h"
+#include "../Utils/Metrics.h"
+
+thread_local Universe* Universe::_tickingUniverse = nullptr;
 
 Universe::Universe(uint32_t tickDelayMS)
 {
 	_sceneMutex = nullptr;
 	_tickDelayMS = tickDelayMS;
+	_tickIndex = 0;
 	_threadPool = new ThreadPool(3);
+	_deferredCommands = new DeferredCommands(
+		_threadPool->GetThreadCount());
+
+	CreateTickGroup(1, TickPriority::PostPhysics);
 
-	Logger::Verbose() << "Universe created.";
+	LOG_VERBOSE << "Universe created.";
 }
 
 Universe::~Universe()
 {
 	delete _threadPool;
+	delete _deferredCommands;
 	_sceneMutex = nullptr;
-	Logger::Verbose() << "Universe destroyed.";
+	LOG_VERBOSE << "Universe destroyed.";
 }
 
-void Universe::RegisterActor(Actor* actor)
+uint32_t Universe::CreateTickGroup(uint32_t divisor, TickPriority priority)
 {
+	if (divisor == 0) {
+		throw std::runtime_error(
+			"Tick group divisor must be positive.");
+	}
+
+	TickGroup group;
+	group.Divisor = divisor;
+	group.Priority = priority;
+	group.NextPhase = 0;
+
 	_actorMutex.lock();
-	_actors.insert(actor);
+	_tickGroups.push_back(group);
+	uint32_t index = _tickGroups.size() - 1;
+	_actorMutex.unlock();
+
+	return index;
+}
+
+void Universe::RegisterActor(Actor* actor, uint32_t tickGroup)
+{
+	if (_tickingUniverse == this) {
+		Defer([this, actor, tickGroup]() -> void
+		{
+			RegisterActor(actor, tickGroup);
+		});
+
+		return;
+	}
+
+	_actorMutex.lock();
+
+	if (tickGroup >= _tickGroups.size()) {
+		_actorMutex.unlock();
+		throw std::runtime_error("Invalid tick group.");
+	}
+
+	TickGroup& group = _tickGroups[tickGroup];
+
+	ActorDescriptor descriptor;
+	descriptor.TickGroup = tickGroup;
+	descriptor.Phase = group.NextPhase;
+
+	group.NextPhase = (group.NextPhase + 1) % group.Divisor;
+
+	_actors[actor] = descriptor;
 	_actorMutex.unlock();
 }
 
 void Universe::RemoveActor(Actor* actor)
 {
+	if (_tickingUniverse == this) {
+		Defer([this, actor]() -> void {RemoveActor(actor);});
+		return;
+	}
+
 	_actorMutex.lock();
 	_actors.erase(actor);
 	_actorMutex.unlock();
@@ -34,6 +94,15 @@ void Universe::RemoveActor(Actor* actor)
 
 void Universe::RegisterCollisionEngine(CollisionEngine* engine)
 {
+	if (_tickingUniverse == this) {
+		Defer([this, engine]() -> void
+		{
+			RegisterCollisionEngine(engine);
+		});
+
+		return;
+	}
+
 	_collisionMutex.lock();
 	_collisionEngines.insert(engine);
 	_collisionMutex.unlock();
@@ -41,6 +110,15 @@ void Universe::RegisterCollisionEngine(CollisionEngine* engine)
 
 void Universe::RemoveCollisionEngine(CollisionEngine* engine)
 {
+	if (_tickingUniverse == this) {
+		Defer([this, engine]() -> void
+		{
+			RemoveCollisionEngine(engine);
+		});
+
+		return;
+	}
+
 	_collisionMutex.lock();
 	_collisionEngines.erase(engine);
 	_collisionMutex.unlock();
@@ -50,47 +128,45 @@ void Universe::MainLoop()
 {
 	_work = true;
 
+	Profiler::SetThreadName("Universe");
+
 	while (_work)
 	{
 		auto start = std::chrono::high_resolution_clock::now();
 
-		_collisionMutex.lock();
-		for (CollisionEngine* engine : _collisionEngines) {
-			engine->Run();
-		}
-
-		_collisionMutex.unlock();
+		{
+			PROFILE_ZONE("Universe::Tick");
 
-		_actorMutex.lock();
+			TickActors(TickPriority::PrePhysics);
 
-		if (_sceneMutex) {
-			_sceneMutex->lock();
-		}
+			_collisionMutex.lock();
+			for (CollisionEngine* engine : _collisionEngines) {
+				engine->Run();
+			}
 
-		for (Actor* actor : _actors) {
-			_threadPool->Enqueue(
-				[actor]() -> void {actor->Tick();});
-		}
+			_collisionMutex.unlock();
 
-		_threadPool->Wait();
+			TickActors(TickPriority::PostPhysics);
 
-		if (_sceneMutex) {
-			_sceneMutex->unlock();
+			++_tickIndex;
 		}
 
-		_actorMutex.unlock();
-
 		auto stop = std::chrono::high_resolution_clock::now();
 
 		uint32_t spentTimeMS =
 			std::chrono::duration_cast<std::chrono::milliseconds>(
 				stop - start).count();
 
+		METRIC_HISTOGRAM_RECORD(
+			"universe.tick_us",
+			std::chrono::duration_cast<std::chrono::microseconds>(
+				stop - start).count());
+
 		if (_tickDelayMS > spentTimeMS) {
 			uint32_t timeToSleepMS = _tickDelayMS - spentTimeMS;
 
 			if (timeToSleepMS < _tickDelayMS / 4) {
-				Logger::Warning() << "Delay " <<
+				LOG_WARNING << "Delay " <<
 					_tickDelayMS <<
 					". Sleeping " <<
 					timeToSleepMS << " ms.";
@@ -99,12 +175,73 @@ void Universe::MainLoop()
 			std::this_thread::sleep_for(
 				std::chrono::milliseconds(timeToSleepMS));
 		} else {
-			Logger::Warning() <<
+			METRIC_COUNTER_ADD("universe.tick_overruns", 1);
+			LOG_WARNING <<
 				"Tick processing took tick delay.";
 		}
 	}
 }
 
+void Universe::Defer(DeferredCommands::Command command)
+{
+	Universe* universe = _tickingUniverse;
+	int32_t threadIndex = ThreadPool::GetThreadIndex();
+
+	if (!universe || threadIndex < 0) {
+		command();
+		return;
+	}
+
+	universe->_deferredCommands->Record(threadIndex, command);
+}
+
+void Universe::TickActors(TickPriority priority)
+{
+	_actorMutex.lock();
+
+	for (auto& actor : _actors) {
+		const TickGroup& group = _tickGroups[actor.second.TickGroup];
+
+		if (group.Priority != priority) {
+			continue;
+		}
+
+		if (_tickIndex % group.Divisor != actor.second.Phase) {
+			continue;
+		}
+
+		Actor* actorPtr = actor.first;
+
+		_threadPool->Enqueue(
+			[this, actorPtr]() -> void
+		{
+			PROFILE_ZONE("Actor::Tick");
+			_tickingUniverse = this;
+			actorPtr->Tick();
+			_tickingUniverse = nullptr;
+		});
+	}
+
+	_threadPool->Wait();
+
+	_actorMutex.unlock();
+
+	// Ticks above ran without the scene mutex, this is the only point
+	// where their results become visible to the renderer.
+	if (_sceneMutex) {
+		_sceneMutex->lock();
+	}
+
+	{
+		PROFILE_ZONE("Universe::ApplyDeferred");
+		_deferredCommands->Apply();
+	}
+
+	if (_sceneMutex) {
+		_sceneMutex->unlock();
+	}
+}
+
 void Universe::Stop()
 {
 	_work = false;
@@ -2,21 +2,43 @@
 #define _UNIVERSE_H
 
 #include <set>
+#include <map>
+#include <vector>
 #include <chrono>
 #include <mutex>
 #include <thread>
 
 #include "../Utils/ThreadPool.h"
 #include "actor.h"
+#include "DeferredCommands.h"
 #include "../PhysicalEngine/CollisionEngine.h"
 
 class Universe
 {
 public:
+	// Tick groups run either before or after collision engines.
+	enum class TickPriority
+	{
+		PrePhysics = 0,
+		PostPhysics = 1
+	};
+
+	// Group 0 always exists: every tick, after physics.
+	static const uint32_t DefaultTickGroup = 0;
+
 	Universe(uint32_t tickDelayMS);
 	~Universe();
 
-	void RegisterActor(Actor* actor);
+	// Actors of a group with divisor N tick every N-th universe tick.
+	// Phases are assigned round-robin, so actors of one group are
+	// spread over N consecutive ticks instead of running together.
+	uint32_t CreateTickGroup(
+		uint32_t divisor,
+		TickPriority priority = TickPriority::PostPhysics);
+
+	void RegisterActor(
+		Actor* actor,
+		uint32_t tickGroup = DefaultTickGroup);
 	void RemoveActor(Actor* actor);
 
 	void RegisterCollisionEngine(CollisionEngine* engine);
@@ -30,12 +52,33 @@ public:
 		_sceneMutex = mutex;
 	}
 
+	// Called from Actor::Tick, records the command into the buffer of
+	// the calling pool thread. All recorded commands are applied under
+	// the scene mutex once every actor of the tick phase has finished.
+	// Outside of a tick the command is executed immediately.
+	static void Defer(DeferredCommands::Command command);
+
 private:
+	struct TickGroup
+	{
+		uint32_t Divisor;
+		TickPriority Priority;
+		uint32_t NextPhase;
+	};
+
+	struct ActorDescriptor
+	{
+		uint32_t TickGroup;
+		uint32_t Phase;
+	};
+
 	uint32_t _tickDelayMS;
+	uint64_t _tickIndex;
 
 	std::mutex* _sceneMutex;
 
-	std::set<Actor*> _actors;
+	std::map<Actor*, ActorDescriptor> _actors;
+	std::vector<TickGroup> _tickGroups;
 	std::mutex _actorMutex;
 
 	std::set<CollisionEngine*> _collisionEngines;
@@ -44,6 +87,11 @@ private:
 	bool _work;
 
 	ThreadPool* _threadPool;
+	DeferredCommands* _deferredCommands;
+
+	static thread_local Universe* _tickingUniverse;
+
+	void TickActors(TickPriority priority);
 };
 
 #endif
@@ -0,0 +1,172 @@
+#include "CookedAssets.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <mutex>
+
+#include "MappedFile.h"
+#include "../Logger/logger.h"
+
+namespace fs = std::filesystem;
+
+namespace CookedAssets
+{
+	static const char* TypeNames[] = {"mesh", "texture", "cubemap"};
+
+	static std::mutex Mutex;
+	static std::string SourceRoot = "../src/Assets/Resources";
+	static std::string CookedRoot = "../build/cooked";
+	static bool Loaded = false;
+	static std::map<std::string, ManifestEntry> Manifest;
+
+	// One header line, then one tab separated line per cooked source:
+	//   type size mtime source output
+	std::map<std::string, ManifestEntry> ReadManifest(
+		std::string cookedRoot)
+	{
+		std::map<std::string, ManifestEntry> manifest;
+		std::ifstream in(fs::path(cookedRoot) / ManifestName);
+
+		if (!in.is_open()) {
+			return manifest;
+		}
+
+		std::string line;
+		std::getline(in, line);
+
+		if (line != "assetcook " + std::to_string(ManifestVersion)) {
+			LOG_WARNING << "Cooked assets in " << cookedRoot <<
+				" are of another version.";
+			return manifest;
+		}
+
+		while (std::getline(in, line)) {
+			std::istringstream fields(line);
+			std::string type, size, time;
+			ManifestEntry entry;
+
+			std::getline(fields, type, '\t');
+			std::getline(fields, size, '\t');
+			std::getline(fields, time, '\t');
+			std::getline(fields, entry.Source, '\t');
+			std::getline(fields, entry.Output, '\t');
+
+			auto name = std::find(
+				std::begin(TypeNames),
+				std::end(TypeNames),
+				type);
+
+			if (name == std::end(TypeNames) ||
+				entry.Output.empty())
+			{
+				LOG_WARNING << "Skipping manifest line: " <<
+					line;
+				continue;
+			}
+
+			entry.Type = (AssetType)(name - std::begin(TypeNames));
+
+			try {
+				entry.Size = std::stoull(size);
+				entry.TimeNS = std::stoll(time);
+			} catch (std::exception&) {
+				LOG_WARNING << "Skipping manifest line: " <<
+					line;
+				continue;
+			}
+
+			manifest[entry.Source] = entry;
+		}
+
+		return manifest;
+	}
+
+	void WriteManifest(
+		std::string cookedRoot,
+		const std::vector<ManifestEntry>& entries)
+	{
+		fs::path path = fs::path(cookedRoot) / ManifestName;
+		fs::path tempPath = path.string() + ".tmp";
+
+		std::ofstream out(tempPath, std::ios::trunc);
+
+		if (!out.is_open()) {
+			throw std::runtime_error(
+				"Failed to create " + tempPath.string());
+		}
+
+		out << "assetcook " << ManifestVersion << "\n";
+
+		for (const ManifestEntry& entry : entries) {
+			out << TypeNames[(int)entry.Type] << "\t" <<
+				entry.Size << "\t" <<
+				entry.TimeNS << "\t" <<
+				entry.Source << "\t" <<
+				entry.Output << "\n";
+		}
+
+		out.close();
+
+		if (!out) {
+			throw std::runtime_error(
+				"Failed to write " + path.string());
+		}
+
+		fs::rename(tempPath, path);
+	}
+
+	void SetRoots(std::string sourceRoot, std::string cookedRoot)
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+
+		SourceRoot = sourceRoot;
+		CookedRoot = cookedRoot;
+		Loaded = false;
+	}
+
+	std::string Find(std::string source)
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+
+		if (!Loaded) {
+			Manifest = ReadManifest(CookedRoot);
+			Loaded = true;
+
+			LOG_VERBOSE << "Found " << (uint32_t)Manifest.size() <<
+				" cooked assets in " << CookedRoot;
+		}
+
+		if (Manifest.empty()) {
+			return "";
+		}
+
+		fs::path root = fs::path(SourceRoot).lexically_normal();
+		fs::path relative = fs::path(source).lexically_normal().
+			lexically_relative(root);
+		auto entry = Manifest.find(relative.generic_string());
+
+		if (entry == Manifest.end()) {
+			return "";
+		}
+
+		fs::path output = fs::path(CookedRoot) / entry->second.Output;
+		uint64_t size;
+		int64_t timeNS;
+
+		if (!StatFile(output.string(), size, timeNS)) {
+			return "";
+		}
+
+		if (StatFile(source, size, timeNS) &&
+			(size != entry->second.Size ||
+				timeNS != entry->second.TimeNS))
+		{
+			return "";
+		}
+
+		return output.string();
+	}
+}
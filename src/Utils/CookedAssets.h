@@ -0,0 +1,57 @@
+#ifndef _COOKED_ASSETS_H
+#define _COOKED_ASSETS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+// Finds what assetcook made of a source asset, see AssetCooker/Cooker.h.
+// The manifest in the cooked directory maps every cooked source to its
+// output. An output is used while its source keeps the size and
+// modification time recorded there, or when the source is gone.
+namespace CookedAssets
+{
+	const char* const ManifestName = "manifest.txt";
+	// Bumped whenever outputs change for the same sources.
+	const uint32_t ManifestVersion = 2;
+
+	enum class AssetType
+	{
+		Mesh = 0,
+		Texture = 1,
+		Cubemap = 2
+	};
+
+	// One cooked source, paths relative to the source and cooked roots.
+	struct ManifestEntry
+	{
+		AssetType Type;
+		std::string Source;
+		uint64_t Size;
+		int64_t TimeNS;
+		std::string Output;
+	};
+
+	// Entries of the manifest in cookedRoot by source. Empty when there
+	// is none or it is of another version, malformed lines are skipped.
+	std::map<std::string, ManifestEntry> ReadManifest(
+		std::string cookedRoot);
+
+	// Written to a temporary file and renamed.
+	void WriteManifest(
+		std::string cookedRoot,
+		const std::vector<ManifestEntry>& entries);
+
+	// Defaults to the layout of make assetcook seen from the build
+	// directory: ../src/Assets/Resources cooked into ../build/cooked.
+	// The manifest is read again on the next Find.
+	void SetRoots(std::string sourceRoot, std::string cookedRoot);
+
+	// Path of the cooked output of source, empty when source is not
+	// under the source root or its output is missing or stale. Safe to
+	// call from any thread.
+	std::string Find(std::string source);
+}
+
+#endif
@@ -0,0 +1,160 @@
+#include "ImageDecoder.h"
+
+#include <stdexcept>
+
+#include "../ThirdParty/stb/stb_image.h"
+
+#include "../Logger/logger.h"
+#include "Profiler.h"
+
+DecodedImage::DecodedImage()
+{
+	_data = nullptr;
+	_width = 0;
+	_height = 0;
+}
+
+DecodedImage::DecodedImage(DecodedImage&& image)
+{
+	_data = image._data;
+	_width = image._width;
+	_height = image._height;
+
+	image._data = nullptr;
+	image._width = 0;
+	image._height = 0;
+}
+
+DecodedImage::~DecodedImage()
+{
+	if (_data) {
+		stbi_image_free(_data);
+	}
+}
+
+DecodedImage& DecodedImage::operator=(DecodedImage&& image)
+{
+	if (this != &image) {
+		if (_data) {
+			stbi_image_free(_data);
+		}
+
+		_data = image._data;
+		_width = image._width;
+		_height = image._height;
+
+		image._data = nullptr;
+		image._width = 0;
+		image._height = 0;
+	}
+
+	return *this;
+}
+
+DecodedImage DecodedImage::Decode(std::string file)
+{
+	PROFILE_ZONE("DecodedImage::Decode");
+
+	int width;
+	int height;
+	int channels;
+
+	stbi_uc* pixels = stbi_load(
+		file.c_str(),
+		&width,
+		&height,
+		&channels,
+		STBI_rgb_alpha);
+
+	if (!pixels) {
+		throw std::runtime_error("Failed to load image from " + file);
+	}
+
+	DecodedImage image;
+	image._data = pixels;
+	image._width = width;
+	image._height = height;
+
+	return image;
+}
+
+ImageDecoder::ImageDecoder(uint32_t threadCount) :
+	_queueSemaphore(0)
+{
+	_work = true;
+	_threads.resize(threadCount);
+
+	for (size_t i = 0; i < _threads.size(); ++i) {
+		_threads[i] = new std::thread(
+			&ImageDecoder::ThreadFunction,
+			this);
+	}
+
+	LOG_VERBOSE << "ImageDecoder started " << threadCount <<
+		" threads.";
+}
+
+ImageDecoder::~ImageDecoder()
+{
+	_queueMutex.lock();
+	_work = false;
+	_queueMutex.unlock();
+
+	for (size_t i = 0; i < _threads.size(); ++i) {
+		_queueSemaphore.release();
+	}
+
+	for (size_t i = 0; i < _threads.size(); ++i) {
+		_threads[i]->join();
+		delete _threads[i];
+	}
+}
+
+std::future<DecodedImage> ImageDecoder::Decode(std::string file)
+{
+	Request request;
+	request.File = file;
+	std::future<DecodedImage> result = request.Result.get_future();
+
+	_queueMutex.lock();
+	_queue.push_back(std::move(request));
+	_queueMutex.unlock();
+	_queueSemaphore.release();
+
+	return result;
+}
+
+void ImageDecoder::ThreadFunction()
+{
+	Profiler::SetThreadName("ImageDecoder");
+
+	while (true) {
+		_queueSemaphore.acquire();
+
+		_queueMutex.lock();
+
+		// Stop wakeups come after every request, so the queue is
+		// drained before the threads leave.
+		if (_queue.empty()) {
+			bool work = _work;
+			_queueMutex.unlock();
+
+			if (!work) {
+				break;
+			}
+
+			continue;
+		}
+
+		Request request = std::move(_queue.front());
+		_queue.pop_front();
+		_queueMutex.unlock();
+
+		try {
+			request.Result.set_value(
+				DecodedImage::Decode(request.File));
+		} catch (...) {
+			request.Result.set_exception(std::current_exception());
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef _IMAGE_DECODER_H
+#define _IMAGE_DECODER_H
+
+#include <string>
+#include <future>
+#include <semaphore>
+#include <mutex>
+#include <thread>
+#include <list>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// RGBA8 pixels as decoded by stb_image. Owns that buffer and only moves,
+// so it reaches the texture upload without being copied.
+class DecodedImage
+{
+public:
+	DecodedImage();
+	DecodedImage(const DecodedImage& image) = delete;
+	DecodedImage(DecodedImage&& image);
+	~DecodedImage();
+
+	DecodedImage& operator=(DecodedImage&& image);
+
+	// Throws when the file can not be decoded.
+	static DecodedImage Decode(std::string file);
+
+	const uint8_t* GetData() const
+	{
+		return _data;
+	}
+
+	uint32_t GetWidth() const
+	{
+		return _width;
+	}
+
+	uint32_t GetHeight() const
+	{
+		return _height;
+	}
+
+	size_t GetSize() const
+	{
+		return (size_t)_width * _height * 4;
+	}
+
+private:
+	uint8_t* _data;
+	uint32_t _width;
+	uint32_t _height;
+};
+
+// Decodes image files on its own worker threads. Decode returns at once,
+// files are taken in request order and decoded concurrently. A failed
+// decode rethrows from the future.
+class ImageDecoder
+{
+public:
+	ImageDecoder(uint32_t threadCount);
+	ImageDecoder(const ImageDecoder& decoder) = delete;
+	// Finishes the decodes already requested.
+	~ImageDecoder();
+
+	std::future<DecodedImage> Decode(std::string file);
+
+private:
+	struct Request
+	{
+		std::string File;
+		std::promise<DecodedImage> Result;
+	};
+
+	std::vector<std::thread*> _threads;
+	std::list<Request> _queue;
+	std::mutex _queueMutex;
+	std::counting_semaphore<> _queueSemaphore;
+
+	bool _work;
+	void ThreadFunction();
+};
+
+#endif
@@ -0,0 +1,514 @@
+#include "ImageTransform.h"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "ThreadPool.h"
+
+namespace ImageTransform
+{
+	// Side of the square tiles transposes are blocked in, a tile of
+	// source rows and one of destination rows fit in L1 together.
+	static const uint32_t TileSize = 32;
+	// Pixels swapped at a time by horizontal flips, reversed in locals so
+	// the compiler turns the reversal into vector shuffles.
+	static const uint32_t FlipBlock = 8;
+
+	static inline uint32_t LoadPixel(const uint8_t* image, size_t index)
+	{
+		uint32_t pixel;
+		memcpy(&pixel, image + index * 4, 4);
+
+		return pixel;
+	}
+
+	static inline void StorePixel(
+		uint8_t* image,
+		size_t index,
+		uint32_t pixel)
+	{
+		memcpy(image + index * 4, &pixel, 4);
+	}
+
+	// Copies pixel (x, y) of image to (y, x) of out for one tile, out is
+	// height pixels wide.
+	static void CopyTileTransposed(
+		const uint8_t* image,
+		uint8_t* out,
+		uint32_t width,
+		uint32_t height,
+		uint32_t tileX,
+		uint32_t tileY)
+	{
+		uint32_t endX = std::min(tileX + TileSize, width);
+		uint32_t endY = std::min(tileY + TileSize, height);
+
+		for (uint32_t x = tileX; x < endX; ++x) {
+			const uint8_t* column = image + (size_t)x * 4;
+			uint8_t* outRow = out + (size_t)height * x * 4;
+
+			for (uint32_t y = tileY; y < endY; ++y) {
+				uint32_t pixel =
+					LoadPixel(column, (size_t)width * y);
+
+				StorePixel(outRow, y, pixel);
+			}
+		}
+	}
+
+	// Out of place, tiled so the strided side of the copy stays in
+	// cache.
+	static void TransposeTiled(
+		const uint8_t* image,
+		uint8_t* out,
+		uint32_t width,
+		uint32_t height)
+	{
+		for (uint32_t ty = 0; ty < height; ty += TileSize) {
+			for (uint32_t tx = 0; tx < width; tx += TileSize) {
+				CopyTileTransposed(
+					image,
+					out,
+					width,
+					height,
+					tx,
+					ty);
+			}
+		}
+	}
+
+	// Swaps pixel (x, y) with (y, x) for the tile at (tileX, tileY), a
+	// tile on the diagonal only swaps its upper half with its lower.
+	static void SwapTileTransposed(
+		uint8_t* image,
+		uint32_t size,
+		uint32_t tileX,
+		uint32_t tileY)
+	{
+		uint32_t endX = std::min(tileX + TileSize, size);
+		uint32_t endY = std::min(tileY + TileSize, size);
+
+		for (uint32_t y = tileY; y < endY; ++y) {
+			uint32_t startX = tileX == tileY ? y + 1 : tileX;
+
+			for (uint32_t x = startX; x < endX; ++x) {
+				size_t a = (size_t)size * y + x;
+				size_t b = (size_t)size * x + y;
+
+				uint32_t pixel = LoadPixel(image, a);
+				StorePixel(image, a, LoadPixel(image, b));
+				StorePixel(image, b, pixel);
+			}
+		}
+	}
+
+	static void TransposeSquare(uint8_t* image, uint32_t size)
+	{
+		for (uint32_t ty = 0; ty < size; ty += TileSize) {
+			for (uint32_t tx = ty; tx < size; tx += TileSize) {
+				SwapTileTransposed(image, size, tx, ty);
+			}
+		}
+	}
+
+	void RotateClockWise(
+		const uint8_t* image,
+		uint8_t* out,
+		uint32_t width,
+		uint32_t height)
+	{
+		TransposeTiled(image, out, width, height);
+		FlipHorizontally(out, height, width);
+	}
+
+	void RotateClockWise(
+		uint8_t* image,
+		uint32_t width,
+		uint32_t height)
+	{
+		if (width == height) {
+			TransposeSquare(image, width);
+			FlipHorizontally(image, width, height);
+			return;
+		}
+
+		std::vector<uint8_t> buffer((size_t)width * height * 4);
+		RotateClockWise(image, buffer.data(), width, height);
+		memcpy(image, buffer.data(), buffer.size());
+	}
+
+	void RotateCounterClockWise(
+		const uint8_t* image,
+		uint8_t* out,
+		uint32_t width,
+		uint32_t height)
+	{
+		TransposeTiled(image, out, width, height);
+		FlipVertically(out, height, width);
+	}
+
+	void RotateCounterClockWise(
+		uint8_t* image,
+		uint32_t width,
+		uint32_t height)
+	{
+		if (width == height) {
+			TransposeSquare(image, width);
+			FlipVertically(image, width, height);
+			return;
+		}
+
+		std::vector<uint8_t> buffer((size_t)width * height * 4);
+		RotateCounterClockWise(image, buffer.data(), width, height);
+		memcpy(image, buffer.data(), buffer.size());
+	}
+
+	void FlipVertically(
+		uint8_t* image,
+		uint32_t width,
+		uint32_t height)
+	{
+		size_t rowSize = (size_t)width * 4;
+
+		for (uint32_t y = 0; y < height / 2; ++y) {
+			uint8_t* up = image + rowSize * y;
+			uint8_t* down = image + rowSize * (height - 1 - y);
+
+			std::swap_ranges(up, up + rowSize, down);
+		}
+	}
+
+	void FlipHorizontally(
+		uint8_t* image,
+		uint32_t width,
+		uint32_t height)
+	{
+		for (uint32_t y = 0; y < height; ++y) {
+			uint8_t* row = image + (size_t)width * y * 4;
+			uint32_t x = 0;
+
+			for (; x + FlipBlock <= width / 2; x += FlipBlock) {
+				uint32_t mirror = width - x - FlipBlock;
+				uint8_t* left = row + (size_t)x * 4;
+				uint8_t* right = row + (size_t)mirror * 4;
+
+				uint32_t leftPixels[FlipBlock];
+				uint32_t rightPixels[FlipBlock];
+				memcpy(leftPixels, left, sizeof(leftPixels));
+				memcpy(rightPixels, right, sizeof(rightPixels));
+
+				std::reverse(
+					std::begin(leftPixels),
+					std::end(leftPixels));
+				std::reverse(
+					std::begin(rightPixels),
+					std::end(rightPixels));
+
+				memcpy(left, rightPixels, sizeof(rightPixels));
+				memcpy(right, leftPixels, sizeof(leftPixels));
+			}
+
+			for (; x < width / 2; ++x) {
+				uint32_t mirror = width - 1 - x;
+				uint32_t left = LoadPixel(row, x);
+
+				StorePixel(row, x, LoadPixel(row, mirror));
+				StorePixel(row, mirror, left);
+			}
+		}
+	}
+
+	void Swap(
+		uint8_t* image1,
+		uint8_t* image2,
+		uint32_t width,
+		uint32_t height)
+	{
+		size_t size = (size_t)width * height * 4;
+
+		std::swap_ranges(image1, image1 + size, image2);
+	}
+
+	// Orientation fix of a single skybox face, applied while it is
+	// copied out of the strip.
+	enum class FaceTransform
+	{
+		Copy,
+		FlipHorizontally,
+		FlipVertically,
+		Transpose,
+		AntiTranspose
+	};
+
+	struct FaceSource
+	{
+		uint32_t Face;
+		FaceTransform Transform;
+	};
+
+	// Cube layer i is taken from strip face CubeFaces[i].Face.
+	static const FaceSource CubeFaces[6] = {
+		{0, FaceTransform::Transpose},
+		{2, FaceTransform::AntiTranspose},
+		{3, FaceTransform::FlipVertically},
+		{1, FaceTransform::FlipHorizontally},
+		{5, FaceTransform::Copy},
+		{4, FaceTransform::Copy}
+	};
+
+	// One tile of a transpose, anti transposes mirror across the other
+	// diagonal.
+	static void TransposeTile(
+		const uint8_t* face,
+		uint32_t stride,
+		uint32_t size,
+		bool anti,
+		uint32_t tileX,
+		uint32_t tileY,
+		uint8_t* out)
+	{
+		uint32_t endX = std::min(tileX + TileSize, size);
+		uint32_t endY = std::min(tileY + TileSize, size);
+
+		for (uint32_t y = tileY; y < endY; ++y) {
+			size_t outRow = (size_t)size * y;
+			uint32_t sx = anti ? size - 1 - y : y;
+			const uint8_t* column = face + (size_t)sx * 4;
+
+			for (uint32_t x = tileX; x < endX; ++x) {
+				uint32_t sy = anti ? size - 1 - x : x;
+				uint32_t pixel =
+					LoadPixel(column, (size_t)stride * sy);
+
+				StorePixel(out, outRow + x, pixel);
+			}
+		}
+	}
+
+	// face points to the top left pixel of the source face inside the
+	// strip, stride is the strip width in pixels.
+	static void ExtractFace(
+		const uint8_t* face,
+		uint32_t stride,
+		uint32_t size,
+		FaceTransform transform,
+		uint8_t* out)
+	{
+		size_t rowSize = (size_t)size * 4;
+		size_t strideSize = (size_t)stride * 4;
+
+		switch (transform) {
+		case FaceTransform::Copy:
+		case FaceTransform::FlipVertically:
+			for (uint32_t y = 0; y < size; ++y) {
+				uint32_t sy = transform == FaceTransform::Copy ?
+					y : size - 1 - y;
+
+				memcpy(
+					out + rowSize * y,
+					face + strideSize * sy,
+					rowSize);
+			}
+
+			break;
+		case FaceTransform::FlipHorizontally:
+			for (uint32_t y = 0; y < size; ++y) {
+				const uint8_t* row = face + strideSize * y;
+
+				for (uint32_t x = 0; x < size; ++x) {
+					StorePixel(
+						out,
+						(size_t)size * y + x,
+						LoadPixel(row, size - 1 - x));
+				}
+			}
+
+			break;
+		case FaceTransform::Transpose:
+		case FaceTransform::AntiTranspose:
+			bool anti = transform == FaceTransform::AntiTranspose;
+
+			for (uint32_t y = 0; y < size; y += TileSize) {
+				for (uint32_t x = 0; x < size; x += TileSize) {
+					TransposeTile(
+						face,
+						stride,
+						size,
+						anti,
+						x,
+						y,
+						out);
+				}
+			}
+
+			break;
+		}
+	}
+
+	std::vector<uint8_t> SkyboxToCube(
+		uint32_t width,
+		uint32_t height,
+		const uint8_t* data,
+		size_t size,
+		ThreadPool* threadPool)
+	{
+		uint32_t layerCount = 6;
+		uint32_t faceWidth = width / layerCount;
+
+		if (width % layerCount != 0 || faceWidth != height) {
+			throw std::runtime_error(
+				"Skybox strip must hold six square faces.");
+		}
+
+		if (size < (size_t)width * height * 4) {
+			throw std::runtime_error("Skybox data is too short.");
+		}
+
+		size_t faceSize = (size_t)faceWidth * faceWidth * 4;
+		std::vector<uint8_t> cube(faceSize * layerCount);
+
+		for (uint32_t layer = 0; layer < layerCount; ++layer) {
+			auto extract = [data, &cube, width, faceWidth,
+				faceSize, layer]() -> void
+			{
+				const FaceSource& source = CubeFaces[layer];
+
+				ExtractFace(
+					data + (size_t)faceWidth *
+						source.Face * 4,
+					width,
+					faceWidth,
+					source.Transform,
+					cube.data() + faceSize * layer);
+			};
+
+			if (threadPool) {
+				threadPool->Enqueue(extract);
+			} else {
+				extract();
+			}
+		}
+
+		if (threadPool) {
+			threadPool->Wait();
+		}
+
+		return cube;
+	}
+
+	static float SrgbToLinear(uint8_t value)
+	{
+		float c = value / 255.0f;
+
+		if (c <= 0.04045f) {
+			return c / 12.92f;
+		}
+
+		return std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static uint8_t LinearToSrgb(float value)
+	{
+		float c;
+
+		if (value <= 0.0031308f) {
+			c = value * 12.92f;
+		} else {
+			c = 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+		}
+
+		return (uint8_t)std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f);
+	}
+
+	uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+
+		while (width > 1 || height > 1) {
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+			++levels;
+		}
+
+		return levels;
+	}
+
+	// 2x2 box filter, odd edges repeat their last row or column.
+	static MipLevel Downsample(const MipLevel& src, const float* toLinear)
+	{
+		MipLevel dst;
+		dst.Width = std::max(src.Width / 2, 1u);
+		dst.Height = std::max(src.Height / 2, 1u);
+		dst.Data.resize(dst.Width * dst.Height * 4);
+
+		auto pixel = [&src](uint32_t x, uint32_t y) -> const uint8_t*
+		{
+			x = std::min(x, src.Width - 1);
+			y = std::min(y, src.Height - 1);
+
+			return &src.Data[(y * src.Width + x) * 4];
+		};
+
+		for (uint32_t y = 0; y < dst.Height; ++y) {
+			for (uint32_t x = 0; x < dst.Width; ++x) {
+				const uint8_t* p[4] = {
+					pixel(x * 2, y * 2),
+					pixel(x * 2 + 1, y * 2),
+					pixel(x * 2, y * 2 + 1),
+					pixel(x * 2 + 1, y * 2 + 1)
+				};
+
+				uint8_t* out =
+					&dst.Data[(y * dst.Width + x) * 4];
+
+				for (uint32_t c = 0; c < 3; ++c) {
+					float sum = toLinear[p[0][c]] +
+						toLinear[p[1][c]] +
+						toLinear[p[2][c]] +
+						toLinear[p[3][c]];
+
+					out[c] = LinearToSrgb(sum / 4);
+				}
+
+				out[3] = (p[0][3] + p[1][3] +
+					p[2][3] + p[3][3] + 2) / 4;
+			}
+		}
+
+		return dst;
+	}
+
+	std::vector<MipLevel> GenerateMipChain(
+		const uint8_t* image,
+		uint32_t width,
+		uint32_t height)
+	{
+		static float toLinear[256];
+		static bool toLinearReady = []() -> bool
+		{
+			for (uint32_t i = 0; i < 256; ++i) {
+				toLinear[i] = SrgbToLinear(i);
+			}
+
+			return true;
+		}();
+		(void)toLinearReady;
+
+		std::vector<MipLevel> chain;
+		chain.reserve(GetMipLevelCount(width, height));
+
+		MipLevel base;
+		base.Width = width;
+		base.Height = height;
+		base.Data.assign(image, image + width * height * 4);
+		chain.push_back(std::move(base));
+
+		while (chain.back().Width > 1 || chain.back().Height > 1) {
+			chain.push_back(Downsample(chain.back(), toLinear));
+		}
+
+		return chain;
+	}
+}
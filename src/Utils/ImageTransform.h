@@ -0,0 +1,87 @@
+#ifndef _IMAGE_TRANSFORM_H
+#define _IMAGE_TRANSFORM_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class ThreadPool;
+
+// CPU side transformations of RGBA8 images, shared by the renderer and the
+// offline asset cooker.
+namespace ImageTransform
+{
+	// Images are RGBA8, moved a whole pixel at a time. Rotations of
+	// square images work in place, other shapes go through a scratch
+	// buffer unless the out of place variant is used. A rotated image
+	// is height pixels wide.
+	void RotateClockWise(
+		uint8_t* image,
+		uint32_t width,
+		uint32_t height);
+
+	void RotateClockWise(
+		const uint8_t* image,
+		uint8_t* out,
+		uint32_t width,
+		uint32_t height);
+
+	void RotateCounterClockWise(
+		uint8_t* image,
+		uint32_t width,
+		uint32_t height);
+
+	void RotateCounterClockWise(
+		const uint8_t* image,
+		uint8_t* out,
+		uint32_t width,
+		uint32_t height);
+
+	void FlipVertically(
+		uint8_t* image,
+		uint32_t width,
+		uint32_t height);
+
+	void FlipHorizontally(
+		uint8_t* image,
+		uint32_t width,
+		uint32_t height);
+
+	void Swap(
+		uint8_t* image1,
+		uint8_t* image2,
+		uint32_t width,
+		uint32_t height);
+
+	// Rearranges a horizontal strip of six square skybox faces into
+	// the six consecutive layers of a cube map, every face is copied
+	// and oriented in a single pass. width is the width of the whole
+	// strip, size the bytes at data. With a thread pool the faces are
+	// extracted in parallel, must not be called from a thread of that
+	// pool.
+	std::vector<uint8_t> SkyboxToCube(
+		uint32_t width,
+		uint32_t height,
+		const uint8_t* data,
+		size_t size,
+		ThreadPool* threadPool = nullptr);
+
+	struct MipLevel
+	{
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<uint8_t> Data;
+	};
+
+	uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+	// Full chain down to 1x1, level 0 is a copy of the image. Colors
+	// are averaged in linear space and stored back as sRGB, alpha is
+	// averaged as is.
+	std::vector<MipLevel> GenerateMipChain(
+		const uint8_t* image,
+		uint32_t width,
+		uint32_t height);
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile(std::string path)
+{
+	_data = nullptr;
+	_size = 0;
+
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open file " + path);
+	}
+
+	struct stat fileStat;
+
+	if (fstat(fd, &fileStat) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to stat file " + path);
+	}
+
+	_size = fileStat.st_size;
+
+	// mmap rejects empty mappings, an empty file stays nullptr.
+	if (_size > 0) {
+		void* data = mmap(
+			nullptr,
+			_size,
+			PROT_READ,
+			MAP_PRIVATE,
+			fd,
+			0);
+
+		if (data == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Failed to map file " + path);
+		}
+
+		madvise(data, _size, MADV_SEQUENTIAL);
+		_data = static_cast<const char*>(data);
+	}
+
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (_data) {
+		munmap(const_cast<char*>(_data), _size);
+	}
+}
+
+bool StatFile(std::string path, uint64_t& size, int64_t& timeNS)
+{
+	struct stat fileStat;
+
+	if (stat(path.c_str(), &fileStat) != 0) {
+		return false;
+	}
+
+	size = fileStat.st_size;
+	timeNS = (int64_t)fileStat.st_mtim.tv_sec * 1000000000 +
+		fileStat.st_mtim.tv_nsec;
+
+	return true;
+}
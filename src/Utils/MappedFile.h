@@ -0,0 +1,36 @@
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+	MappedFile(std::string path);
+	MappedFile(const MappedFile& file) = delete;
+	~MappedFile();
+
+	const char* GetData()
+	{
+		return _data;
+	}
+
+	size_t GetSize()
+	{
+		return _size;
+	}
+
+private:
+	const char* _data;
+	size_t _size;
+};
+
+// Size and modification time in nanoseconds of the file at path, which
+// is how the caches and cooked assets tell a changed source. False when
+// the file can not be stat'ed.
+bool StatFile(std::string path, uint64_t& size, int64_t& timeNS);
+
+#endif
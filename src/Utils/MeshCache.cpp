@@ -0,0 +1,278 @@
+#include "MeshCache.h"
+
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <cstdio>
+#include <cstddef>
+
+namespace MeshCache
+{
+	static uint64_t Align(uint64_t offset)
+	{
+		return (offset + 15) & ~(uint64_t)15;
+	}
+
+	static uint64_t HashFile(std::string path)
+	{
+		MappedFile file(path);
+
+		// FNV-1a.
+		uint64_t hash = 0xCBF29CE484222325ull;
+		const uint8_t* data =
+			reinterpret_cast<const uint8_t*>(file.GetData());
+
+		for (size_t i = 0; i < file.GetSize(); ++i) {
+			hash ^= data[i];
+			hash *= 0x100000001B3ull;
+		}
+
+		return hash;
+	}
+
+	// Rewrites the source time in the header of the cache at path. Best
+	// effort, a cache that can not be written is only hashed again next
+	// time.
+	static void UpdateSourceTime(std::string path, int64_t timeNS)
+	{
+		std::fstream file(path, std::ios::in | std::ios::out |
+			std::ios::binary);
+
+		if (!file.is_open()) {
+			return;
+		}
+
+		file.seekp(offsetof(Header, SourceTimeNS));
+		file.write(
+			reinterpret_cast<const char*>(&timeNS),
+			sizeof(timeNS));
+	}
+
+	std::string GetCachePath(std::string source)
+	{
+		return source + ".meshcache";
+	}
+
+	Mesh::Mesh()
+	{
+		_file = nullptr;
+		_data = nullptr;
+		_size = 0;
+		_header = nullptr;
+	}
+
+	Mesh::~Mesh()
+	{
+		delete _file;
+	}
+
+	bool Mesh::Open(std::string source)
+	{
+		return Open(source, GetCachePath(source));
+	}
+
+	bool Mesh::Open(std::string source, std::string cachePath)
+	{
+		uint64_t sourceSize;
+		int64_t sourceTimeNS;
+
+		if (!StatFile(source, sourceSize, sourceTimeNS)) {
+			return false;
+		}
+
+		MappedFile* file;
+
+		try {
+			file = new MappedFile(cachePath);
+		} catch (std::runtime_error&) {
+			return false;
+		}
+
+		const Header* header =
+			reinterpret_cast<const Header*>(file->GetData());
+
+		bool valid = file->GetSize() >= sizeof(Header) &&
+			header->Magic == Magic &&
+			header->Version == Version &&
+			header->VertexStride == sizeof(Vertex) &&
+			header->SourceSize == sourceSize &&
+			header->VertexOffset + (uint64_t)header->VertexCount *
+				sizeof(Vertex) <= file->GetSize() &&
+			header->IndexOffset + (uint64_t)header->IndexCount *
+				sizeof(uint32_t) <= file->GetSize();
+
+		// A touched but unchanged source keeps its cache, which takes
+		// the new time so the source is not hashed on every open.
+		if (valid && header->SourceTimeNS != sourceTimeNS) {
+			valid = header->SourceHash == HashFile(source);
+
+			if (valid) {
+				UpdateSourceTime(cachePath, sourceTimeNS);
+			}
+		}
+
+		if (!valid) {
+			delete file;
+			return false;
+		}
+
+		delete _file;
+		_file = file;
+		_blob.clear();
+		_data = file->GetData();
+		_size = file->GetSize();
+		_header = header;
+
+		return true;
+	}
+
+	const Vertex* Mesh::GetVertices()
+	{
+		return reinterpret_cast<const Vertex*>(
+			_data + _header->VertexOffset);
+	}
+
+	uint32_t Mesh::GetVertexCount()
+	{
+		return _header->VertexCount;
+	}
+
+	const uint32_t* Mesh::GetIndices()
+	{
+		return reinterpret_cast<const uint32_t*>(
+			_data + _header->IndexOffset);
+	}
+
+	uint32_t Mesh::GetIndexCount()
+	{
+		return _header->IndexCount;
+	}
+
+	bool Mesh::GetBounds(Loader::Bounds& bounds)
+	{
+		if (!(_header->Flags & HasBounds)) {
+			return false;
+		}
+
+		bounds.Center = glm::vec3(
+			_header->BoundsCenter[0],
+			_header->BoundsCenter[1],
+			_header->BoundsCenter[2]);
+		bounds.Radius = _header->BoundsRadius;
+
+		return true;
+	}
+
+	Loader::VertexData Mesh::ToVertexData()
+	{
+		Loader::VertexData data;
+
+		const Vertex* vertices = GetVertices();
+		uint32_t vertexCount = GetVertexCount();
+
+		data.Vertices.resize(vertexCount);
+		data.Normals.resize(vertexCount);
+		data.TexCoords.resize(vertexCount);
+
+		for (uint32_t i = 0; i < vertexCount; ++i) {
+			data.Vertices[i] = vertices[i].Pos;
+			data.Normals[i] = vertices[i].Normal;
+			data.TexCoords[i] = vertices[i].TexCoord;
+		}
+
+		data.Indices.assign(
+			GetIndices(),
+			GetIndices() + GetIndexCount());
+
+		return data;
+	}
+
+	void Mesh::Create(
+		std::string source,
+		const Loader::VertexData& data,
+		const Loader::Bounds* bounds)
+	{
+		Header header{};
+		header.Magic = Magic;
+		header.Version = Version;
+		header.VertexStride = sizeof(Vertex);
+
+		if (!StatFile(source, header.SourceSize, header.SourceTimeNS)) {
+			throw std::runtime_error("Failed to stat " + source);
+		}
+
+		header.SourceHash = HashFile(source);
+
+		if (bounds) {
+			header.Flags |= HasBounds;
+			header.BoundsCenter[0] = bounds->Center.x;
+			header.BoundsCenter[1] = bounds->Center.y;
+			header.BoundsCenter[2] = bounds->Center.z;
+			header.BoundsRadius = bounds->Radius;
+		}
+
+		header.VertexCount = data.Vertices.size();
+		header.IndexCount = data.Indices.size();
+		header.VertexOffset = Align(sizeof(Header));
+		header.IndexOffset = Align(header.VertexOffset +
+			header.VertexCount * sizeof(Vertex));
+
+		uint64_t size = header.IndexOffset +
+			header.IndexCount * sizeof(uint32_t);
+
+		std::vector<char> blob(size, 0);
+		memcpy(blob.data(), &header, sizeof(Header));
+
+		Vertex* vertices = reinterpret_cast<Vertex*>(
+			blob.data() + header.VertexOffset);
+
+		for (uint32_t i = 0; i < header.VertexCount; ++i) {
+			vertices[i].Pos = data.Vertices[i];
+			vertices[i].Normal = data.Normals[i];
+			vertices[i].TexCoord = data.TexCoords[i];
+		}
+
+		memcpy(
+			blob.data() + header.IndexOffset,
+			data.Indices.data(),
+			header.IndexCount * sizeof(uint32_t));
+
+		delete _file;
+		_file = nullptr;
+		_blob = std::move(blob);
+		_data = _blob.data();
+		_size = size;
+		_header = reinterpret_cast<const Header*>(_data);
+	}
+
+	void Mesh::Write(std::string path)
+	{
+		std::string tempPath = path + ".tmp";
+
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+
+		if (!out.is_open()) {
+			throw std::runtime_error(
+				"Failed to create " + tempPath);
+		}
+
+		out.write(_data, _size);
+		out.close();
+
+		if (!out || rename(tempPath.c_str(), path.c_str()) != 0) {
+			remove(tempPath.c_str());
+			throw std::runtime_error("Failed to write " + path);
+		}
+	}
+
+	void WriteTo(
+		std::string path,
+		std::string source,
+		const Loader::VertexData& data,
+		const Loader::Bounds* bounds)
+	{
+		Mesh mesh;
+		mesh.Create(source, data, bounds);
+		mesh.Write(path);
+	}
+}
@@ -0,0 +1,109 @@
+#ifndef _MESH_CACHE_H
+#define _MESH_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "loader.h"
+#include "MappedFile.h"
+
+// Binary cache of a parsed model, stored next to its source as
+// <source>.meshcache. Layout, every blob aligned to 16 bytes:
+//   Header
+//   Vertex[VertexCount]     interleaved as ModelDescriptor::Vertex
+//   uint32_t[IndexCount]
+// The cache is valid while the source keeps its size and either its
+// modification time or its content hash.
+namespace MeshCache
+{
+	const uint32_t Magic = 0x4353484D; // "MHSC"
+	const uint32_t Version = 1;
+
+	// Must match ModelDescriptor::Vertex, checked in video.cpp.
+	struct Vertex
+	{
+		alignas(16) glm::vec3 Pos;
+		alignas(16) glm::vec3 Normal;
+		alignas(8) glm::vec2 TexCoord;
+	};
+
+	enum Flags : uint32_t
+	{
+		HasBounds = 1
+	};
+
+	struct Header
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Flags;
+		uint32_t VertexStride;
+
+		uint64_t SourceSize;
+		int64_t SourceTimeNS;
+		uint64_t SourceHash;
+
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		uint64_t VertexOffset;
+		uint64_t IndexOffset;
+
+		// Collision bounding sphere, valid with HasBounds.
+		float BoundsCenter[3];
+		float BoundsRadius;
+	};
+
+	std::string GetCachePath(std::string source);
+
+	// A mapped cache file, or a mesh laid out the same way in memory.
+	// The accessors point into it, so the interleaved vertices and the
+	// indices can be uploaded as they are.
+	class Mesh
+	{
+	public:
+		Mesh();
+		Mesh(const Mesh& mesh) = delete;
+		~Mesh();
+
+		// Returns false when the cache is missing or stale.
+		bool Open(std::string source);
+		// Same for a cache stored elsewhere, as assetcook writes them.
+		bool Open(std::string source, std::string cachePath);
+		// Lays freshly parsed data out in memory.
+		void Create(
+			std::string source,
+			const Loader::VertexData& data,
+			const Loader::Bounds* bounds = nullptr);
+
+		// Written to a temporary file and renamed, readers never see
+		// a partial cache.
+		void Write(std::string path);
+
+		const Vertex* GetVertices();
+		uint32_t GetVertexCount();
+		const uint32_t* GetIndices();
+		uint32_t GetIndexCount();
+
+		bool GetBounds(Loader::Bounds& bounds);
+
+		Loader::VertexData ToVertexData();
+
+	private:
+		MappedFile* _file;
+		std::vector<char> _blob;
+
+		const char* _data;
+		uint64_t _size;
+		const Header* _header;
+	};
+
+	// Lays data out and writes it to path, used by the asset cooker.
+	void WriteTo(
+		std::string path,
+		std::string source,
+		const Loader::VertexData& data,
+		const Loader::Bounds* bounds = nullptr);
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "Metrics.h"
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <condition_variable>
+
+#include "../Logger/logger.h"
+
+namespace Metrics
+{
+	// Metrics are never destroyed, call sites keep references to them.
+	static std::mutex _registryMutex;
+	static std::map<std::string, Counter*> _counters;
+	static std::map<std::string, Histogram*> _histograms;
+
+	static std::thread* _dumpThread = nullptr;
+	static std::mutex _dumpMutex;
+	static std::condition_variable _dumpCondition;
+	static bool _dumpWork = false;
+
+	Counter::Counter()
+	{
+		_value = 0;
+	}
+
+	Histogram::Histogram()
+	{
+		for (uint32_t i = 0; i < BucketCount; ++i) {
+			_buckets[i] = 0;
+		}
+
+		_count = 0;
+		_sum = 0;
+		_max = 0;
+	}
+
+	uint32_t Histogram::BucketIndex(uint64_t value)
+	{
+		if (value < SubBucketCount) {
+			return value;
+		}
+
+		uint32_t exponent = 63 - __builtin_clzll(value);
+		uint32_t shift = exponent - SubBucketBits;
+		uint32_t subBucket = (value >> shift) & (SubBucketCount - 1);
+
+		return (shift + 1) * SubBucketCount + subBucket;
+	}
+
+	uint64_t Histogram::BucketValue(uint32_t index)
+	{
+		if (index < SubBucketCount) {
+			return index;
+		}
+
+		uint32_t shift = index / SubBucketCount - 1;
+		uint64_t subBucket = index % SubBucketCount;
+
+		return (SubBucketCount + subBucket) << shift;
+	}
+
+	void Histogram::Record(uint64_t value)
+	{
+		_buckets[BucketIndex(value)].fetch_add(
+			1,
+			std::memory_order_relaxed);
+		_count.fetch_add(1, std::memory_order_relaxed);
+		_sum.fetch_add(value, std::memory_order_relaxed);
+
+		uint64_t max = _max.load(std::memory_order_relaxed);
+
+		while (value > max && !_max.compare_exchange_weak(
+			max,
+			value,
+			std::memory_order_relaxed))
+		{
+		}
+	}
+
+	uint64_t Histogram::GetCount()
+	{
+		return _count.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Histogram::GetSum()
+	{
+		return _sum.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Histogram::GetMax()
+	{
+		return _max.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Histogram::GetPercentile(double percentile)
+	{
+		uint64_t count = GetCount();
+
+		if (count == 0) {
+			return 0;
+		}
+
+		uint64_t target = count * percentile / 100.0;
+		uint64_t seen = 0;
+
+		for (uint32_t i = 0; i < BucketCount; ++i) {
+			seen += _buckets[i].load(std::memory_order_relaxed);
+
+			if (seen > target) {
+				return BucketValue(i);
+			}
+		}
+
+		return GetMax();
+	}
+
+	Counter& GetCounter(const std::string& name)
+	{
+		_registryMutex.lock();
+
+		Counter*& counter = _counters[name];
+
+		if (!counter) {
+			counter = new Counter();
+		}
+
+		_registryMutex.unlock();
+
+		return *counter;
+	}
+
+	Histogram& GetHistogram(const std::string& name)
+	{
+		_registryMutex.lock();
+
+		Histogram*& histogram = _histograms[name];
+
+		if (!histogram) {
+			histogram = new Histogram();
+		}
+
+		_registryMutex.unlock();
+
+		return *histogram;
+	}
+
+	void Dump(std::string file)
+	{
+		std::ofstream out(file, std::ios::app);
+
+		if (!out.is_open()) {
+			throw std::runtime_error(
+				"Failed to open metrics file.");
+		}
+
+		auto now = std::chrono::system_clock::now();
+		uint64_t timeMS =
+			std::chrono::duration_cast<std::chrono::milliseconds>(
+				now.time_since_epoch()).count();
+
+		out << "{\"time_ms\":" << timeMS << ",\"counters\":{";
+
+		_registryMutex.lock();
+
+		bool first = true;
+
+		for (auto& counter : _counters) {
+			out << (first ? "" : ",") <<
+				"\"" << counter.first << "\":" <<
+				counter.second->Get();
+			first = false;
+		}
+
+		out << "},\"histograms\":{";
+
+		first = true;
+
+		for (auto& entry : _histograms) {
+			Histogram* histogram = entry.second;
+
+			out << (first ? "" : ",") <<
+				"\"" << entry.first << "\":{" <<
+				"\"count\":" << histogram->GetCount() <<
+				",\"sum\":" << histogram->GetSum() <<
+				",\"p50\":" << histogram->GetPercentile(50) <<
+				",\"p90\":" << histogram->GetPercentile(90) <<
+				",\"p99\":" << histogram->GetPercentile(99) <<
+				",\"max\":" << histogram->GetMax() << "}";
+			first = false;
+		}
+
+		_registryMutex.unlock();
+
+		out << "}}\n";
+	}
+
+	static void DumpThread(std::string file, uint32_t periodMS)
+	{
+		std::unique_lock<std::mutex> lock(_dumpMutex);
+
+		while (_dumpWork) {
+			_dumpCondition.wait_for(
+				lock,
+				std::chrono::milliseconds(periodMS));
+
+			if (_dumpWork) {
+				Dump(file);
+			}
+		}
+	}
+
+	void StartDump(std::string file, uint32_t periodMS)
+	{
+		if (_dumpThread) {
+			throw std::runtime_error(
+				"Metrics dump already started.");
+		}
+
+		_dumpWork = true;
+		_dumpThread = new std::thread(DumpThread, file, periodMS);
+
+		LOG_VERBOSE << "Metrics dump to " << file <<
+			" every " << periodMS << " ms.";
+	}
+
+	void StopDump()
+	{
+		if (!_dumpThread) {
+			return;
+		}
+
+		_dumpMutex.lock();
+		_dumpWork = false;
+		_dumpMutex.unlock();
+		_dumpCondition.notify_all();
+
+		_dumpThread->join();
+		delete _dumpThread;
+		_dumpThread = nullptr;
+	}
+}
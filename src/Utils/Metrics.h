@@ -0,0 +1,101 @@
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+// Runtime counters and histograms. Lookup by name takes the registry
+// mutex, so call sites go through the METRIC_* macros which resolve the
+// name once per site and only touch atomics afterwards. Without
+// ENABLE_METRICS the macros expand to nothing and arguments are not
+// evaluated.
+namespace Metrics
+{
+	class Counter
+	{
+	public:
+		Counter();
+
+		void Add(int64_t value)
+		{
+			_value.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		int64_t Get()
+		{
+			return _value.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<int64_t> _value;
+	};
+
+	// Log-linear buckets: 16 sub-buckets per power of two, which keeps
+	// the relative error of reported percentiles under 6.25%.
+	class Histogram
+	{
+	public:
+		static const uint32_t SubBucketBits = 4;
+		static const uint32_t SubBucketCount = 1 << SubBucketBits;
+		static const uint32_t BucketCount =
+			(64 - SubBucketBits + 1) * SubBucketCount;
+
+		Histogram();
+
+		void Record(uint64_t value);
+
+		uint64_t GetCount();
+		uint64_t GetSum();
+		uint64_t GetMax();
+
+		// Lower bound of the bucket holding the given percentile.
+		uint64_t GetPercentile(double percentile);
+
+	private:
+		std::atomic<uint64_t> _buckets[BucketCount];
+		std::atomic<uint64_t> _count;
+		std::atomic<uint64_t> _sum;
+		std::atomic<uint64_t> _max;
+
+		static uint32_t BucketIndex(uint64_t value);
+		static uint64_t BucketValue(uint32_t index);
+	};
+
+	Counter& GetCounter(const std::string& name);
+	Histogram& GetHistogram(const std::string& name);
+
+	// Appends one JSON object per line with every registered metric.
+	void Dump(std::string file);
+
+	// Dumps from a background thread every periodMS milliseconds.
+	void StartDump(std::string file, uint32_t periodMS);
+	void StopDump();
+}
+
+#ifdef ENABLE_METRICS
+
+#define METRIC_COUNTER_ADD(name, value) \
+	do { \
+		static Metrics::Counter& _metric = Metrics::GetCounter(name); \
+		_metric.Add(value); \
+	} while (0)
+
+#define METRIC_HISTOGRAM_RECORD(name, value) \
+	do { \
+		static Metrics::Histogram& _metric = \
+			Metrics::GetHistogram(name); \
+		_metric.Record(value); \
+	} while (0)
+
+#else
+
+#define METRIC_COUNTER_ADD(name, value) \
+	do { (void)sizeof(value); } while (0)
+
+#define METRIC_HISTOGRAM_RECORD(name, value) \
+	do { (void)sizeof(value); } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,323 @@
+#include "ObjParser.h"
+
+#include <charconv>
+#include <stdexcept>
+#include <exception>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace ObjParser
+{
+	// Smaller files are parsed faster than the chunks can be scheduled.
+	static const size_t ParallelThreshold = 4 * 1048576;
+
+	static inline const char* SkipSpaces(const char* pos, const char* end)
+	{
+		while (pos < end && (*pos == ' ' || *pos == '\t')) {
+			++pos;
+		}
+
+		return pos;
+	}
+
+	static inline const char* SkipLine(const char* pos, const char* end)
+	{
+		while (pos < end && *pos != '\n') {
+			++pos;
+		}
+
+		return pos;
+	}
+
+	static inline const char* ParseFloat(
+		const char* pos,
+		const char* end,
+		float& value)
+	{
+		pos = SkipSpaces(pos, end);
+
+		// from_chars does not accept an explicit plus sign.
+		if (pos < end && *pos == '+') {
+			++pos;
+		}
+
+		auto result = std::from_chars(pos, end, value);
+
+		if (result.ec != std::errc()) {
+			throw std::runtime_error("Invalid number in OBJ file.");
+		}
+
+		return result.ptr;
+	}
+
+	// Indices are range checked once the whole file is parsed, a chunk
+	// may reference vertices declared in an earlier chunk.
+	static inline const char* ParseIndex(
+		const char* pos,
+		const char* end,
+		uint32_t& index)
+	{
+		int64_t value;
+		auto result = std::from_chars(pos, end, value);
+
+		if (result.ec != std::errc()) {
+			throw std::runtime_error("Invalid index in OBJ file.");
+		}
+
+		if (value <= 0) {
+			throw std::runtime_error(
+				"Relative OBJ indices are not supported.");
+		}
+
+		if (value >= NoIndex) {
+			throw std::runtime_error("OBJ index out of range.");
+		}
+
+		index = value - 1;
+
+		return result.ptr;
+	}
+
+	// Parses "v", "v/vt", "v//vn" or "v/vt/vn".
+	static inline const char* ParseCorner(
+		const char* pos,
+		const char* end,
+		Corner& corner)
+	{
+		corner.TexCoord = NoIndex;
+		corner.Normal = NoIndex;
+
+		pos = ParseIndex(pos, end, corner.Position);
+
+		if (pos < end && *pos == '/') {
+			++pos;
+
+			if (pos < end && *pos != '/') {
+				pos = ParseIndex(pos, end, corner.TexCoord);
+			}
+
+			if (pos < end && *pos == '/') {
+				++pos;
+				pos = ParseIndex(pos, end, corner.Normal);
+			}
+		}
+
+		return pos;
+	}
+
+	static inline bool AtLineEnd(const char* pos, const char* end)
+	{
+		return pos >= end ||
+			*pos == '\n' ||
+			*pos == '\r' ||
+			*pos == '#';
+	}
+
+	static const char* ParseFace(
+		const char* pos,
+		const char* end,
+		Mesh& mesh)
+	{
+		Corner first;
+		Corner prev;
+		uint32_t cornerCount = 0;
+
+		pos = SkipSpaces(pos, end);
+
+		while (!AtLineEnd(pos, end)) {
+			Corner corner;
+			pos = ParseCorner(pos, end, corner);
+			pos = SkipSpaces(pos, end);
+
+			if (cornerCount == 0) {
+				first = corner;
+			} else if (cornerCount >= 2) {
+				mesh.Corners.push_back(first);
+				mesh.Corners.push_back(prev);
+				mesh.Corners.push_back(corner);
+			}
+
+			prev = corner;
+			++cornerCount;
+		}
+
+		if (cornerCount < 3) {
+			throw std::runtime_error(
+				"OBJ face with less than 3 vertices.");
+		}
+
+		return pos;
+	}
+
+	void ParseBuffer(const char* begin, const char* end, Mesh& mesh)
+	{
+		const char* pos = begin;
+
+		while (pos < end) {
+			pos = SkipSpaces(pos, end);
+
+			if (pos + 1 < end && pos[0] == 'v' && pos[1] == ' ') {
+				glm::vec3 position;
+				pos = ParseFloat(pos + 2, end, position[0]);
+				pos = ParseFloat(pos, end, position[1]);
+				pos = ParseFloat(pos, end, position[2]);
+				mesh.Positions.push_back(position);
+			} else if (pos + 2 < end && pos[0] == 'v' &&
+				pos[1] == 't' && pos[2] == ' ')
+			{
+				glm::vec2 texCoord;
+				pos = ParseFloat(pos + 3, end, texCoord[0]);
+				pos = ParseFloat(pos, end, texCoord[1]);
+				texCoord[1] = 1.0 - texCoord[1];
+				mesh.TexCoords.push_back(texCoord);
+			} else if (pos + 2 < end && pos[0] == 'v' &&
+				pos[1] == 'n' && pos[2] == ' ')
+			{
+				glm::vec3 normal;
+				pos = ParseFloat(pos + 3, end, normal[0]);
+				pos = ParseFloat(pos, end, normal[1]);
+				pos = ParseFloat(pos, end, normal[2]);
+				mesh.Normals.push_back(normal);
+			} else if (pos + 1 < end &&
+				pos[0] == 'f' && pos[1] == ' ')
+			{
+				pos = ParseFace(pos + 2, end, mesh);
+			}
+
+			pos = SkipLine(pos, end) + 1;
+		}
+	}
+
+	static inline bool IndexValid(uint32_t index, size_t count)
+	{
+		return index == NoIndex || index < count;
+	}
+
+	static void CheckCorners(const Mesh& mesh)
+	{
+		size_t positions = mesh.Positions.size();
+		size_t texCoords = mesh.TexCoords.size();
+		size_t normals = mesh.Normals.size();
+
+		for (const Corner& corner : mesh.Corners) {
+			if (!IndexValid(corner.Position, positions) ||
+				!IndexValid(corner.TexCoord, texCoords) ||
+				!IndexValid(corner.Normal, normals))
+			{
+				throw std::runtime_error(
+					"OBJ index out of range.");
+			}
+		}
+	}
+
+	template<typename T>
+	static void Append(std::vector<T>& to, const std::vector<T>& from)
+	{
+		to.insert(to.end(), from.begin(), from.end());
+	}
+
+	// OBJ indices are absolute, so chunks parse independently and merge
+	// by plain concatenation in file order.
+	static void ParseParallel(
+		const char* begin,
+		const char* end,
+		ThreadPool* threadPool,
+		Mesh& mesh)
+	{
+		size_t chunkCount = threadPool->GetThreadCount() * 4;
+		size_t chunkSize = (end - begin) / chunkCount + 1;
+
+		std::vector<const char*> bounds;
+		bounds.push_back(begin);
+
+		while (bounds.back() < end) {
+			const char* bound = bounds.back() + chunkSize;
+
+			if (bound >= end) {
+				bound = end;
+			} else {
+				bound = SkipLine(bound, end);
+				bound = bound < end ? bound + 1 : end;
+			}
+
+			bounds.push_back(bound);
+		}
+
+		chunkCount = bounds.size() - 1;
+
+		std::vector<Mesh> chunks(chunkCount);
+		std::vector<std::exception_ptr> errors(chunkCount);
+
+		for (size_t i = 0; i < chunkCount; ++i) {
+			const char* chunkBegin = bounds[i];
+			const char* chunkEnd = bounds[i + 1];
+			Mesh* chunk = &chunks[i];
+			std::exception_ptr* error = &errors[i];
+
+			threadPool->Enqueue(
+				[chunkBegin, chunkEnd, chunk, error]() -> void
+			{
+				try {
+					ParseBuffer(
+						chunkBegin,
+						chunkEnd,
+						*chunk);
+				} catch (...) {
+					*error = std::current_exception();
+				}
+			});
+		}
+
+		threadPool->Wait();
+
+		for (auto& error : errors) {
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+
+		size_t positionCount = 0;
+		size_t texCoordCount = 0;
+		size_t normalCount = 0;
+		size_t cornerCount = 0;
+
+		for (auto& chunk : chunks) {
+			positionCount += chunk.Positions.size();
+			texCoordCount += chunk.TexCoords.size();
+			normalCount += chunk.Normals.size();
+			cornerCount += chunk.Corners.size();
+		}
+
+		mesh.Positions.reserve(positionCount);
+		mesh.TexCoords.reserve(texCoordCount);
+		mesh.Normals.reserve(normalCount);
+		mesh.Corners.reserve(cornerCount);
+
+		for (auto& chunk : chunks) {
+			Append(mesh.Positions, chunk.Positions);
+			Append(mesh.TexCoords, chunk.TexCoords);
+			Append(mesh.Normals, chunk.Normals);
+			Append(mesh.Corners, chunk.Corners);
+		}
+	}
+
+	Mesh ParseFile(std::string path, ThreadPool* threadPool)
+	{
+		MappedFile file(path);
+		Mesh mesh;
+
+		const char* begin = file.GetData();
+		const char* end = begin + file.GetSize();
+
+		if (threadPool && file.GetSize() >= ParallelThreshold) {
+			ParseParallel(begin, end, threadPool, mesh);
+		} else {
+			ParseBuffer(begin, end, mesh);
+		}
+
+		CheckCorners(mesh);
+
+		return mesh;
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef _OBJ_PARSER_H
+#define _OBJ_PARSER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+// Streaming Wavefront OBJ parser working directly on a mapped file.
+// Only geometry is read: v, vt, vn and f. Polygons are triangulated as
+// fans. Every other statement is skipped.
+namespace ObjParser
+{
+	// Marks a face corner without texture coordinate or normal.
+	const uint32_t NoIndex = UINT32_MAX;
+
+	// Zero based indices into the attribute arrays.
+	struct Corner
+	{
+		uint32_t Position;
+		uint32_t TexCoord;
+		uint32_t Normal;
+	};
+
+	struct Mesh
+	{
+		std::vector<glm::vec3> Positions;
+		std::vector<glm::vec2> TexCoords;
+		std::vector<glm::vec3> Normals;
+
+		// Three corners per triangle.
+		std::vector<Corner> Corners;
+	};
+
+	// Large files are split at line boundaries and parsed on threadPool,
+	// which must not own the calling thread.
+	Mesh ParseFile(std::string path, ThreadPool* threadPool = nullptr);
+
+	// Appends everything found in [begin, end) to mesh. Texture
+	// coordinates are flipped vertically for Vulkan. Face indices are
+	// not range checked.
+	void ParseBuffer(const char* begin, const char* end, Mesh& mesh);
+}
+
+#endif
@@ -0,0 +1,188 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+
+namespace Profiler
+{
+	// 2^16 zones per thread, 1.5 MB.
+	static const uint32_t RingSize = 65536;
+
+	struct Record
+	{
+		const char* Name;
+		uint64_t Start;
+		uint64_t End;
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t ThreadId;
+		const char* Name;
+		std::vector<Record> Records;
+		std::atomic<uint64_t> Written;
+	};
+
+	static std::atomic<bool> _enabled = false;
+
+	static std::mutex _registryMutex;
+	static std::vector<ThreadBuffer*> _registry;
+
+	// Created by the first zone recorded while enabled, threads that
+	// only name themselves allocate nothing.
+	static thread_local ThreadBuffer* _threadBuffer = nullptr;
+	static thread_local const char* _threadName = nullptr;
+
+	static const auto _epoch = std::chrono::steady_clock::now();
+
+	static uint64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - _epoch).count();
+	}
+
+	// Buffers are never freed: zones of finished threads stay exportable.
+	static ThreadBuffer* GetThreadBuffer()
+	{
+		if (_threadBuffer) {
+			return _threadBuffer;
+		}
+
+		ThreadBuffer* buffer = new ThreadBuffer();
+		buffer->Name = _threadName;
+		buffer->Records.resize(RingSize);
+		buffer->Written = 0;
+
+		_registryMutex.lock();
+		buffer->ThreadId = _registry.size();
+		_registry.push_back(buffer);
+		_registryMutex.unlock();
+
+		_threadBuffer = buffer;
+
+		return buffer;
+	}
+
+	void SetEnabled(bool enabled)
+	{
+		_enabled = enabled;
+	}
+
+	bool IsEnabled()
+	{
+		return _enabled.load(std::memory_order_relaxed);
+	}
+
+	void SetThreadName(const char* name)
+	{
+		_threadName = name;
+
+		if (_threadBuffer) {
+			_threadBuffer->Name = name;
+		}
+	}
+
+	static void WriteEscaped(std::ofstream& out, const char* str)
+	{
+		for (; *str; ++str) {
+			if (*str == '"' || *str == '\\') {
+				out << '\\';
+			}
+
+			out << *str;
+		}
+	}
+
+	// Trace timestamps are microseconds, keep 0.1 us of precision.
+	static void WriteMicroseconds(std::ofstream& out, uint64_t ns)
+	{
+		out << ns / 1000 << "." << ns % 1000 / 100;
+	}
+
+	void ExportChromeTrace(std::string file)
+	{
+		std::ofstream out(file, std::ios::trunc);
+
+		if (!out.is_open()) {
+			throw std::runtime_error(
+				"Failed to open profile file.");
+		}
+
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+		bool first = true;
+
+		_registryMutex.lock();
+
+		for (ThreadBuffer* buffer : _registry) {
+			if (buffer->Name) {
+				out << (first ? "" : ",") <<
+					"\n{\"name\":\"thread_name\","
+					"\"ph\":\"M\",\"pid\":0,\"tid\":" <<
+					buffer->ThreadId <<
+					",\"args\":{\"name\":\"";
+				WriteEscaped(out, buffer->Name);
+				out << "\"}}";
+				first = false;
+			}
+
+			uint64_t written = buffer->Written.load(
+				std::memory_order_acquire);
+			uint64_t begin = written > RingSize ?
+				written - RingSize :
+				0;
+
+			for (uint64_t i = begin; i < written; ++i) {
+				const Record& record =
+					buffer->Records[i % RingSize];
+
+				out << (first ? "" : ",") << "\n{\"name\":\"";
+				WriteEscaped(out, record.Name);
+				out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" <<
+					buffer->ThreadId << ",\"ts\":";
+				WriteMicroseconds(out, record.Start);
+				out << ",\"dur\":";
+				WriteMicroseconds(
+					out,
+					record.End - record.Start);
+				out << "}";
+				first = false;
+			}
+		}
+
+		_registryMutex.unlock();
+
+		out << "\n]}\n";
+	}
+
+	Zone::Zone(const char* name)
+	{
+		_name = IsEnabled() ? name : nullptr;
+
+		if (_name) {
+			_start = Now();
+		}
+	}
+
+	Zone::~Zone()
+	{
+		if (!_name) {
+			return;
+		}
+
+		ThreadBuffer* buffer = GetThreadBuffer();
+		uint64_t index =
+			buffer->Written.load(std::memory_order_relaxed);
+
+		Record& record = buffer->Records[index % RingSize];
+		record.Name = _name;
+		record.Start = _start;
+		record.End = Now();
+
+		buffer->Written.store(index + 1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <string>
+#include <cstdint>
+
+// Scoped zone profiler. Every thread records finished zones into its own
+// ring buffer, so recording takes no locks. When a ring buffer is full the
+// oldest zones are overwritten. Zone names must outlive the profiler,
+// normally they are string literals.
+namespace Profiler
+{
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+
+	// Name shown for the calling thread in the exported trace. Cheap
+	// while disabled, the name is only stored.
+	void SetThreadName(const char* name);
+
+	// Writes every recorded zone in Chrome trace event format, loadable
+	// by chrome://tracing and Perfetto. Recording threads should be idle.
+	void ExportChromeTrace(std::string file);
+
+	class Zone
+	{
+	public:
+		Zone(const char* name);
+		~Zone();
+
+	private:
+		const char* _name;
+		uint64_t _start;
+	};
+}
+
+#define _PROFILE_CONCAT_IMPL(a, b) a##b
+#define _PROFILE_CONCAT(a, b) _PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) \
+	Profiler::Zone _PROFILE_CONCAT(_profileZone, __LINE__)(name)
+
+#endif
@@ -0,0 +1,517 @@
+#include "TextureContainer.h"
+
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <cstdio>
+#include <algorithm>
+
+#include "MappedFile.h"
+
+namespace TextureContainer
+{
+	static const uint32_t Magic = 0x20534444; // "DDS "
+	static const uint32_t FourCCDX10 = 0x30315844; // "DX10"
+	static const uint32_t FourCCDXT1 = 0x31545844; // "DXT1"
+	static const uint32_t FourCCDXT5 = 0x35545844; // "DXT5"
+
+	enum HeaderFlags : uint32_t
+	{
+		FlagCaps = 0x1,
+		FlagHeight = 0x2,
+		FlagWidth = 0x4,
+		FlagPixelFormat = 0x1000,
+		FlagMipMapCount = 0x20000,
+		FlagLinearSize = 0x80000
+	};
+
+	enum CapsFlags : uint32_t
+	{
+		CapsComplex = 0x8,
+		CapsTexture = 0x1000,
+		CapsMipMap = 0x400000,
+		Caps2Cube = 0x200,
+		Caps2CubeAllFaces = 0xFE00
+	};
+
+	static const uint32_t PixelFormatFourCC = 0x4;
+	static const uint32_t DimensionTexture2D = 3;
+	static const uint32_t MiscTextureCube = 0x4;
+
+	struct PixelFormatHeader
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct Header
+	{
+		uint32_t Magic;
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		PixelFormatHeader PixelFormat;
+		uint32_t Caps;
+		uint32_t Caps2;
+		uint32_t Caps3;
+		uint32_t Caps4;
+		uint32_t Reserved2;
+
+		// DX10 extension.
+		uint32_t DXGIFormat;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;
+	};
+
+	static_assert(sizeof(Header) == 4 + 124 + 20);
+
+	// Without the DX10 extension.
+	static const uint32_t LegacyHeaderSize = 4 + 124;
+
+	struct DDSFormat
+	{
+		uint32_t DXGIFormat;
+		TextureFormat Format;
+	};
+
+	static const DDSFormat DDSFormats[] = {
+		{29, TextureFormat::RGBA8_SRGB},
+		{71, TextureFormat::BC1_UNORM},
+		{72, TextureFormat::BC1_SRGB},
+		{77, TextureFormat::BC3_UNORM},
+		{78, TextureFormat::BC3_SRGB},
+		{83, TextureFormat::BC5_UNORM},
+		{98, TextureFormat::BC7_UNORM},
+		{99, TextureFormat::BC7_SRGB}
+	};
+
+	static const uint8_t KTX2Identifier[12] = {
+		0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+	};
+
+	struct KTX2Header
+	{
+		uint8_t Identifier[12];
+		uint32_t VkFormat;
+		uint32_t TypeSize;
+		uint32_t PixelWidth;
+		uint32_t PixelHeight;
+		uint32_t PixelDepth;
+		uint32_t LayerCount;
+		uint32_t FaceCount;
+		uint32_t LevelCount;
+		uint32_t SupercompressionScheme;
+		uint32_t DFDByteOffset;
+		uint32_t DFDByteLength;
+		uint32_t KVDByteOffset;
+		uint32_t KVDByteLength;
+		uint64_t SGDByteOffset;
+		uint64_t SGDByteLength;
+	};
+
+	static_assert(sizeof(KTX2Header) == 80);
+
+	struct KTX2Level
+	{
+		uint64_t ByteOffset;
+		uint64_t ByteLength;
+		uint64_t UncompressedByteLength;
+	};
+
+	struct KTX2Format
+	{
+		uint32_t VkFormat;
+		TextureFormat Format;
+	};
+
+	static const KTX2Format KTX2Formats[] = {
+		{43, TextureFormat::RGBA8_SRGB},
+		{131, TextureFormat::BC1_UNORM},
+		{132, TextureFormat::BC1_SRGB},
+		{133, TextureFormat::BC1_UNORM},
+		{134, TextureFormat::BC1_SRGB},
+		{137, TextureFormat::BC3_UNORM},
+		{138, TextureFormat::BC3_SRGB},
+		{141, TextureFormat::BC5_UNORM},
+		{145, TextureFormat::BC7_UNORM},
+		{146, TextureFormat::BC7_SRGB}
+	};
+
+	// Bytes per pixel, or per 4x4 block for block compressed formats.
+	static uint32_t GetBlockBytes(TextureFormat format)
+	{
+		switch (format) {
+		case TextureFormat::RGBA8_SRGB:
+			return 4;
+		case TextureFormat::BC1_UNORM:
+		case TextureFormat::BC1_SRGB:
+			return 8;
+		case TextureFormat::BC3_UNORM:
+		case TextureFormat::BC3_SRGB:
+		case TextureFormat::BC5_UNORM:
+		case TextureFormat::BC7_UNORM:
+		case TextureFormat::BC7_SRGB:
+			return 16;
+		}
+
+		throw std::runtime_error("Unknown texture format.");
+	}
+
+	bool IsBlockCompressed(TextureFormat format)
+	{
+		return format != TextureFormat::RGBA8_SRGB;
+	}
+
+	uint64_t GetLevelSize(
+		TextureFormat format,
+		uint32_t width,
+		uint32_t height,
+		uint32_t level)
+	{
+		uint64_t levelWidth = std::max(width >> level, 1u);
+		uint64_t levelHeight = std::max(height >> level, 1u);
+
+		if (IsBlockCompressed(format)) {
+			levelWidth = (levelWidth + 3) / 4;
+			levelHeight = (levelHeight + 3) / 4;
+		}
+
+		return levelWidth * levelHeight * GetBlockBytes(format);
+	}
+
+	uint64_t GetLayerSize(const Texture& texture)
+	{
+		uint64_t size = 0;
+
+		for (uint32_t level = 0; level < texture.MipLevels; ++level) {
+			size += GetLevelSize(
+				texture.Format,
+				texture.Width,
+				texture.Height,
+				level);
+		}
+
+		return size;
+	}
+
+	uint64_t GetLevelOffset(
+		const Texture& texture,
+		uint32_t layer,
+		uint32_t level)
+	{
+		uint64_t offset = GetLayerSize(texture) * layer;
+
+		for (uint32_t i = 0; i < level; ++i) {
+			offset += GetLevelSize(
+				texture.Format,
+				texture.Width,
+				texture.Height,
+				i);
+		}
+
+		return offset;
+	}
+
+	// Files give sizes and mip counts, which must make a valid image.
+	static void CheckSize(const Texture& texture, std::string path)
+	{
+		if (texture.Width == 0 || texture.Height == 0) {
+			throw std::runtime_error("Empty texture " + path);
+		}
+
+		uint32_t maxLevels = 1;
+
+		while (std::max(texture.Width, texture.Height) >> maxLevels) {
+			++maxLevels;
+		}
+
+		if (texture.MipLevels > maxLevels) {
+			throw std::runtime_error(
+				"Too many mip levels in texture " + path);
+		}
+	}
+
+	void Write(std::string path, const Texture& texture)
+	{
+		if (texture.Cube && texture.LayerCount % 6 != 0) {
+			throw std::runtime_error(
+				"Cube texture needs six layers per cube.");
+		}
+
+		if (texture.Data.size() !=
+			GetLayerSize(texture) * texture.LayerCount)
+		{
+			throw std::runtime_error(
+				"Texture data does not match its layout.");
+		}
+
+		Header header{};
+		header.Magic = Magic;
+		header.Size = 124;
+		header.Flags = FlagCaps | FlagHeight | FlagWidth |
+			FlagPixelFormat | FlagMipMapCount | FlagLinearSize;
+		header.Height = texture.Height;
+		header.Width = texture.Width;
+		header.PitchOrLinearSize = GetLevelSize(
+			texture.Format,
+			texture.Width,
+			texture.Height,
+			0);
+		header.Depth = 1;
+		header.MipMapCount = texture.MipLevels;
+		header.PixelFormat.Size = sizeof(PixelFormatHeader);
+		header.PixelFormat.Flags = PixelFormatFourCC;
+		header.PixelFormat.FourCC = FourCCDX10;
+		header.Caps = CapsTexture;
+
+		if (texture.MipLevels > 1) {
+			header.Caps |= CapsComplex | CapsMipMap;
+		}
+
+		header.DXGIFormat = (uint32_t)texture.Format;
+		header.ResourceDimension = DimensionTexture2D;
+		header.ArraySize = texture.LayerCount;
+
+		if (texture.Cube) {
+			header.Caps |= CapsComplex;
+			header.Caps2 = Caps2CubeAllFaces;
+			header.MiscFlag = MiscTextureCube;
+			header.ArraySize = texture.LayerCount / 6;
+		}
+
+		std::string tempPath = path + ".tmp";
+
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+
+		if (!out.is_open()) {
+			throw std::runtime_error(
+				"Failed to create " + tempPath);
+		}
+
+		out.write(
+			reinterpret_cast<const char*>(&header),
+			sizeof(Header));
+		out.write(
+			reinterpret_cast<const char*>(texture.Data.data()),
+			texture.Data.size());
+		out.close();
+
+		if (!out || rename(tempPath.c_str(), path.c_str()) != 0) {
+			remove(tempPath.c_str());
+			throw std::runtime_error("Failed to write " + path);
+		}
+	}
+
+	// Legacy files name the format by FourCC and carry no sRGB
+	// information, their data starts right after the 124 byte header.
+	static Texture ReadDDS(MappedFile& file, std::string path)
+	{
+		if (file.GetSize() < LegacyHeaderSize) {
+			throw std::runtime_error("Truncated texture " + path);
+		}
+
+		Header header{};
+		memcpy(
+			&header,
+			file.GetData(),
+			std::min<uint64_t>(file.GetSize(), sizeof(Header)));
+
+		if (header.Magic != Magic ||
+			!(header.PixelFormat.Flags & PixelFormatFourCC))
+		{
+			throw std::runtime_error("Unsupported texture " + path);
+		}
+
+		Texture texture;
+		uint64_t dataOffset;
+
+		if (header.PixelFormat.FourCC == FourCCDX10) {
+			if (file.GetSize() < sizeof(Header) ||
+				header.ResourceDimension != DimensionTexture2D)
+			{
+				throw std::runtime_error(
+					"Unsupported texture " + path);
+			}
+
+			auto format = std::find_if(
+				std::begin(DDSFormats),
+				std::end(DDSFormats),
+				[&header](const DDSFormat& format) -> bool
+			{
+				return format.DXGIFormat == header.DXGIFormat;
+			});
+
+			if (format == std::end(DDSFormats)) {
+				throw std::runtime_error(
+					"Unsupported texture " + path);
+			}
+
+			texture.Format = format->Format;
+			texture.Cube = header.MiscFlag & MiscTextureCube;
+			texture.LayerCount = std::max(header.ArraySize, 1u);
+			dataOffset = sizeof(Header);
+		} else if (header.PixelFormat.FourCC == FourCCDXT1 ||
+			header.PixelFormat.FourCC == FourCCDXT5)
+		{
+			// Legacy cubes must hold all six faces.
+			if ((header.Caps2 & Caps2Cube) &&
+				(header.Caps2 & Caps2CubeAllFaces) !=
+					Caps2CubeAllFaces)
+			{
+				throw std::runtime_error(
+					"Unsupported texture " + path);
+			}
+
+			texture.Format =
+				header.PixelFormat.FourCC == FourCCDXT1 ?
+				TextureFormat::BC1_UNORM :
+				TextureFormat::BC3_UNORM;
+			texture.Cube = header.Caps2 & Caps2Cube;
+			texture.LayerCount = 1;
+			dataOffset = LegacyHeaderSize;
+		} else {
+			throw std::runtime_error("Unsupported texture " + path);
+		}
+
+		texture.Width = header.Width;
+		texture.Height = header.Height;
+		texture.MipLevels = header.Flags & FlagMipMapCount ?
+			std::max(header.MipMapCount, 1u) : 1;
+
+		if (texture.Cube) {
+			texture.LayerCount *= 6;
+		}
+
+		CheckSize(texture, path);
+
+		uint64_t dataSize = GetLayerSize(texture) * texture.LayerCount;
+
+		if (file.GetSize() - dataOffset < dataSize) {
+			throw std::runtime_error("Truncated texture " + path);
+		}
+
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(
+			file.GetData() + dataOffset);
+		texture.Data.assign(data, data + dataSize);
+
+		return texture;
+	}
+
+	static Texture ReadKTX2(MappedFile& file, std::string path)
+	{
+		if (file.GetSize() < sizeof(KTX2Header)) {
+			throw std::runtime_error("Truncated texture " + path);
+		}
+
+		KTX2Header header;
+		memcpy(&header, file.GetData(), sizeof(KTX2Header));
+
+		auto format = std::find_if(
+			std::begin(KTX2Formats),
+			std::end(KTX2Formats),
+			[&header](const KTX2Format& format) -> bool
+		{
+			return format.VkFormat == header.VkFormat;
+		});
+
+		if (format == std::end(KTX2Formats) ||
+			header.PixelDepth > 1 ||
+			header.SupercompressionScheme != 0 ||
+			(header.FaceCount != 1 && header.FaceCount != 6))
+		{
+			throw std::runtime_error("Unsupported texture " + path);
+		}
+
+		Texture texture;
+		texture.Format = format->Format;
+		texture.Width = header.PixelWidth;
+		texture.Height = header.PixelHeight;
+		texture.MipLevels = std::max(header.LevelCount, 1u);
+		texture.Cube = header.FaceCount == 6;
+		texture.LayerCount =
+			std::max(header.LayerCount, 1u) * header.FaceCount;
+
+		CheckSize(texture, path);
+
+		uint64_t indexEnd = sizeof(KTX2Header) +
+			sizeof(KTX2Level) * texture.MipLevels;
+
+		if (file.GetSize() < indexEnd) {
+			throw std::runtime_error("Truncated texture " + path);
+		}
+
+		texture.Data.resize(GetLayerSize(texture) * texture.LayerCount);
+
+		// KTX2 stores level after level, every level holding all of
+		// its layers and faces in the order of the layer index here.
+		for (uint32_t level = 0; level < texture.MipLevels; ++level) {
+			KTX2Level index;
+			memcpy(
+				&index,
+				file.GetData() + sizeof(KTX2Header) +
+					sizeof(KTX2Level) * level,
+				sizeof(KTX2Level));
+
+			uint64_t levelSize = GetLevelSize(
+				texture.Format,
+				texture.Width,
+				texture.Height,
+				level);
+
+			if (index.ByteLength < levelSize * texture.LayerCount ||
+				index.ByteOffset > file.GetSize() ||
+				file.GetSize() - index.ByteOffset <
+					index.ByteLength)
+			{
+				throw std::runtime_error(
+					"Truncated texture " + path);
+			}
+
+			const char* levelData =
+				file.GetData() + index.ByteOffset;
+
+			for (uint32_t layer = 0; layer < texture.LayerCount;
+				++layer)
+			{
+				uint64_t offset =
+					GetLevelOffset(texture, layer, level);
+
+				memcpy(
+					texture.Data.data() + offset,
+					levelData + levelSize * layer,
+					levelSize);
+			}
+		}
+
+		return texture;
+	}
+
+	Texture Read(std::string path)
+	{
+		MappedFile file(path);
+
+		if (file.GetSize() >= sizeof(KTX2Identifier) &&
+			memcmp(
+				file.GetData(),
+				KTX2Identifier,
+				sizeof(KTX2Identifier)) == 0)
+		{
+			return ReadKTX2(file, path);
+		}
+
+		return ReadDDS(file, path);
+	}
+}
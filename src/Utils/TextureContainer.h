@@ -0,0 +1,62 @@
+#ifndef _TEXTURE_CONTAINER_H
+#define _TEXTURE_CONTAINER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// GPU ready textures stored as DDS files with the DX10 header extension,
+// legacy DXT1/DXT5 DDS and KTX2 files can be read as well. Data is
+// ordered the DDS way: layer after layer, every layer holding its whole
+// mip chain from the largest level down. Block compressed levels hold
+// whole 4x4 blocks.
+namespace TextureContainer
+{
+	// Values are the matching DXGI_FORMAT.
+	enum class TextureFormat : uint32_t
+	{
+		RGBA8_SRGB = 29,
+		BC1_UNORM = 71,
+		BC1_SRGB = 72,
+		BC3_UNORM = 77,
+		BC3_SRGB = 78,
+		BC5_UNORM = 83,
+		BC7_UNORM = 98,
+		BC7_SRGB = 99
+	};
+
+	bool IsBlockCompressed(TextureFormat format);
+
+	struct Texture
+	{
+		TextureFormat Format;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t LayerCount;
+		uint32_t MipLevels;
+		bool Cube;
+		std::vector<uint8_t> Data;
+	};
+
+	uint64_t GetLevelSize(
+		TextureFormat format,
+		uint32_t width,
+		uint32_t height,
+		uint32_t level);
+
+	uint64_t GetLayerSize(const Texture& texture);
+
+	uint64_t GetLevelOffset(
+		const Texture& texture,
+		uint32_t layer,
+		uint32_t level);
+
+	// Written to a temporary file and renamed.
+	void Write(std::string path, const Texture& texture);
+
+	// Reads DDS or KTX2, told apart by the file magic. KTX2 files must
+	// not be supercompressed.
+	Texture Read(std::string path);
+}
+
+#endif
@@ -1,6 +1,9 @@
 #include "ThreadPool.h"
 
 #include "../Logger/logger.h"
+#include "Profiler.h"
+
+static thread_local int32_t _threadIndex = -1;
 
 ThreadPool::ThreadPool(uint32_t threadCount) :
 	_queueSemaphore(0),
@@ -14,8 +17,9 @@ ThreadPool::ThreadPool(uint32_t threadCount) :
 	for (size_t i = 0; i < _threads.size(); ++i) {
 		_threads[i] = new std::thread(
 			&ThreadPool::ThreadFunction,
-			this);
-		Logger::Verbose() << "ThreadPool thread created.";
+			this,
+			i);
+		LOG_VERBOSE << "ThreadPool thread created.";
 	}
 }
 
@@ -30,7 +34,7 @@ ThreadPool::~ThreadPool()
 	for (size_t i = 0; i < _threads.size(); ++i) {
 		_threads[i]->join();
 		delete _threads[i];
-		Logger::Verbose() << "ThreadPool thread joined.";
+		LOG_VERBOSE << "ThreadPool thread joined.";
 	}
 }
 
@@ -54,8 +58,16 @@ void ThreadPool::Wait()
 	}
 }
 
-void ThreadPool::ThreadFunction()
+int32_t ThreadPool::GetThreadIndex()
+{
+	return _threadIndex;
+}
+
+void ThreadPool::ThreadFunction(int32_t index)
 {
+	_threadIndex = index;
+	Profiler::SetThreadName("ThreadPool");
+
 	while (true) {
 		_threadReadySemaphore.release();
 		_queueSemaphore.acquire();
@@ -69,7 +81,11 @@ void ThreadPool::ThreadFunction()
 		_queue.pop_back();
 		_queueMutex.unlock();
 
-		action();
+		{
+			PROFILE_ZONE("ThreadPool::Task");
+			action();
+		}
+
 		_resultSemaphore.release();
 	}
 }
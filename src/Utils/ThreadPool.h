@@ -6,6 +6,8 @@
 #include <functional>
 #include <thread>
 #include <list>
+#include <vector>
+#include <cstdint>
 
 class ThreadPool
 {
@@ -16,6 +18,15 @@ public:
 	void Enqueue(std::function<void()> action);
 	void Wait();
 
+	uint32_t GetThreadCount()
+	{
+		return _threads.size();
+	}
+
+	// Index of the calling thread inside its pool, -1 for threads
+	// not owned by any pool.
+	static int32_t GetThreadIndex();
+
 private:
 	std::vector<std::thread*> _threads;
 	std::list<std::function<void()>> _queue;
@@ -27,7 +38,7 @@ private:
 	uint32_t _tasksInProgress;
 
 	bool _work;
-	void ThreadFunction();
+	void ThreadFunction(int32_t index);
 };
 
 #endif
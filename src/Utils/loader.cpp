@@ -1,147 +1,378 @@
 #include "loader.h"
 
 #include <cstring>
-#include <fstream>
-#include <map>
+#include <algorithm>
+#include <filesystem>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../ThirdParty/stb/stb_image.h"
 
-#include "TextFileParser.h"
+#include "ObjParser.h"
+#include "ThreadPool.h"
+#include "MeshCache.h"
+#include "CookedAssets.h"
+#include "ImageTransform.h"
+#include "ImageDecoder.h"
 #include "../Logger/logger.h"
 
 namespace Loader
 {
-	std::vector<uint8_t> LoadImage(
-		std::string file,
-		int& width,
-		int& height)
+	// Below this many face corners welding is not worth splitting.
+	static const size_t ParallelWeldThreshold = 1 << 18;
+
+	// Open addressing table from OBJ index triplets to vertex indices.
+	class CornerTable
 	{
-		int channels;
+	public:
+		CornerTable(size_t expectedSize)
+		{
+			size_t capacity = 16;
 
-		stbi_uc* pixels = stbi_load(
-			file.c_str(),
-			&width,
-			&height,
-			&channels,
-			STBI_rgb_alpha);
+			while (capacity < expectedSize * 2) {
+				capacity *= 2;
+			}
 
-		if (!pixels) {
-			throw std::runtime_error(
-				"Failed to load image from file");
+			_mask = capacity - 1;
+			_keys.resize(capacity, {ObjParser::NoIndex, 0, 0});
+			_values.resize(capacity);
 		}
 
-		std::vector<uint8_t> data(width * height * 4);
-		memcpy(data.data(), pixels, data.size());
+		// Returns the index stored for corner, storing value first if
+		// the corner is new.
+		uint32_t Insert(const ObjParser::Corner& corner, uint32_t value)
+		{
+			size_t slot = Hash(corner) & _mask;
 
-		stbi_image_free(pixels);
+			while (true) {
+				ObjParser::Corner& key = _keys[slot];
 
-		return data;
+				if (key.Position == ObjParser::NoIndex) {
+					key = corner;
+					_values[slot] = value;
+					return value;
+				}
+
+				if (key.Position == corner.Position &&
+					key.TexCoord == corner.TexCoord &&
+					key.Normal == corner.Normal)
+				{
+					return _values[slot];
+				}
+
+				slot = (slot + 1) & _mask;
+			}
+		}
+
+	private:
+		std::vector<ObjParser::Corner> _keys;
+		std::vector<uint32_t> _values;
+		size_t _mask;
+
+		static size_t Hash(const ObjParser::Corner& corner)
+		{
+			uint64_t hash = corner.Position * 0x9E3779B97F4A7C15ull;
+			hash ^= corner.TexCoord * 0xC2B2AE3D27D4EB4Full;
+			hash ^= corner.Normal * 0x165667B19E3779F9ull;
+
+			return hash ^ (hash >> 29);
+		}
+	};
+
+	// Unique corners in order of first appearance and the index of every
+	// corner into that list.
+	struct WeldedCorners
+	{
+		std::vector<ObjParser::Corner> Unique;
+		std::vector<uint32_t> Indices;
+	};
+
+	static void WeldCorners(
+		const ObjParser::Corner* begin,
+		const ObjParser::Corner* end,
+		WeldedCorners& welded)
+	{
+		CornerTable table(end - begin);
+
+		welded.Indices.resize(end - begin);
+
+		for (size_t i = 0; i < welded.Indices.size(); ++i) {
+			uint32_t nextIndex = welded.Unique.size();
+			uint32_t index = table.Insert(begin[i], nextIndex);
+
+			if (index == nextIndex) {
+				welded.Unique.push_back(begin[i]);
+			}
+
+			welded.Indices[i] = index;
+		}
 	}
 
-	VertexData LoadModel(std::string file)
+	// Chunks are welded independently and merged in chunk order, so the
+	// result matches the single threaded weld exactly.
+	static void WeldCornersParallel(
+		const std::vector<ObjParser::Corner>& corners,
+		ThreadPool* threadPool,
+		WeldedCorners& welded)
 	{
-		struct Vertex
-		{
-			glm::vec3 Pos;
-			glm::vec2 Tex;
-			glm::vec3 Normal;
+		size_t chunkCount = threadPool->GetThreadCount() * 4;
+		size_t chunkSize = (corners.size() - 1) / chunkCount + 1;
+		chunkCount = (corners.size() - 1) / chunkSize + 1;
+
+		std::vector<WeldedCorners> chunks(chunkCount);
 
-			bool operator<(const Vertex& vertex) const
+		for (size_t i = 0; i < chunkCount; ++i) {
+			const ObjParser::Corner* begin =
+				corners.data() + i * chunkSize;
+			const ObjParser::Corner* end = corners.data() +
+				std::min(corners.size(), (i + 1) * chunkSize);
+			WeldedCorners* chunk = &chunks[i];
+
+			threadPool->Enqueue([begin, end, chunk]() -> void
 			{
-				for (int i = 0; i < 3; ++i) {
-					if (Pos[i] != vertex.Pos[i]) {
-						return Pos[i] < vertex.Pos[i];
-					}
-				}
+				WeldCorners(begin, end, *chunk);
+			});
+		}
 
-				for (int i = 0; i < 2; ++i) {
-					if (Tex[i] != vertex.Tex[i]) {
-						return Tex[i] < vertex.Tex[i];
-					}
-				}
+		threadPool->Wait();
+
+		size_t uniqueCount = 0;
+
+		for (auto& chunk : chunks) {
+			uniqueCount += chunk.Unique.size();
+		}
+
+		CornerTable table(uniqueCount);
+		std::vector<std::vector<uint32_t>> remaps(chunkCount);
 
-				for (int i = 0; i < 3; ++i) {
-					if (Normal[i] != vertex.Normal[i]) {
-						return Normal[i] <
-							vertex.Normal[i];
-					}
+		for (size_t i = 0; i < chunkCount; ++i) {
+			remaps[i].resize(chunks[i].Unique.size());
+
+			for (size_t j = 0; j < chunks[i].Unique.size(); ++j) {
+				const ObjParser::Corner& corner =
+					chunks[i].Unique[j];
+				uint32_t nextIndex = welded.Unique.size();
+				uint32_t index =
+					table.Insert(corner, nextIndex);
+
+				if (index == nextIndex) {
+					welded.Unique.push_back(corner);
 				}
 
-				return false;
+				remaps[i][j] = index;
 			}
-		};
+		}
+
+		welded.Indices.resize(corners.size());
+
+		for (size_t i = 0; i < chunkCount; ++i) {
+			const WeldedCorners* chunk = &chunks[i];
+			const std::vector<uint32_t>* remap = &remaps[i];
+			uint32_t* indices =
+				welded.Indices.data() + i * chunkSize;
+
+			threadPool->Enqueue([chunk, remap, indices]() -> void
+			{
+				const uint32_t* local = chunk->Indices.data();
+				size_t count = chunk->Indices.size();
 
+				for (size_t j = 0; j < count; ++j) {
+					indices[j] = (*remap)[local[j]];
+				}
+			});
+		}
+
+		threadPool->Wait();
+	}
+
+	VertexData LoadModel(std::string file, ThreadPool* threadPool)
+	{
 		VertexData data;
 
-		auto modelFile = TextFileParser::ParseFile(
-			file,
-			{' ', '/'});
-
-		std::vector<Vertex> vertices;
-
-		std::vector<glm::vec3> vertPositions;
-		std::vector<glm::vec3> normals;
-		std::vector<glm::vec2> texCoords;
-
-		for (auto line : modelFile) {
-			if (line[0] == "v") {
-				glm::vec3 vertex;
-				vertex[0] = std::stof(line[1]);
-				vertex[1] = std::stof(line[2]);
-				vertex[2] = std::stof(line[3]);
-				vertPositions.push_back(vertex);
-			} else if (line[0] == "vt") {
-				glm::vec2 texCoord;
-				texCoord[0] = std::stof(line[1]);
-				texCoord[1] = 1.0 - std::stof(line[2]);
-				texCoords.push_back(texCoord);
-			} else if (line[0] == "vn") {
-				glm::vec3 normal;
-				normal[0] = std::stof(line[1]);
-				normal[1] = std::stof(line[2]);
-				normal[2] = std::stof(line[3]);
-				normals.push_back(normal);
-			} else if (line[0] == "f") {
-				Vertex vertex;
-				vertex.Pos = vertPositions[
-					std::stoi(line[1]) - 1];
-				vertex.Tex = texCoords[std::stoi(line[2]) - 1];
-				vertex.Normal = normals[std::stoi(line[3]) - 1];
-				vertices.push_back(vertex);
-
-				vertex.Pos = vertPositions[
-					std::stoi(line[4]) - 1];
-				vertex.Tex = texCoords[std::stoi(line[5]) - 1];
-				vertex.Normal = normals[std::stoi(line[6]) - 1];
-				vertices.push_back(vertex);
-
-				vertex.Pos = vertPositions[
-					std::stoi(line[7]) - 1];
-				vertex.Tex = texCoords[std::stoi(line[8]) - 1];
-				vertex.Normal = normals[std::stoi(line[9]) - 1];
-				vertices.push_back(vertex);
-			}
+		ObjParser::Mesh mesh = ObjParser::ParseFile(file, threadPool);
+
+		WeldedCorners welded;
+
+		bool parallel = threadPool &&
+			mesh.Corners.size() >= ParallelWeldThreshold;
+
+		if (parallel) {
+			WeldCornersParallel(mesh.Corners, threadPool, welded);
+		} else {
+			WeldCorners(
+				mesh.Corners.data(),
+				mesh.Corners.data() + mesh.Corners.size(),
+				welded);
 		}
 
-		std::map<Vertex, uint32_t> indexedVertices;
-		uint32_t maxIndex = 0;
+		data.Vertices.resize(welded.Unique.size());
+		data.TexCoords.resize(welded.Unique.size());
+		data.Normals.resize(welded.Unique.size());
 
-		for (auto vertex : vertices) {
-			auto vert = indexedVertices.find(vertex);
+		for (size_t i = 0; i < welded.Unique.size(); ++i) {
+			const ObjParser::Corner& corner = welded.Unique[i];
 
-			if (vert == indexedVertices.end()) {
-				indexedVertices[vertex] = maxIndex;
-				++maxIndex;
+			data.Vertices[i] = mesh.Positions[corner.Position];
+			data.TexCoords[i] =
+				corner.TexCoord == ObjParser::NoIndex ?
+				glm::vec2(0.0f) :
+				mesh.TexCoords[corner.TexCoord];
+			data.Normals[i] =
+				corner.Normal == ObjParser::NoIndex ?
+				glm::vec3(0.0f) :
+				mesh.Normals[corner.Normal];
+		}
 
-				data.Vertices.push_back(vertex.Pos);
-				data.TexCoords.push_back(vertex.Tex);
-				data.Normals.push_back(vertex.Normal);
-			}
+		data.Indices.swap(welded.Indices);
+
+		return data;
+	}
+
+	Bounds CalculateBounds(const std::vector<glm::vec3>& vertices)
+	{
+		Bounds bounds;
+		bounds.Center = glm::vec3(0.0f);
+		bounds.Radius = 0.0f;
+
+		for (auto& vertex : vertices) {
+			bounds.Center += vertex;
+		}
+
+		bounds.Center /= vertices.size();
 
-			data.Indices.push_back(indexedVertices[vertex]);
+		for (auto& vertex : vertices) {
+			bounds.Radius = std::max(
+				bounds.Radius,
+				glm::length(vertex - bounds.Center));
+		}
+
+		return bounds;
+	}
+
+	std::shared_ptr<MeshCache::Mesh> OpenModelCached(
+		std::string file,
+		ThreadPool* threadPool)
+	{
+		auto cache = std::make_shared<MeshCache::Mesh>();
+		std::string cooked = CookedAssets::Find(file);
+
+		if ((!cooked.empty() && cache->Open(file, cooked)) ||
+			cache->Open(file))
+		{
+			return cache;
+		}
+
+		VertexData data = LoadModel(file, threadPool);
+		Bounds bounds = CalculateBounds(data.Vertices);
+
+		cache->Create(file, data, &bounds);
+
+		try {
+			cache->Write(MeshCache::GetCachePath(file));
+		} catch (std::runtime_error& error) {
+			LOG_WARNING << "Mesh cache not written: " <<
+				error.what();
+		}
+
+		return cache;
+	}
+
+	VertexData LoadModelCached(
+		std::string file,
+		ThreadPool* threadPool,
+		Bounds* bounds)
+	{
+		auto cache = OpenModelCached(file, threadPool);
+		VertexData data = cache->ToVertexData();
+
+		if (bounds && !cache->GetBounds(*bounds)) {
+			*bounds = CalculateBounds(data.Vertices);
 		}
 
 		return data;
 	}
+
+	// Cooked outputs that fail to read fall back to the source.
+	static bool ReadCooked(
+		std::string file,
+		TextureContainer::Texture& texture)
+	{
+		std::string cooked = CookedAssets::Find(file);
+
+		if (cooked.empty()) {
+			return false;
+		}
+
+		try {
+			texture = TextureContainer::Read(cooked);
+		} catch (std::runtime_error& error) {
+			LOG_WARNING << "Cooked texture not read: " <<
+				error.what();
+			return false;
+		}
+
+		return true;
+	}
+
+	static bool IsContainerFile(std::string file)
+	{
+		std::string extension = std::filesystem::path(file).
+			extension().string();
+
+		std::transform(extension.begin(), extension.end(),
+			extension.begin(),
+			[](unsigned char c) -> char {return std::tolower(c);});
+
+		return extension == ".dds" || extension == ".ktx2";
+	}
+
+	LoadedTexture LoadTexture(std::string file)
+	{
+		LoadedTexture texture;
+		texture.IsContainer = true;
+
+		if (ReadCooked(file, texture.Container)) {
+			return texture;
+		}
+
+		if (IsContainerFile(file)) {
+			texture.Container = TextureContainer::Read(file);
+			return texture;
+		}
+
+		texture.IsContainer = false;
+		texture.Image = DecodedImage::Decode(file);
+
+		return texture;
+	}
+
+	TextureContainer::Texture LoadSkybox(
+		std::string file,
+		ThreadPool* threadPool)
+	{
+		TextureContainer::Texture cube;
+
+		if (ReadCooked(file, cube) &&
+			cube.Cube &&
+			cube.LayerCount == 6)
+		{
+			return cube;
+		}
+
+		DecodedImage strip = DecodedImage::Decode(file);
+
+		cube.Format = TextureContainer::TextureFormat::RGBA8_SRGB;
+		cube.Width = strip.GetWidth() / 6;
+		cube.Height = strip.GetHeight();
+		cube.LayerCount = 6;
+		cube.MipLevels = 1;
+		cube.Cube = true;
+		cube.Data = ImageTransform::SkyboxToCube(
+			strip.GetWidth(),
+			strip.GetHeight(),
+			strip.GetData(),
+			strip.GetSize(),
+			threadPool);
+
+		return cube;
+	}
 };
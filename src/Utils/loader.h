@@ -4,6 +4,7 @@
 #include <string>
 #include <stdexcept>
 #include <vector>
+#include <memory>
 #include <cstdint>
 
 #define GLM_FORCE_RADIANS
@@ -14,13 +15,18 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/hash.hpp>
 
-namespace Loader
+#include "TextureContainer.h"
+#include "ImageDecoder.h"
+
+class ThreadPool;
+
+namespace MeshCache
 {
-	std::vector<uint8_t> LoadImage(
-		std::string file,
-		int& width,
-		int& height);
+	class Mesh;
+}
 
+namespace Loader
+{
 	struct VertexData
 	{
 		std::vector<glm::vec3> Vertices;
@@ -29,7 +35,57 @@ namespace Loader
 		std::vector<uint32_t> Indices;
 	};
 
-	VertexData LoadModel(std::string file);
+	// Collision bounding sphere: vertex average and farthest vertex.
+	struct Bounds
+	{
+		glm::vec3 Center;
+		float Radius;
+	};
+
+	Bounds CalculateBounds(const std::vector<glm::vec3>& vertices);
+
+	// Vertices are welded by their OBJ index triplet. With a thread pool
+	// large files are parsed and welded in parallel, the result is
+	// identical. Must not be called from a thread of that pool.
+	VertexData LoadModel(
+		std::string file,
+		ThreadPool* threadPool = nullptr);
+
+	// The cooked mesh of file when assetcook has an up to date one, see
+	// CookedAssets, or else the mesh cache next to file, mapped. Otherwise
+	// the model is parsed, laid out in memory and the cache next to file
+	// is rewritten. The vertices are interleaved as the GPU takes them.
+	std::shared_ptr<MeshCache::Mesh> OpenModelCached(
+		std::string file,
+		ThreadPool* threadPool = nullptr);
+
+	// Same as OpenModelCached but split into separate arrays, for
+	// callers that change the data.
+	VertexData LoadModelCached(
+		std::string file,
+		ThreadPool* threadPool = nullptr,
+		Bounds* bounds = nullptr);
+
+	// A texture as read from disk. Containers keep their stored mips and
+	// block compression, decoded images keep the decoder's buffer so the
+	// pixels reach the upload without a copy.
+	struct LoadedTexture
+	{
+		bool IsContainer;
+		TextureContainer::Texture Container;
+		DecodedImage Image;
+	};
+
+	// The cooked texture of file when there is one, else file itself:
+	// DDS and KTX2 files are read as containers, other images decoded.
+	LoadedTexture LoadTexture(std::string file);
+
+	// Six layer cube map of a horizontal skybox strip. The cooked cube
+	// map of file when there is one, otherwise the strip is decoded and
+	// laid out with ImageTransform::SkyboxToCube.
+	TextureContainer::Texture LoadSkybox(
+		std::string file,
+		ThreadPool* threadPool = nullptr);
 }
 
 #endif
@@ -1,7 +1,5 @@
 #include "BufferHelper.h"
 
-#include <cstring>
-
 namespace BufferHelper
 {
 	Buffer CreateBuffer(VkDevice device,
@@ -10,7 +8,8 @@ namespace BufferHelper
 		VkMemoryPropertyFlags properties,
 		MemorySystem* memorySystem,
 		PhysicalDeviceSupport* deviceSupport,
-		uint32_t domain)
+		uint32_t domain,
+		MemorySystem::ResourceTag tag)
 	{
 		Buffer buffer;
 
@@ -46,7 +45,8 @@ namespace BufferHelper
 		buffer.Allocation = memorySystem->Allocate(
 			memRequirements.size,
 			allocProps,
-			domain);
+			domain,
+			tag);
 
 		vkBindBufferMemory(
 			device,
@@ -66,77 +66,4 @@ namespace BufferHelper
 		vkDestroyBuffer(device, buffer.Buffer, nullptr);
 		memorySystem->Free(buffer.Allocation, domain);
 	}
-
-	void CopyBuffer(
-		Buffer src,
-		Buffer dst,
-		CommandPool* commandPool,
-		VkQueue graphicsQueue)
-	{
-		VkCommandBuffer commandBuffer =
-			commandPool->StartOneTimeBuffer();
-
-		VkBufferCopy copyRegion{};
-		copyRegion.srcOffset = 0; // Optional
-		copyRegion.dstOffset = 0; // Optional
-		copyRegion.size = src.Allocation.Size;
-
-		vkCmdCopyBuffer(
-			commandBuffer,
-			src.Buffer,
-			dst.Buffer,
-			1,
-			&copyRegion);
-
-		commandPool->EndOneTimeBuffer(
-			commandBuffer,
-			graphicsQueue);
-	}
-
-	void LoadDataToBuffer(
-		VkDevice device,
-		Buffer buffer,
-		const void* data,
-		size_t size,
-		MemorySystem* memorySystem,
-		PhysicalDeviceSupport* deviceSupport,
-		CommandPool* commandPool,
-		VkQueue graphicsQueue)
-	{
-		Buffer stagingBuffer = CreateBuffer(
-			device,
-			size,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			memorySystem,
-			deviceSupport);
-
-		void* mappedMemory;
-
-		vkMapMemory(
-			device,
-			stagingBuffer.Allocation.Memory,
-			stagingBuffer.Allocation.Offset,
-			stagingBuffer.Allocation.Size,
-			0,
-			&mappedMemory);
-
-		memcpy(mappedMemory, data, size);
-
-		vkUnmapMemory(
-			device,
-			stagingBuffer.Allocation.Memory);
-
-		CopyBuffer(
-			stagingBuffer,
-			buffer,
-			commandPool,
-			graphicsQueue);
-
-		DestroyBuffer(
-			device,
-			stagingBuffer,
-			memorySystem);
-	}
 }
@@ -22,29 +22,15 @@ namespace BufferHelper
 		VkMemoryPropertyFlags properties,
 		MemorySystem* memorySystem,
 		PhysicalDeviceSupport* deviceSupport,
-		uint32_t domain = 0);
+		uint32_t domain = 0,
+		MemorySystem::ResourceTag tag =
+			MemorySystem::ResourceTag::Other);
 
 	void DestroyBuffer(
 		VkDevice device,
 		Buffer buffer,
 		MemorySystem* memorySystem,
 		uint32_t domain = 0);
-
-	void CopyBuffer(
-		Buffer src,
-		Buffer dst,
-		CommandPool* commandPool,
-		VkQueue graphicsQueue);
-
-	void LoadDataToBuffer(
-		VkDevice device,
-		Buffer buffer,
-		const void* data,
-		size_t size,
-		MemorySystem* memorySystem,
-		PhysicalDeviceSupport* deviceSupport,
-		CommandPool* commandPool,
-		VkQueue graphicsQueue);
 }
 
 #endif
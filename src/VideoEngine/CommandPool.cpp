@@ -74,13 +74,26 @@ void CommandPool::EndOneTimeBuffer(
 {
 	vkEndCommandBuffer(commandBuffer);
 
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkFence fence;
+
+	VkResult res = vkCreateFence(_device, &fenceInfo, nullptr, &fence);
+
+	if (res != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create fence.");
+	}
+
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
+	// Waits for this buffer only, not for frames queued before it.
+	vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence);
+	vkWaitForFences(_device, 1, &fence, VK_TRUE, UINT64_MAX);
 
+	vkDestroyFence(_device, fence, nullptr);
 	DestroyCommandBuffer(commandBuffer);
 }
@@ -0,0 +1,165 @@
+#include "Defragmenter.h"
+
+#include <stdexcept>
+
+#include "../Logger/logger.h"
+#include "../Utils/Profiler.h"
+#include "../Utils/Metrics.h"
+
+Defragmenter::Defragmenter(
+	VkDevice device,
+	MemorySystem* memorySystem,
+	TextureHandler* textures,
+	CommandPool* commandPool,
+	VkQueue graphicsQueue,
+	uint32_t bytesPerUpdate,
+	float maxUsage)
+{
+	_device = device;
+	_memorySystem = memorySystem;
+	_textures = textures;
+	_commandPool = commandPool;
+	_graphicsQueue = graphicsQueue;
+	_bytesPerUpdate = bytesPerUpdate;
+	_maxUsage = maxUsage;
+
+	_page = VK_NULL_HANDLE;
+}
+
+Defragmenter::~Defragmenter()
+{
+	while (!_moves.empty()) {
+		Retire(true);
+	}
+
+	if (_page != VK_NULL_HANDLE) {
+		_memorySystem->EndEvacuation();
+	}
+}
+
+void Defragmenter::Update()
+{
+	PROFILE_ZONE("Defragmenter::Update");
+
+	Retire(false);
+
+	if (_page == VK_NULL_HANDLE) {
+		_page = _memorySystem->BeginEvacuation(_maxUsage, _stuckPages);
+
+		if (_page == VK_NULL_HANDLE) {
+			return;
+		}
+	}
+
+	std::vector<uint32_t> textures = _textures->GetTexturesIn(_page);
+
+	// Either the old images still wait for their copies or all that
+	// is left in the page cannot be moved.
+	if (textures.empty()) {
+		if (_moves.empty()) {
+			FinishPage();
+		}
+
+		return;
+	}
+
+	Move move;
+	move.CommandBuffer = _commandPool->CreateCommandBuffer();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(move.CommandBuffer, &beginInfo);
+
+	uint64_t bytes = 0;
+
+	for (uint32_t index : textures) {
+		if (bytes >= _bytesPerUpdate) {
+			break;
+		}
+
+		TextureHandler::TextureDescriptor old;
+
+		if (_textures->MoveTexture(index, move.CommandBuffer, old)) {
+			move.Retired.push_back(old);
+			bytes += old.Image.Allocation.Size;
+		}
+	}
+
+	vkEndCommandBuffer(move.CommandBuffer);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkResult res = vkCreateFence(
+		_device,
+		&fenceInfo,
+		nullptr,
+		&move.Fence);
+
+	if (res != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create fence.");
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &move.CommandBuffer;
+
+	// The fence also covers every frame submitted before, which may
+	// still sample the old images.
+	res = vkQueueSubmit(_graphicsQueue, 1, &submitInfo, move.Fence);
+
+	if (res != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit texture moves.");
+	}
+
+	METRIC_COUNTER_ADD("memory.defragment_bytes", bytes);
+
+	_moves.push_back(move);
+}
+
+void Defragmenter::Retire(bool wait)
+{
+	if (wait && !_moves.empty()) {
+		vkWaitForFences(
+			_device,
+			1,
+			&_moves.front().Fence,
+			VK_TRUE,
+			UINT64_MAX);
+	}
+
+	while (!_moves.empty()) {
+		Move& move = _moves.front();
+
+		if (vkGetFenceStatus(_device, move.Fence) != VK_SUCCESS) {
+			break;
+		}
+
+		// Frees the old ranges, the last one releases the page.
+		for (auto& descriptor : move.Retired) {
+			_textures->DestroyTextureDescriptor(descriptor);
+		}
+
+		vkDestroyFence(_device, move.Fence, nullptr);
+		_commandPool->DestroyCommandBuffer(move.CommandBuffer);
+
+		_moves.pop_front();
+	}
+}
+
+void Defragmenter::FinishPage()
+{
+	if (_memorySystem->EndEvacuation()) {
+		LOG_VERBOSE << "Defragmenter released a page.";
+		METRIC_COUNTER_ADD("memory.defragmented_pages", 1);
+
+		_stuckPages.clear();
+	} else {
+		_stuckPages.insert(_page);
+	}
+
+	_page = VK_NULL_HANDLE;
+}
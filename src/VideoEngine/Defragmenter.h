@@ -0,0 +1,65 @@
+#ifndef _DEFRAGMENTER_H
+#define _DEFRAGMENTER_H
+
+#include <vector>
+#include <deque>
+#include <set>
+
+#include <vulkan/vulkan.h>
+
+#include "MemorySystem.h"
+#include "TextureHandler.h"
+#include "CommandPool.h"
+
+#define DEFRAGMENT_BYTES_PER_UPDATE (8 * 1024 * 1024)
+#define DEFRAGMENT_MAX_USAGE 0.25f
+
+// Compacts device memory over many frames. Picks a sparsely used page,
+// copies the textures living in it into other pages a few per Update
+// and releases the page to the driver once it is empty. Copies run on
+// the graphics queue behind a fence, the old images are destroyed when
+// it signals. Only textures are moved, a page holding anything else
+// stays and is not picked again until some other page was released.
+class Defragmenter
+{
+public:
+	Defragmenter(
+		VkDevice device,
+		MemorySystem* memorySystem,
+		TextureHandler* textures,
+		CommandPool* commandPool,
+		VkQueue graphicsQueue,
+		uint32_t bytesPerUpdate = DEFRAGMENT_BYTES_PER_UPDATE,
+		float maxUsage = DEFRAGMENT_MAX_USAGE);
+	Defragmenter(const Defragmenter& defragmenter) = delete;
+	// Waits for the copies in flight.
+	~Defragmenter();
+
+	// Render thread, between frames.
+	void Update();
+
+private:
+	struct Move
+	{
+		VkCommandBuffer CommandBuffer;
+		VkFence Fence;
+		std::vector<TextureHandler::TextureDescriptor> Retired;
+	};
+
+	VkDevice _device;
+	MemorySystem* _memorySystem;
+	TextureHandler* _textures;
+	CommandPool* _commandPool;
+	VkQueue _graphicsQueue;
+	uint32_t _bytesPerUpdate;
+	float _maxUsage;
+
+	VkDeviceMemory _page;
+	std::set<VkDeviceMemory> _stuckPages;
+	std::deque<Move> _moves;
+
+	void Retire(bool wait);
+	void FinishPage();
+};
+
+#endif
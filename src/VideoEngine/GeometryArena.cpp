@@ -0,0 +1,269 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../Utils/Metrics.h"
+
+GeometryArena::GeometryArena(
+	VkDevice device,
+	MemorySystem* memorySystem,
+	PhysicalDeviceSupport* deviceSupport,
+	StagingRing* stagingRing,
+	uint32_t vertexStride,
+	uint32_t instanceStride)
+{
+	_device = device;
+	_memorySystem = memorySystem;
+	_deviceSupport = deviceSupport;
+	_stagingRing = stagingRing;
+	_vertexStride = vertexStride;
+	_instanceStride = instanceStride;
+
+	AddChunk(0, 0, 0);
+}
+
+GeometryArena::~GeometryArena()
+{
+	for (auto chunk : _chunks) {
+		BufferHelper::DestroyBuffer(
+			_device,
+			chunk->Vertices,
+			_memorySystem);
+		BufferHelper::DestroyBuffer(
+			_device,
+			chunk->Indices,
+			_memorySystem);
+		BufferHelper::DestroyBuffer(
+			_device,
+			chunk->Instances,
+			_memorySystem);
+
+		delete chunk;
+	}
+}
+
+GeometryArena::Allocation GeometryArena::Add(
+	const void* vertices,
+	uint32_t vertexCount,
+	const uint32_t* indices,
+	uint32_t indexCount,
+	const void* instances,
+	uint32_t instanceCount)
+{
+	if ((uint64_t)vertexCount * _vertexStride > UINT32_MAX ||
+		(uint64_t)indexCount * sizeof(uint32_t) > UINT32_MAX ||
+		(uint64_t)instanceCount * _instanceStride > UINT32_MAX)
+	{
+		throw std::runtime_error("Model geometry is too large.");
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Allocation allocation;
+	bool found = false;
+
+	for (uint32_t i = 0; i < _chunks.size() && !found; ++i) {
+		allocation.Chunk = i;
+		found = Allocate(
+			_chunks[i],
+			vertexCount,
+			indexCount,
+			instanceCount,
+			allocation);
+	}
+
+	if (!found) {
+		allocation.Chunk = _chunks.size();
+
+		Chunk* chunk = AddChunk(vertexCount, indexCount, instanceCount);
+		Allocate(
+			chunk,
+			vertexCount,
+			indexCount,
+			instanceCount,
+			allocation);
+	}
+
+	Chunk* chunk = _chunks[allocation.Chunk];
+
+	Upload(
+		chunk->Vertices,
+		vertices,
+		(size_t)vertexCount * _vertexStride,
+		(VkDeviceSize)allocation.VertexOffset * _vertexStride);
+	Upload(
+		chunk->Indices,
+		indices,
+		(size_t)indexCount * sizeof(uint32_t),
+		(VkDeviceSize)allocation.FirstIndex * sizeof(uint32_t));
+	Upload(
+		chunk->Instances,
+		instances,
+		(size_t)instanceCount * _instanceStride,
+		(VkDeviceSize)allocation.FirstInstance * _instanceStride);
+
+	METRIC_COUNTER_ADD("geometry.allocations", 1);
+
+	return allocation;
+}
+
+void GeometryArena::Free(const Allocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Chunk* chunk = _chunks[allocation.Chunk];
+
+	chunk->VertexRanges.Free(allocation.VertexBlock);
+	chunk->IndexRanges.Free(allocation.IndexBlock);
+	chunk->InstanceRanges.Free(allocation.InstanceBlock);
+
+	METRIC_COUNTER_ADD("geometry.allocations", -1);
+}
+
+void GeometryArena::Bind(VkCommandBuffer commandBuffer, uint32_t chunk)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VkBuffer vertexBuffers[] = {
+		_chunks[chunk]->Vertices.Buffer,
+		_chunks[chunk]->Instances.Buffer
+	};
+
+	VkDeviceSize offsets[] = {0, 0};
+	vkCmdBindVertexBuffers(
+		commandBuffer,
+		0,
+		2,
+		vertexBuffers,
+		offsets);
+
+	vkCmdBindIndexBuffer(
+		commandBuffer,
+		_chunks[chunk]->Indices.Buffer,
+		0,
+		VK_INDEX_TYPE_UINT32);
+}
+
+// Chunks are at least the default size, larger for data that would not
+// fit one.
+GeometryArena::Chunk* GeometryArena::AddChunk(
+	uint32_t vertexCount,
+	uint32_t indexCount,
+	uint32_t instanceCount)
+{
+	uint64_t vertexSize = (uint64_t)_vertexStride *
+		std::max<uint32_t>(vertexCount, GEOMETRY_ARENA_VERTICES);
+	uint64_t indexSize = (uint64_t)sizeof(uint32_t) *
+		std::max<uint32_t>(indexCount, GEOMETRY_ARENA_INDICES);
+	uint64_t instanceSize = (uint64_t)_instanceStride *
+		std::max<uint32_t>(instanceCount, GEOMETRY_ARENA_INSTANCES);
+
+	if (vertexSize > UINT32_MAX ||
+		indexSize > UINT32_MAX ||
+		instanceSize > UINT32_MAX)
+	{
+		throw std::runtime_error("Model geometry is too large.");
+	}
+
+	Chunk* chunk = new Chunk{
+		BufferHelper::CreateBuffer(
+			_device,
+			vertexSize,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			_memorySystem,
+			_deviceSupport,
+			0,
+			MemorySystem::ResourceTag::Mesh),
+		BufferHelper::CreateBuffer(
+			_device,
+			indexSize,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			_memorySystem,
+			_deviceSupport,
+			0,
+			MemorySystem::ResourceTag::Mesh),
+		BufferHelper::CreateBuffer(
+			_device,
+			instanceSize,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			_memorySystem,
+			_deviceSupport,
+			0,
+			MemorySystem::ResourceTag::Mesh),
+		TlsfAllocator(vertexSize, _vertexStride),
+		TlsfAllocator(indexSize, sizeof(uint32_t)),
+		TlsfAllocator(instanceSize, _instanceStride)
+	};
+
+	_chunks.push_back(chunk);
+
+	METRIC_COUNTER_ADD("geometry.chunks", 1);
+
+	return chunk;
+}
+
+// All three ranges or none.
+bool GeometryArena::Allocate(
+	Chunk* chunk,
+	uint32_t vertexCount,
+	uint32_t indexCount,
+	uint32_t instanceCount,
+	Allocation& allocation)
+{
+	uint32_t vertexOffset;
+	uint32_t indexOffset;
+	uint32_t instanceOffset;
+
+	allocation.VertexBlock = chunk->VertexRanges.Allocate(
+		vertexCount * _vertexStride,
+		vertexOffset);
+
+	if (allocation.VertexBlock == TlsfAllocator::NoBlock) {
+		return false;
+	}
+
+	allocation.IndexBlock = chunk->IndexRanges.Allocate(
+		indexCount * sizeof(uint32_t),
+		indexOffset);
+
+	if (allocation.IndexBlock == TlsfAllocator::NoBlock) {
+		chunk->VertexRanges.Free(allocation.VertexBlock);
+		return false;
+	}
+
+	allocation.InstanceBlock = chunk->InstanceRanges.Allocate(
+		instanceCount * _instanceStride,
+		instanceOffset);
+
+	if (allocation.InstanceBlock == TlsfAllocator::NoBlock) {
+		chunk->VertexRanges.Free(allocation.VertexBlock);
+		chunk->IndexRanges.Free(allocation.IndexBlock);
+		return false;
+	}
+
+	allocation.VertexOffset = vertexOffset / _vertexStride;
+	allocation.FirstIndex = indexOffset / sizeof(uint32_t);
+	allocation.FirstInstance = instanceOffset / _instanceStride;
+
+	return true;
+}
+
+void GeometryArena::Upload(
+	BufferHelper::Buffer buffer,
+	const void* data,
+	size_t size,
+	VkDeviceSize offset)
+{
+	if (size == 0) {
+		return;
+	}
+
+	_stagingRing->CopyToBuffer(buffer, data, size, offset);
+}
@@ -0,0 +1,106 @@
+#ifndef _GEOMETRY_ARENA_H
+#define _GEOMETRY_ARENA_H
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "BufferHelper.h"
+#include "StagingRing.h"
+#include "TlsfAllocator.h"
+
+// Elements per chunk.
+#define GEOMETRY_ARENA_VERTICES (1 << 20)
+#define GEOMETRY_ARENA_INDICES (1 << 22)
+#define GEOMETRY_ARENA_INSTANCES (1 << 16)
+
+// Shared vertex, index and instance buffers for all models. Models get
+// element ranges in them and are drawn through offsets, so a pass binds
+// the buffers once instead of once per model. A chunk holds one buffer
+// of each kind, more chunks are added when the first one is full.
+class GeometryArena
+{
+public:
+	// Offsets are in elements, ready for vkCmdDrawIndexed.
+	struct Allocation
+	{
+		uint32_t Chunk;
+
+		uint32_t VertexOffset;
+		uint32_t FirstIndex;
+		uint32_t FirstInstance;
+
+		uint32_t VertexBlock;
+		uint32_t IndexBlock;
+		uint32_t InstanceBlock;
+	};
+
+	GeometryArena(
+		VkDevice device,
+		MemorySystem* memorySystem,
+		PhysicalDeviceSupport* deviceSupport,
+		StagingRing* stagingRing,
+		uint32_t vertexStride,
+		uint32_t instanceStride);
+	GeometryArena(const GeometryArena& arena) = delete;
+	~GeometryArena();
+
+	// Takes ranges for the data and records its upload on the staging
+	// ring, which the caller submits.
+	Allocation Add(
+		const void* vertices,
+		uint32_t vertexCount,
+		const uint32_t* indices,
+		uint32_t indexCount,
+		const void* instances,
+		uint32_t instanceCount);
+	// The GPU must be done with the ranges.
+	void Free(const Allocation& allocation);
+
+	// Binds the vertex buffer to binding 0, the instance buffer to
+	// binding 1 and the index buffer.
+	void Bind(VkCommandBuffer commandBuffer, uint32_t chunk);
+
+private:
+	struct Chunk
+	{
+		BufferHelper::Buffer Vertices;
+		BufferHelper::Buffer Indices;
+		BufferHelper::Buffer Instances;
+
+		TlsfAllocator VertexRanges;
+		TlsfAllocator IndexRanges;
+		TlsfAllocator InstanceRanges;
+	};
+
+	VkDevice _device;
+	MemorySystem* _memorySystem;
+	PhysicalDeviceSupport* _deviceSupport;
+	StagingRing* _stagingRing;
+
+	uint32_t _vertexStride;
+	uint32_t _instanceStride;
+
+	std::vector<Chunk*> _chunks;
+	std::mutex _mutex;
+
+	Chunk* AddChunk(
+		uint32_t vertexCount,
+		uint32_t indexCount,
+		uint32_t instanceCount);
+	bool Allocate(
+		Chunk* chunk,
+		uint32_t vertexCount,
+		uint32_t indexCount,
+		uint32_t instanceCount,
+		Allocation& allocation);
+	void Upload(
+		BufferHelper::Buffer buffer,
+		const void* data,
+		size_t size,
+		VkDeviceSize offset);
+};
+
+#endif
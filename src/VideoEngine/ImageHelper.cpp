@@ -1,7 +1,5 @@
 #include "ImageHelper.h"
 
-#include <cstring>
-
 namespace ImageHelper
 {
 	Image CreateImage(
@@ -17,7 +15,8 @@ namespace ImageHelper
 		MemorySystem* memorySystem,
 		PhysicalDeviceSupport* deviceSupport,
 		VkImageCreateFlagBits flags,
-		uint32_t layerCount)
+		uint32_t layerCount,
+		MemorySystem::ResourceTag tag)
 	{
 		Image image;
 		image.Format = format;
@@ -62,7 +61,9 @@ namespace ImageHelper
 
 		image.Allocation = memorySystem->Allocate(
 			memRequirements.size,
-			allocProps);
+			allocProps,
+			0,
+			tag);
 
 		vkBindImageMemory(
 			device,
@@ -223,143 +224,6 @@ namespace ImageHelper
 		commandPool->EndOneTimeBuffer(commandBuffer, graphicsQueue);
 	}
 
-	void CopyBufferToImage(
-		BufferHelper::Buffer buffer,
-		Image image,
-		uint32_t width,
-		uint32_t height,
-		CommandPool* commandPool,
-		VkQueue graphicsQueue,
-		uint32_t layerCount)
-	{
-		VkCommandBuffer commandBuffer =
-			commandPool->StartOneTimeBuffer();
-
-		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = layerCount;
-
-		region.imageOffset = {0, 0, 0};
-		region.imageExtent = {
-			width,
-			height,
-			1
-		};
-
-		vkCmdCopyBufferToImage(
-			commandBuffer,
-			buffer.Buffer,
-			image.Image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&region);
-
-		commandPool->EndOneTimeBuffer(commandBuffer, graphicsQueue);
-	}
-
-	void RotateClockWise(
-		uint8_t* image,
-		uint32_t width,
-		uint32_t height)
-	{
-		std::vector<uint8_t> buffer(width * height * 4);
-
-		for (uint32_t y = 0; y < height; ++y) {
-			for (uint32_t x = 0; x < width; ++x) {
-				for (uint32_t c = 0; c < 4; ++c) {
-					buffer[(height * x + height - 1 - y) *
-						4 + c] =
-					image[(width * y + x) * 4 + c];
-				}
-			}
-		}
-
-		memcpy(image, buffer.data(), width * height * 4);
-	}
-
-	void RotateCounterClockWise(
-		uint8_t* image,
-		uint32_t width,
-		uint32_t height)
-	{
-		std::vector<uint8_t> buffer(width * height * 4);
-
-		for (uint32_t y = 0; y < height; ++y) {
-			for (uint32_t x = 0; x < width; ++x) {
-				for (uint32_t c = 0; c < 4; ++c) {
-					buffer[(height * (width - 1 - x) + y) *
-						4 + c] =
-					image[(width * y + x) * 4 + c];
-				}
-			}
-		}
-
-		memcpy(image, buffer.data(), width * height * 4);
-	}
-
-	void FlipVertically(
-		uint8_t* image,
-		uint32_t width,
-		uint32_t height)
-	{
-		for (uint32_t y = 0; y < height / 2; ++y) {
-			for (uint32_t x = 0; x < width; ++x) {
-				for (uint32_t c = 0; c < 4; ++c) {
-					uint32_t upIndex = (width * y + x) *
-						4 + c;
-					uint32_t downIndex =
-						(width * (height - 1 - y) + x) *
-						4 + c;
-
-					uint8_t tmp = image[downIndex];
-					image[downIndex] = image[upIndex];
-					image[upIndex] = tmp;
-				}
-			}
-		}
-	}
-
-	void FlipHorizontally(
-		uint8_t* image,
-		uint32_t width,
-		uint32_t height)
-	{
-		for (uint32_t y = 0; y < height; ++y) {
-			for (uint32_t x = 0; x < width / 2; ++x) {
-				for (uint32_t c = 0; c < 4; ++c) {
-					uint32_t leftIndex = (width * y + x) *
-						4 + c;
-					uint32_t rightIndex =
-						(width * y + width - 1 - x) *
-						4 + c;
-
-					uint8_t tmp = image[rightIndex];
-					image[rightIndex] = image[leftIndex];
-					image[leftIndex] = tmp;
-				}
-			}
-		}
-	}
-
-	void Swap(
-		uint8_t* image1,
-		uint8_t* image2,
-		uint32_t width,
-		uint32_t height)
-	{
-		std::vector<uint8_t> buffer(width * height * 4);
-
-		memcpy(buffer.data(), image1, buffer.size());
-		memcpy(image1, image2, buffer.size());
-		memcpy(image2, buffer.data(), buffer.size());
-	}
-
 	VkSampler CreateImageSampler(
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
@@ -28,7 +28,9 @@ namespace ImageHelper
 		MemorySystem* memorySystem,
 		PhysicalDeviceSupport* deviceSupport,
 		VkImageCreateFlagBits flags = (VkImageCreateFlagBits)0,
-		uint32_t layerCount = 1);
+		uint32_t layerCount = 1,
+		MemorySystem::ResourceTag tag =
+			MemorySystem::ResourceTag::Other);
 
 	void DestroyImage(
 		VkDevice device,
@@ -57,41 +59,6 @@ namespace ImageHelper
 		VkQueue graphicsQueue,
 		uint32_t layerCount = 1);
 
-	void CopyBufferToImage(
-		BufferHelper::Buffer buffer,
-		Image image,
-		uint32_t width,
-		uint32_t height,
-		CommandPool* commandPool,
-		VkQueue graphicsQueue,
-		uint32_t layerCount = 1);
-
-	void RotateClockWise(
-		uint8_t* image,
-		uint32_t width,
-		uint32_t height);
-
-	void RotateCounterClockWise(
-		uint8_t* image,
-		uint32_t width,
-		uint32_t height);
-
-	void FlipVertically(
-		uint8_t* image,
-		uint32_t width,
-		uint32_t height);
-
-	void FlipHorizontally(
-		uint8_t* image,
-		uint32_t width,
-		uint32_t height);
-
-	void Swap(
-		uint8_t* image1,
-		uint8_t* image2,
-		uint32_t width,
-		uint32_t height);
-
 	VkSampler CreateImageSampler(
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
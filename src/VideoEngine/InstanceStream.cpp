@@ -0,0 +1,213 @@
+#include "InstanceStream.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include "../Utils/Metrics.h"
+
+InstanceStream::InstanceStream(
+	VkDevice device,
+	MemorySystem* memorySystem,
+	PhysicalDeviceSupport* deviceSupport,
+	uint32_t instanceStride,
+	uint32_t framesInFlight)
+{
+	_device = device;
+	_memorySystem = memorySystem;
+	_deviceSupport = deviceSupport;
+	_instanceStride = instanceStride;
+	_framesInFlight = framesInFlight;
+
+	_frame = 0;
+
+	AddChunk(0);
+}
+
+InstanceStream::~InstanceStream()
+{
+	for (auto chunk : _chunks) {
+		for (auto& buffer : chunk->Buffers) {
+			BufferHelper::DestroyBuffer(
+				_device,
+				buffer,
+				_memorySystem);
+		}
+
+		delete chunk;
+	}
+}
+
+InstanceStream::Allocation InstanceStream::Add(uint32_t capacity)
+{
+	capacity = std::max<uint32_t>(capacity, 1);
+
+	if ((uint64_t)capacity * _instanceStride > UINT32_MAX) {
+		throw std::runtime_error("Too many model instances.");
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Allocation allocation;
+	allocation.Capacity = capacity;
+	allocation.Block = TlsfAllocator::NoBlock;
+
+	uint32_t offset;
+
+	for (uint32_t i = 0; i < _chunks.size(); ++i) {
+		allocation.Block = _chunks[i]->Ranges.Allocate(
+			capacity * _instanceStride,
+			offset);
+
+		if (allocation.Block != TlsfAllocator::NoBlock) {
+			allocation.Chunk = i;
+			break;
+		}
+	}
+
+	if (allocation.Block == TlsfAllocator::NoBlock) {
+		allocation.Chunk = _chunks.size();
+		allocation.Block = AddChunk(capacity)->Ranges.Allocate(
+			capacity * _instanceStride,
+			offset);
+	}
+
+	allocation.FirstInstance = offset / _instanceStride;
+	allocation.Dirty.assign(_framesInFlight, Range{0, capacity});
+
+	METRIC_COUNTER_ADD("instances.allocations", 1);
+
+	return allocation;
+}
+
+void InstanceStream::Free(const Allocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_retired.push_back({allocation.Chunk, allocation.Block, _frame});
+
+	METRIC_COUNTER_ADD("instances.allocations", -1);
+}
+
+void InstanceStream::MarkDirty(
+	Allocation& allocation,
+	uint32_t first,
+	uint32_t end)
+{
+	end = std::min(end, allocation.Capacity);
+
+	if (first >= end) {
+		return;
+	}
+
+	for (Range& dirty : allocation.Dirty) {
+		if (dirty.First >= dirty.End) {
+			dirty = Range{first, end};
+		} else {
+			dirty.First = std::min(dirty.First, first);
+			dirty.End = std::max(dirty.End, end);
+		}
+	}
+}
+
+void InstanceStream::Write(
+	Allocation& allocation,
+	uint32_t frame,
+	const void* instances,
+	uint32_t count)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Range& dirty = allocation.Dirty[frame];
+	uint32_t end = std::min(dirty.End, count);
+
+	if (dirty.First < end) {
+		uint8_t* mapped = _chunks[allocation.Chunk]->
+			Buffers[frame].Allocation.Mapped;
+		size_t first = allocation.FirstInstance + dirty.First;
+
+		// Host coherent, nothing to flush.
+		memcpy(
+			mapped + first * _instanceStride,
+			static_cast<const uint8_t*>(instances) +
+				(size_t)dirty.First * _instanceStride,
+			(size_t)(end - dirty.First) * _instanceStride);
+
+		METRIC_COUNTER_ADD(
+			"instances.streamed_bytes",
+			(end - dirty.First) * _instanceStride);
+	}
+
+	dirty = Range{0, 0};
+}
+
+// Frames finish in order, so once the fence of this frame's slot has
+// signaled every frame recorded before the previous one is done.
+void InstanceStream::BeginFrame()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	++_frame;
+
+	while (!_retired.empty() &&
+		_retired.front().Frame + _framesInFlight <= _frame)
+	{
+		Retired& retired = _retired.front();
+
+		_chunks[retired.Chunk]->Ranges.Free(retired.Block);
+		_retired.pop_front();
+	}
+}
+
+void InstanceStream::Bind(
+	VkCommandBuffer commandBuffer,
+	uint32_t frame,
+	uint32_t chunk)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VkDeviceSize offset = 0;
+
+	vkCmdBindVertexBuffers(
+		commandBuffer,
+		1,
+		1,
+		&_chunks[chunk]->Buffers[frame].Buffer,
+		&offset);
+}
+
+// Chunks are at least the default size, larger for an allocation that
+// would not fit one.
+InstanceStream::Chunk* InstanceStream::AddChunk(uint32_t capacity)
+{
+	uint64_t size = (uint64_t)_instanceStride *
+		std::max<uint32_t>(capacity, INSTANCE_STREAM_INSTANCES);
+
+	if (size > UINT32_MAX) {
+		throw std::runtime_error("Too many model instances.");
+	}
+
+	Chunk* chunk = new Chunk{
+		{},
+		TlsfAllocator(size, _instanceStride)
+	};
+
+	for (uint32_t i = 0; i < _framesInFlight; ++i) {
+		chunk->Buffers.push_back(BufferHelper::CreateBuffer(
+			_device,
+			size,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			_memorySystem,
+			_deviceSupport,
+			0,
+			MemorySystem::ResourceTag::Mesh));
+	}
+
+	_chunks.push_back(chunk);
+
+	METRIC_COUNTER_ADD("instances.chunks", 1);
+
+	return chunk;
+}
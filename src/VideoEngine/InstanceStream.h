@@ -0,0 +1,106 @@
+#ifndef _INSTANCE_STREAM_H
+#define _INSTANCE_STREAM_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "BufferHelper.h"
+#include "TlsfAllocator.h"
+
+// Instances per chunk.
+#define INSTANCE_STREAM_INSTANCES (1 << 16)
+
+// Instance data that changes between frames. Every frame in flight has
+// its own host visible copy of the instance buffer, written through the
+// mapping, so a frame never touches data the GPU may still read. Changed
+// ranges are remembered per copy and only they are written when the
+// frame of a copy comes up again.
+class InstanceStream
+{
+public:
+	// Instance indices, End is past the last one.
+	struct Range
+	{
+		uint32_t First;
+		uint32_t End;
+	};
+
+	struct Allocation
+	{
+		uint32_t Chunk;
+		// Ready for vkCmdDrawIndexed.
+		uint32_t FirstInstance;
+		uint32_t Capacity;
+		uint32_t Block;
+
+		// Not yet written to the copy of each frame in flight.
+		std::vector<Range> Dirty;
+	};
+
+	InstanceStream(
+		VkDevice device,
+		MemorySystem* memorySystem,
+		PhysicalDeviceSupport* deviceSupport,
+		uint32_t instanceStride,
+		uint32_t framesInFlight);
+	InstanceStream(const InstanceStream& stream) = delete;
+	~InstanceStream();
+
+	// Every instance starts out dirty in every copy.
+	Allocation Add(uint32_t capacity);
+	// The range is reused once the frames in flight are done with it.
+	void Free(const Allocation& allocation);
+
+	void MarkDirty(Allocation& allocation, uint32_t first, uint32_t end);
+	// Writes what the frame's copy is missing, instances holds count
+	// instances starting with the first of the allocation.
+	void Write(
+		Allocation& allocation,
+		uint32_t frame,
+		const void* instances,
+		uint32_t count);
+
+	// Once per frame, after its fence was waited for.
+	void BeginFrame();
+
+	// Binds the frame's copy of the chunk to binding 1.
+	void Bind(
+		VkCommandBuffer commandBuffer,
+		uint32_t frame,
+		uint32_t chunk);
+
+private:
+	struct Chunk
+	{
+		// One per frame in flight.
+		std::vector<BufferHelper::Buffer> Buffers;
+		TlsfAllocator Ranges;
+	};
+
+	struct Retired
+	{
+		uint32_t Chunk;
+		uint32_t Block;
+		uint64_t Frame;
+	};
+
+	VkDevice _device;
+	MemorySystem* _memorySystem;
+	PhysicalDeviceSupport* _deviceSupport;
+
+	uint32_t _instanceStride;
+	uint32_t _framesInFlight;
+
+	std::vector<Chunk*> _chunks;
+	std::deque<Retired> _retired;
+	uint64_t _frame;
+	std::mutex _mutex;
+
+	Chunk* AddChunk(uint32_t capacity);
+};
+
+#endif
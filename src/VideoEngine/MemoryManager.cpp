@@ -1,157 +1,311 @@
 #include "MemoryManager.h"
 
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
 
 #include "../Logger/logger.h"
+#include "../Utils/Metrics.h"
 
 MemoryManager::MemoryManager(
 	VkDevice device,
 	uint32_t pageSize,
 	uint32_t memoryTypeIndex,
-	uint32_t alignment)
+	uint32_t alignment,
+	bool hostVisible)
 {
 	_device = device;
 	_pageSize = (pageSize / alignment + 1) * alignment;
 	_alignment = alignment;
-	_sectorCount = _pageSize / _alignment;
 	_memoryTypeIndex = memoryTypeIndex;
+	_hostVisible = hostVisible;
 
 	AddPage();
 
-	Logger::Verbose() << "Created memory manager for index " <<
+	LOG_VERBOSE << "Created memory manager for index " <<
 		_memoryTypeIndex << ", alignment " << _alignment;
 
-	Logger::Verbose() << "Page size " << _pageSize;
+	LOG_VERBOSE << "Page size " << _pageSize;
 }
 
 MemoryManager::~MemoryManager()
 {
-	uint32_t leakedSectors = 0;
+	uint32_t leakedBytes = 0;
 
 	for (auto& page : _pages) {
-		vkFreeMemory(_device, page.memory, nullptr);
-
-		for (bool sector : page.data) {
-			if (sector) {
-				++leakedSectors;
-			}
+		if (page.Mapped) {
+			vkUnmapMemory(_device, page.Memory);
 		}
+
+		vkFreeMemory(_device, page.Memory, nullptr);
+
+		METRIC_COUNTER_ADD("memory.pages", -1);
+		METRIC_COUNTER_ADD("memory.page_bytes", -(int64_t)_pageSize);
+
+		leakedBytes +=
+			page.Ranges.GetSize() - page.Ranges.GetFreeSize();
 	}
 
-	Logger::Verbose() <<
+	LOG_VERBOSE <<
 		"Destroyed memory manager for index " << _memoryTypeIndex <<
 		", alignment " << _alignment <<
-		". Leaks: " << leakedSectors;
+		". Leaked bytes: " << leakedBytes;
 }
 
-void MemoryManager::AddPage()
+MemoryManager::PageDescriptor& MemoryManager::AddPage()
 {
 	VkMemoryAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 	allocInfo.allocationSize = _pageSize;
 	allocInfo.memoryTypeIndex = _memoryTypeIndex;
 
-	PageDescriptor page;
-	page.data = std::vector<bool>(_sectorCount, false);
+	VkDeviceMemory memory;
 
 	VkResult res = vkAllocateMemory(
 		_device,
 		&allocInfo,
 		nullptr,
-		&page.memory);
+		&memory);
 
 	if (res != VK_SUCCESS) {
 		throw std::runtime_error("Failed to allocate device memory.");
 	}
 
-	_pages.push_back(page);
+	void* mapped = nullptr;
+
+	if (_hostVisible) {
+		res = vkMapMemory(
+			_device,
+			memory,
+			0,
+			VK_WHOLE_SIZE,
+			0,
+			&mapped);
+
+		if (res != VK_SUCCESS) {
+			vkFreeMemory(_device, memory, nullptr);
+			throw std::runtime_error(
+				"Failed to map device memory.");
+		}
+	}
+
+	_pages.push_back({
+		memory,
+		static_cast<uint8_t*>(mapped),
+		TlsfAllocator(_pageSize, _alignment),
+		false,
+		std::chrono::steady_clock::now()
+	});
+	_pageLookup[memory] = &_pages.back();
+
+	METRIC_COUNTER_ADD("memory.pages", 1);
+	METRIC_COUNTER_ADD("memory.page_bytes", _pageSize);
 
-	Logger::Verbose() <<
+	LOG_VERBOSE <<
 		"New page for memory manager with index " <<
 		_memoryTypeIndex << ", alignment " << _alignment;
+
+	return _pages.back();
 }
 
 MemoryManager::Allocation MemoryManager::Allocate(uint32_t size)
 {
-	_mutex.lock();
+	std::lock_guard<std::mutex> lock(_mutex);
 
 	if (size > _pageSize)
 	{
-		_mutex.unlock();
 		throw std::runtime_error(
 			std::string("Memory allocation size ") +
 			std::to_string(size) + " is greater than page size " +
 			std::to_string(_pageSize));
 	}
 
-	uint32_t requiredSectors = (size - 1) / _alignment + 1;
+	Allocation allocation;
+	allocation.Size = size;
+	allocation.Block = TlsfAllocator::NoBlock;
+
+	PageDescriptor* page = nullptr;
 
-	for (auto& page : _pages) {
-		uint32_t sectorIndex = 0;
-		uint32_t sectorSpan = 0;
-
-		while (sectorIndex < _sectorCount) {
-			if (!page.data[sectorIndex]) {
-				++sectorSpan;
-			} else {
-				sectorSpan = 0;
-			}
-
-			++sectorIndex;
-
-			if (sectorSpan == requiredSectors) {
-				while (sectorSpan > 0) {
-					--sectorSpan;
-					--sectorIndex;
-
-					page.data[sectorIndex] = true;
-				}
-
-				Allocation allocation;
-				allocation.Memory = page.memory;
-				allocation.Offset = _alignment * sectorIndex;
-				allocation.Size = size;
-
-				_mutex.unlock();
-				return allocation;
-			}
+	for (auto& candidate : _pages) {
+		if (candidate.Evacuating) {
+			continue;
+		}
+
+		allocation.Block = candidate.Ranges.Allocate(
+			size,
+			allocation.Offset);
+
+		if (allocation.Block != TlsfAllocator::NoBlock) {
+			page = &candidate;
+			break;
 		}
 	}
 
-	AddPage();
+	if (!page) {
+		page = &AddPage();
 
-	for (uint32_t sector = 0; sector < requiredSectors; ++sector) {
-		_pages.back().data[sector] = true;
+		allocation.Block = page->Ranges.Allocate(
+			size,
+			allocation.Offset);
 	}
 
-	Allocation allocation;
-	allocation.Memory = _pages.back().memory;
-	allocation.Offset = 0;
-	allocation.Size = size;
+	allocation.Memory = page->Memory;
+	allocation.Mapped = page->Mapped ?
+		page->Mapped + allocation.Offset :
+		nullptr;
+
+	METRIC_COUNTER_ADD("memory.allocations", 1);
+	METRIC_COUNTER_ADD("memory.allocated_bytes", size);
 
-	_mutex.unlock();
 	return allocation;
 }
 
 void MemoryManager::Free(Allocation allocation)
 {
-	_mutex.lock();
-	uint32_t sectors = (allocation.Size - 1) / _alignment + 1;
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto page = _pageLookup.find(allocation.Memory);
+
+	if (page == _pageLookup.end()) {
+		throw std::runtime_error("Tried to free invalid memory block.");
+	}
+
+	PageDescriptor* descriptor = page->second;
+	descriptor->Ranges.Free(allocation.Block);
+
+	METRIC_COUNTER_ADD("memory.allocations", -1);
+	METRIC_COUNTER_ADD(
+		"memory.allocated_bytes",
+		-(int64_t)allocation.Size);
+
+	if (descriptor->Ranges.IsEmpty()) {
+		descriptor->EmptySince = std::chrono::steady_clock::now();
+	}
+
+	if (!descriptor->Evacuating ||
+		!descriptor->Ranges.IsEmpty() ||
+		_pages.size() == 1)
+	{
+		return;
+	}
+
+	for (auto it = _pages.begin(); it != _pages.end(); ++it) {
+		if (&*it == descriptor) {
+			ReleasePage(it);
+			break;
+		}
+	}
+}
+
+VkDeviceMemory MemoryManager::FindSparsePage(
+	float maxUsage,
+	const std::set<VkDeviceMemory>& exclude,
+	float& usage)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VkDeviceMemory sparsest = VK_NULL_HANDLE;
+	usage = maxUsage;
+
+	if (_pages.size() < 2) {
+		return sparsest;
+	}
 
 	for (auto& page : _pages) {
-		if (page.memory == allocation.Memory) {
-			uint32_t startSector =
-				allocation.Offset / _alignment;
+		// Empty pages are the spares, only Trim releases them.
+		if (exclude.count(page.Memory) || page.Ranges.IsEmpty()) {
+			continue;
+		}
+
+		float used = 1.0f - (float)page.Ranges.GetFreeSize() /
+			page.Ranges.GetSize();
+
+		if (used <= usage) {
+			sparsest = page.Memory;
+			usage = used;
+		}
+	}
+
+	return sparsest;
+}
+
+bool MemoryManager::SetEvacuating(VkDeviceMemory memory, bool evacuating)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto page = _pageLookup.find(memory);
+
+	if (page == _pageLookup.end()) {
+		return false;
+	}
+
+	page->second->Evacuating = evacuating;
+
+	return true;
+}
+
+uint64_t MemoryManager::Trim(
+	uint32_t sparePages,
+	std::chrono::steady_clock::duration gracePeriod)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::vector<std::list<PageDescriptor>::iterator> empty;
+
+	for (auto it = _pages.begin(); it != _pages.end(); ++it) {
+		if (it->Ranges.IsEmpty()) {
+			empty.push_back(it);
+		}
+	}
+
+	if (empty.size() <= sparePages) {
+		return 0;
+	}
+
+	std::sort(
+		empty.begin(),
+		empty.end(),
+		[](const auto& a, const auto& b) {
+			return a->EmptySince < b->EmptySince;
+		});
 
-			for (uint32_t idx = 0; idx < sectors; ++idx) {
-				page.data[idx + startSector] = false;
-			}
+	auto now = std::chrono::steady_clock::now();
+	uint64_t released = 0;
 
-			_mutex.unlock();
-			return;
+	for (size_t i = 0; i < empty.size() - sparePages; ++i) {
+		if (now - empty[i]->EmptySince < gracePeriod) {
+			break;
 		}
+
+		ReleasePage(empty[i]);
+		released += _pageSize;
 	}
 
-	_mutex.unlock();
-	throw std::runtime_error("Tried to free invalid memory block.");
+	return released;
+}
+
+uint64_t MemoryManager::GetCommittedSize()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	return (uint64_t)_pages.size() * _pageSize;
+}
+
+void MemoryManager::ReleasePage(std::list<PageDescriptor>::iterator page)
+{
+	if (page->Mapped) {
+		vkUnmapMemory(_device, page->Memory);
+	}
+
+	vkFreeMemory(_device, page->Memory, nullptr);
+
+	_pageLookup.erase(page->Memory);
+	_pages.erase(page);
+
+	METRIC_COUNTER_ADD("memory.pages", -1);
+	METRIC_COUNTER_ADD("memory.page_bytes", -(int64_t)_pageSize);
+
+	LOG_VERBOSE <<
+		"Released page of memory manager with index " <<
+		_memoryTypeIndex << ", alignment " << _alignment;
 }
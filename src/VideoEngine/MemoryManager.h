@@ -2,10 +2,14 @@
 #define _MEMORY_MANAGER_H
 
 #include <list>
-#include <vector>
+#include <set>
+#include <unordered_map>
 #include <mutex>
+#include <chrono>
 #include <vulkan/vulkan.h>
 
+#include "TlsfAllocator.h"
+
 class MemoryManager
 {
 public:
@@ -14,35 +18,76 @@ public:
 		VkDeviceMemory Memory;
 		uint32_t Size;
 		uint32_t Offset;
+		// Handle of the range within its page.
+		uint32_t Block;
+		// Null unless the pages are mapped.
+		uint8_t* Mapped;
 	};
 
+	// Pages of host visible memory types stay mapped for their whole
+	// lifetime, allocations come with their CPU address.
 	MemoryManager(
 		VkDevice device,
 		uint32_t pageSize,
 		uint32_t memoryTypeIndex,
-		uint32_t alignment);
+		uint32_t alignment,
+		bool hostVisible = false);
 	~MemoryManager();
 
 	Allocation Allocate(uint32_t size);
 	void Free(Allocation allocation);
 
+	// The emptiest page in use using at most maxUsage of its size,
+	// skipping the pages in exclude. Empty pages are left to Trim.
+	// VK_NULL_HANDLE when there is none or the manager has a single
+	// page.
+	VkDeviceMemory FindSparsePage(
+		float maxUsage,
+		const std::set<VkDeviceMemory>& exclude,
+		float& usage);
+	// Allocations avoid an evacuating page, which goes back to the
+	// driver once its last range is freed. Returns false when memory
+	// is not a page of this manager, which includes released pages.
+	bool SetEvacuating(VkDeviceMemory memory, bool evacuating);
+
+	// Releases the empty pages beyond sparePages which have been empty
+	// for at least gracePeriod, the ones emptied first go first. Returns
+	// the bytes given back to the driver.
+	uint64_t Trim(
+		uint32_t sparePages,
+		std::chrono::steady_clock::duration gracePeriod);
+
+	// Bytes of device memory held in pages.
+	uint64_t GetCommittedSize();
+
+	uint32_t GetMemoryTypeIndex()
+	{
+		return _memoryTypeIndex;
+	}
+
 private:
 	struct PageDescriptor
 	{
-		VkDeviceMemory memory;
-		std::vector<bool> data;
+		VkDeviceMemory Memory;
+		uint8_t* Mapped;
+		TlsfAllocator Ranges;
+		bool Evacuating;
+		// Meaningful while Ranges is empty.
+		std::chrono::steady_clock::time_point EmptySince;
 	};
 
 	VkDevice _device;
 	std::list<PageDescriptor> _pages;
+	std::unordered_map<VkDeviceMemory, PageDescriptor*> _pageLookup;
 	uint32_t _pageSize;
 	uint32_t _alignment;
 	uint32_t _memoryTypeIndex;
-	uint32_t _sectorCount;
+	bool _hostVisible;
 
 	std::mutex _mutex;
 
-	void AddPage();
+	PageDescriptor& AddPage();
+	void ReleasePage(std::list<PageDescriptor>::iterator page);
 };
 
 #endif
@@ -1,86 +1,666 @@
 #include "MemorySystem.h"
 
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+
+#include "VkInstanceHandler.h"
 #include "../Logger/logger.h"
+#include "../Utils/Metrics.h"
 
-// 128 MB for page.
+// 256 MB for page.
+// 4 MB for slab page.
 // 1 MB for domain page.
 #define PAGE_SIZE 1048576 * 64 * 4
+#define SLAB_PAGE_SIZE 1048576 * 4
 #define DOMAIN_PAGE_SIZE 1048576
+// 64 KB and below is small, 32 MB and above dedicated.
+#define SMALL_LIMIT 65536
+#define DEDICATED_LIMIT 1048576 * 32
+
+static const char* SizeClassNames[] = {
+	"small",
+	"pooled",
+	"dedicated"
+};
+
+static const char* TagNames[] = {
+	"other",
+	"texture",
+	"mesh",
+	"shadow",
+	"hdr",
+	"attachment",
+	"staging",
+	"uniform"
+};
+
+static void LogStats(const std::string& name, const MemorySystem::Stats& stats)
+{
+	if (stats.PeakBytes == 0) {
+		return;
+	}
+
+	LOG_VERBOSE << name << ": " << stats.Allocations <<
+		" allocations, " << stats.Bytes << " bytes, peak " <<
+		stats.PeakBytes;
+}
 
-MemorySystem::MemorySystem(VkDevice device)
+MemorySystem::MemorySystem(
+	VkDevice device,
+	VkPhysicalDevice physicalDevice,
+	const Limits* limits,
+	bool memoryBudget)
 {
 	_device = device;
+	_physicalDevice = physicalDevice;
+
+	vkGetPhysicalDeviceMemoryProperties(
+		physicalDevice,
+		&_memoryProperties);
+
+	if (limits) {
+		_limits = *limits;
+	} else {
+		_limits.SmallLimit = SMALL_LIMIT;
+		_limits.SlabPageSize = SLAB_PAGE_SIZE;
+		_limits.DedicatedLimit = DEDICATED_LIMIT;
+		_limits.PageSize = PAGE_SIZE;
+		_limits.DomainPageSize = DOMAIN_PAGE_SIZE;
+	}
+
+	for (Stats& stats : _stats) {
+		stats = Stats{};
+	}
+
+	for (Stats& stats : _typeStats) {
+		stats = Stats{};
+	}
+
+	for (Stats& stats : _tagStats) {
+		stats = Stats{};
+	}
+
+	_evacuating = nullptr;
+	_evacuatingPage = VK_NULL_HANDLE;
+
+	_getMemoryProperties2 = nullptr;
+
+	if (memoryBudget) {
+		_getMemoryProperties2 =
+			(PFN_vkGetPhysicalDeviceMemoryProperties2KHR)
+			vkGetInstanceProcAddr(
+				VkInstanceHandler::GetInstance(),
+				"vkGetPhysicalDeviceMemoryProperties2KHR");
+	}
+
+	LOG_VERBOSE << "Memory budget " <<
+		(_getMemoryProperties2 ? "from driver" : "estimated");
+
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_HEAPS; ++i) {
+		_dedicatedBytes[i] = 0;
+		_heapLimits[i] = 0;
+		_budgets[i] = HeapBudget{};
+	}
+
+	_evictionThreshold = MEMORY_EVICTION_THRESHOLD;
+	_nextCallbackId = 0;
+
+	_sparePages = MEMORY_SPARE_PAGES;
+	_trimGracePeriod =
+		std::chrono::milliseconds(MEMORY_TRIM_GRACE_PERIOD_MS);
+
+	QueryBudget();
 }
 
 MemorySystem::~MemorySystem()
 {
+	LogReport();
+
 	for (auto& manager : _managers) {
 		delete manager.second;
 	}
 
+	for (auto& manager : _slabManagers) {
+		delete manager.second;
+	}
+
 	for (auto& managers : _domains) {
-		Logger::Verbose() << "Destroying domain " << managers.first;
+		LOG_VERBOSE << "Destroying domain " << managers.first;
 
 		for (auto& manager : managers.second) {
 			delete manager.second;
 		}
 	}
+
+	if (_stats[(int)SizeClass::Dedicated].Allocations > 0) {
+		LOG_VERBOSE << "Leaked dedicated allocations: " <<
+			_stats[(int)SizeClass::Dedicated].Allocations;
+	}
 }
 
 MemorySystem::Allocation MemorySystem::Allocate(
 	uint32_t size,
 	AllocationProperties properties,
-	uint32_t domain)
+	uint32_t domain,
+	ResourceTag tag)
 {
-	Domain* managers = &_managers;
+	SizeClass sizeClass = Classify(size, domain);
+	Allocation allocation;
 
-	uint32_t pageSize = PAGE_SIZE;
+	if (sizeClass == SizeClass::Dedicated) {
+		allocation = AllocateDedicated(size, properties);
+	} else {
+		MemoryManager* manager =
+			GetManager(sizeClass, properties, domain);
+		MemoryManager::Allocation alloc = manager->Allocate(size);
 
-	if (domain > 0) {
-		if (_domains.find(domain) == _domains.end()) {
-			_domains[domain] = Domain();
+		allocation.Memory = alloc.Memory;
+		allocation.Size = alloc.Size;
+		allocation.Offset = alloc.Offset;
+		allocation.Block = alloc.Block;
+		allocation.Mapped = alloc.Mapped;
+	}
+
+	allocation.Class = sizeClass;
+	allocation.Properties = properties;
+	allocation.Tag = tag;
+
+	AddStats(allocation, domain, 1, size);
+
+	return allocation;
+}
+
+void MemorySystem::Free(Allocation allocation, uint32_t domain)
+{
+	AddStats(allocation, domain, -1, -(int64_t)allocation.Size);
+
+	if (allocation.Class == SizeClass::Dedicated) {
+		FreeDedicated(allocation);
+		return;
+	}
+
+	MemoryManager::Allocation alloc;
+	alloc.Memory = allocation.Memory;
+	alloc.Size = allocation.Size;
+	alloc.Offset = allocation.Offset;
+	alloc.Block = allocation.Block;
+	alloc.Mapped = allocation.Mapped;
+
+	GetManager(allocation.Class, allocation.Properties, domain)->Free(
+		alloc);
+}
+
+MemorySystem::Stats MemorySystem::GetStats(SizeClass sizeClass)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	return _stats[(int)sizeClass];
+}
+
+MemorySystem::Stats MemorySystem::GetDomainStats(uint32_t domain)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto stats = _domainStats.find(domain);
+
+	return stats != _domainStats.end() ? stats->second : Stats{};
+}
+
+MemorySystem::Stats MemorySystem::GetTypeStats(uint32_t memoryTypeIndex)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	return _typeStats[memoryTypeIndex];
+}
+
+MemorySystem::Stats MemorySystem::GetTagStats(ResourceTag tag)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	return _tagStats[(int)tag];
+}
+
+MemorySystem::HeapBudget MemorySystem::GetHeapBudget(uint32_t heapIndex)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	return _budgets[heapIndex];
+}
+
+void MemorySystem::SetHeapLimit(uint32_t heapIndex, uint64_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_heapLimits[heapIndex] = bytes;
+}
+
+void MemorySystem::SetEvictionThreshold(float threshold)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_evictionThreshold = threshold;
+}
+
+uint32_t MemorySystem::AddEvictionCallback(EvictionCallback callback)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	uint32_t id = _nextCallbackId++;
+	_evictionCallbacks[id] = callback;
+
+	return id;
+}
+
+void MemorySystem::RemoveEvictionCallback(uint32_t id)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_evictionCallbacks.erase(id);
+}
+
+void MemorySystem::SetTrimPolicy(
+	uint32_t sparePages,
+	uint32_t gracePeriodMS)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_sparePages = sparePages;
+	_trimGracePeriod = std::chrono::milliseconds(gracePeriodMS);
+}
+
+uint64_t MemorySystem::Trim()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	uint64_t released = TrimPages(0, std::chrono::milliseconds(0));
+
+	LOG_VERBOSE << "Trimmed " << released << " bytes of device memory";
+
+	return released;
+}
+
+void MemorySystem::Update()
+{
+	std::vector<std::pair<uint32_t, uint64_t>> evictions;
+	std::vector<EvictionCallback> callbacks;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		TrimPages(_sparePages, _trimGracePeriod);
+		QueryBudget();
+
+		if (FindEvictions(evictions) &&
+			TrimPages(0, std::chrono::milliseconds(0)) > 0)
+		{
+			evictions.clear();
+			QueryBudget();
+			FindEvictions(evictions);
+		}
+
+		if (!evictions.empty()) {
+			for (auto& callback : _evictionCallbacks) {
+				callbacks.push_back(callback.second);
+			}
 		}
+	}
+
+	// Callbacks may free memory, which takes the mutex again.
+	for (auto& eviction : evictions) {
+		METRIC_COUNTER_ADD("memory.eviction_requests", 1);
+
+		for (auto& callback : callbacks) {
+			callback(eviction.first, eviction.second);
+		}
+	}
+}
+
+void MemorySystem::LogReport()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	QueryBudget();
+
+	for (uint32_t i = 0; i < 3; ++i) {
+		LogStats(
+			std::string("Class ") + SizeClassNames[i],
+			_stats[i]);
+	}
+
+	for (auto& stats : _domainStats) {
+		LogStats(
+			"Domain " + std::to_string(stats.first),
+			stats.second);
+	}
+
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; ++i) {
+		LogStats("Type " + std::to_string(i), _typeStats[i]);
+	}
 
+	for (uint32_t i = 0; i < (uint32_t)ResourceTag::Count; ++i) {
+		LogStats(std::string("Tag ") + TagNames[i], _tagStats[i]);
+	}
+
+	for (uint32_t i = 0; i < GetHeapCount(); ++i) {
+		LOG_VERBOSE << "Heap " << i << ": committed " <<
+			_budgets[i].Committed << ", usage " <<
+			_budgets[i].Usage << " of budget " <<
+			_budgets[i].Budget << ", peak usage " <<
+			_budgets[i].PeakUsage;
+	}
+}
+
+VkDeviceMemory MemorySystem::BeginEvacuation(
+	float maxUsage,
+	const std::set<VkDeviceMemory>& exclude)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_evacuating) {
+		return VK_NULL_HANDLE;
+	}
+
+	float usage = maxUsage;
+
+	for (Domain* managers : {&_managers, &_slabManagers}) {
+		for (auto& manager : *managers) {
+			float pageUsage;
+			VkDeviceMemory page = manager.second->FindSparsePage(
+				usage,
+				exclude,
+				pageUsage);
+
+			if (page != VK_NULL_HANDLE) {
+				_evacuating = manager.second;
+				_evacuatingPage = page;
+				usage = pageUsage;
+			}
+		}
+	}
+
+	if (_evacuating) {
+		_evacuating->SetEvacuating(_evacuatingPage, true);
+	}
+
+	return _evacuatingPage;
+}
+
+bool MemorySystem::EndEvacuation()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (!_evacuating) {
+		return false;
+	}
+
+	bool released = !_evacuating->SetEvacuating(_evacuatingPage, false);
+
+	_evacuating = nullptr;
+	_evacuatingPage = VK_NULL_HANDLE;
+
+	return released;
+}
+
+MemorySystem::SizeClass MemorySystem::Classify(
+	uint32_t size,
+	uint32_t domain)
+{
+	uint32_t pageSize = domain > 0 ?
+		_limits.DomainPageSize :
+		_limits.PageSize;
+
+	if (size >= _limits.DedicatedLimit || size > pageSize) {
+		return SizeClass::Dedicated;
+	}
+
+	if (size <= _limits.SmallLimit) {
+		return SizeClass::Small;
+	}
+
+	return SizeClass::Pooled;
+}
+
+uint32_t MemorySystem::GetHeapIndex(uint32_t memoryTypeIndex)
+{
+	return _memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+}
+
+bool MemorySystem::IsHostVisible(uint32_t memoryTypeIndex)
+{
+	return _memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags &
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+MemoryManager* MemorySystem::GetManager(
+	SizeClass sizeClass,
+	AllocationProperties properties,
+	uint32_t domain)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Domain* managers = &_managers;
+	uint32_t pageSize = _limits.PageSize;
+
+	if (domain > 0) {
 		managers = &_domains[domain];
-		pageSize = DOMAIN_PAGE_SIZE;
+		pageSize = _limits.DomainPageSize;
+	} else if (sizeClass == SizeClass::Small) {
+		managers = &_slabManagers;
+		pageSize = _limits.SlabPageSize;
 	}
 
-	if (managers->find(properties) == managers->end()) {
-		Logger::Verbose() <<
+	MemoryManager*& manager = (*managers)[properties];
+
+	if (!manager) {
+		LOG_VERBOSE <<
 			"Requested alignment " << properties.Alignment;
 
-		(*managers)[properties] = new MemoryManager(
+		manager = new MemoryManager(
 			_device,
 			pageSize,
 			properties.MemoryTypeIndex,
-			properties.Alignment);
+			properties.Alignment,
+			IsHostVisible(properties.MemoryTypeIndex));
 	}
 
+	return manager;
+}
+
+MemorySystem::Allocation MemorySystem::AllocateDedicated(
+	uint32_t size,
+	AllocationProperties properties)
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = properties.MemoryTypeIndex;
+
 	Allocation allocation;
 
-	MemoryManager::Allocation alloc =
-		(*managers)[properties]->Allocate(size);
+	VkResult res = vkAllocateMemory(
+		_device,
+		&allocInfo,
+		nullptr,
+		&allocation.Memory);
 
-	allocation.Memory = alloc.Memory;
-	allocation.Size = alloc.Size;
-	allocation.Offset = alloc.Offset;
-	allocation.Properties = properties;
+	if (res != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate device memory.");
+	}
+
+	allocation.Size = size;
+	allocation.Offset = 0;
+	allocation.Block = TlsfAllocator::NoBlock;
+	allocation.Mapped = nullptr;
+
+	if (IsHostVisible(properties.MemoryTypeIndex)) {
+		void* mapped;
+
+		res = vkMapMemory(
+			_device,
+			allocation.Memory,
+			0,
+			VK_WHOLE_SIZE,
+			0,
+			&mapped);
+
+		if (res != VK_SUCCESS) {
+			vkFreeMemory(_device, allocation.Memory, nullptr);
+			throw std::runtime_error(
+				"Failed to map device memory.");
+		}
+
+		allocation.Mapped = static_cast<uint8_t*>(mapped);
+	}
+
+	METRIC_COUNTER_ADD("memory.dedicated_allocations", 1);
+	METRIC_COUNTER_ADD("memory.dedicated_bytes", size);
 
 	return allocation;
 }
 
-void MemorySystem::Free(Allocation allocation, uint32_t domain)
+void MemorySystem::FreeDedicated(Allocation allocation)
 {
-	Domain* managers = &_managers;
+	if (allocation.Mapped) {
+		vkUnmapMemory(_device, allocation.Memory);
+	}
 
-	if (domain > 0) {
-		managers = &_domains[domain];
+	vkFreeMemory(_device, allocation.Memory, nullptr);
+
+	METRIC_COUNTER_ADD("memory.dedicated_allocations", -1);
+	METRIC_COUNTER_ADD(
+		"memory.dedicated_bytes",
+		-(int64_t)allocation.Size);
+}
+
+void MemorySystem::AddStats(
+	const Allocation& allocation,
+	uint32_t domain,
+	int64_t allocations,
+	int64_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	uint32_t type = allocation.Properties.MemoryTypeIndex;
+
+	Stats* accounts[] = {
+		&_stats[(int)allocation.Class],
+		&_domainStats[domain],
+		&_typeStats[type],
+		&_tagStats[(int)allocation.Tag]
+	};
+
+	for (Stats* stats : accounts) {
+		stats->Allocations += allocations;
+		stats->Bytes += bytes;
+		stats->PeakBytes = std::max(stats->PeakBytes, stats->Bytes);
 	}
 
-	MemoryManager::Allocation alloc;
-	alloc.Memory = allocation.Memory;
-	alloc.Size = allocation.Size;
-	alloc.Offset = allocation.Offset;
+	if (allocation.Class == SizeClass::Dedicated) {
+		_dedicatedBytes[GetHeapIndex(type)] += bytes;
+	}
+}
+
+// With the mutex held. Committed sizes come from the managers, usage
+// and budget from the driver when it reports them.
+void MemorySystem::QueryBudget()
+{
+	uint64_t committed[VK_MAX_MEMORY_HEAPS];
+
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_HEAPS; ++i) {
+		committed[i] = _dedicatedBytes[i];
+	}
+
+	for (Domain* managers : GetAllDomains()) {
+		for (auto& manager : *managers) {
+			uint32_t type = manager.second->GetMemoryTypeIndex();
+
+			committed[GetHeapIndex(type)] +=
+				manager.second->GetCommittedSize();
+		}
+	}
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+	budget.sType =
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	if (_getMemoryProperties2) {
+		VkPhysicalDeviceMemoryProperties2KHR properties{};
+		properties.sType =
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		properties.pNext = &budget;
+
+		_getMemoryProperties2(_physicalDevice, &properties);
+	}
+
+	for (uint32_t i = 0; i < GetHeapCount(); ++i) {
+		HeapBudget& heap = _budgets[i];
+
+		heap.Size = _memoryProperties.memoryHeaps[i].size;
+		heap.Committed = committed[i];
+
+		if (_getMemoryProperties2) {
+			heap.Usage = budget.heapUsage[i];
+			heap.Budget = budget.heapBudget[i];
+		} else {
+			heap.Usage = committed[i];
+			heap.Budget =
+				(uint64_t)(heap.Size * MEMORY_HEAP_BUDGET);
+		}
+
+		if (_heapLimits[i] > 0) {
+			heap.Budget = std::min(heap.Budget, _heapLimits[i]);
+		}
+
+		heap.PeakUsage = std::max(heap.PeakUsage, heap.Usage);
+	}
+}
+
+// With the mutex held.
+bool MemorySystem::FindEvictions(
+	std::vector<std::pair<uint32_t, uint64_t>>& evictions)
+{
+	for (uint32_t i = 0; i < GetHeapCount(); ++i) {
+		uint64_t threshold = (uint64_t)(_evictionThreshold *
+			(double)_budgets[i].Budget);
+
+		if (_budgets[i].Usage > threshold) {
+			evictions.push_back({i, _budgets[i].Usage - threshold});
+		}
+	}
+
+	return !evictions.empty();
+}
+
+// With the mutex held. Spare pages are kept per manager.
+uint64_t MemorySystem::TrimPages(
+	uint32_t sparePages,
+	std::chrono::milliseconds gracePeriod)
+{
+	uint64_t released = 0;
+
+	for (Domain* managers : GetAllDomains()) {
+		for (auto& manager : *managers) {
+			released += manager.second->Trim(
+				sparePages,
+				gracePeriod);
+		}
+	}
+
+	if (released > 0) {
+		METRIC_COUNTER_ADD("memory.trimmed_bytes", released);
+	}
+
+	return released;
+}
+
+std::vector<MemorySystem::Domain*> MemorySystem::GetAllDomains()
+{
+	std::vector<Domain*> domains = {&_managers, &_slabManagers};
+
+	for (auto& domain : _domains) {
+		domains.push_back(&domain.second);
+	}
 
-	(*managers)[allocation.Properties]->Free(alloc);
+	return domains;
 }
@@ -2,13 +2,94 @@
 #define _MEMORY_SYSTEM_H
 
 #include <map>
+#include <set>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <functional>
 
 #include "MemoryManager.h"
 #include "PhysicalDeviceSupport.h"
 
+// Budget of a heap without VK_EXT_memory_budget, a fraction of its size.
+#define MEMORY_HEAP_BUDGET 0.8
+#define MEMORY_EVICTION_THRESHOLD 0.9f
+// Empty pages kept per manager, the others are released once they have
+// been empty for the grace period.
+#define MEMORY_SPARE_PAGES 1
+#define MEMORY_TRIM_GRACE_PERIOD_MS 10000
+
+// Routes allocations by size. Small ones are packed into slab pages of
+// their own so they do not scatter over the big pages, mid-size ones
+// share the pooled pages and anything larger than DedicatedLimit or
+// than a page gets its own device memory.
+//
+// Every allocation is accounted to its size class, domain, memory type
+// and resource tag, and device memory held is tracked per heap against
+// a budget, the driver's one with VK_EXT_memory_budget. Pages left
+// empty go back to the driver after a grace period, all of them on Trim.
 class MemorySystem
 {
 public:
+	enum class SizeClass : uint32_t
+	{
+		Small = 0,
+		Pooled = 1,
+		Dedicated = 2
+	};
+
+	// What the memory is used for, only for accounting.
+	enum class ResourceTag : uint32_t
+	{
+		Other = 0,
+		Texture = 1,
+		Mesh = 2,
+		Shadow = 3,
+		Hdr = 4,
+		Attachment = 5,
+		Staging = 6,
+		Uniform = 7,
+		Count = 8
+	};
+
+	// Byte sizes.
+	struct Limits
+	{
+		uint32_t SmallLimit;
+		uint32_t SlabPageSize;
+		uint32_t DedicatedLimit;
+		uint32_t PageSize;
+		// Domains pool small and mid-size allocations alike.
+		uint32_t DomainPageSize;
+	};
+
+	struct Stats
+	{
+		uint64_t Allocations;
+		uint64_t Bytes;
+		uint64_t PeakBytes;
+	};
+
+	struct HeapBudget
+	{
+		uint64_t Size;
+		// Device memory held by this system, pages and dedicated.
+		uint64_t Committed;
+		// Of the whole process as the driver sees it, Committed
+		// without VK_EXT_memory_budget.
+		uint64_t Usage;
+		// The driver's budget, or MEMORY_HEAP_BUDGET of the heap
+		// size, lowered by SetHeapLimit.
+		uint64_t Budget;
+		uint64_t PeakUsage;
+	};
+
+	// Asks to free about bytes of the heap, called on the thread
+	// running Update without locks held.
+	typedef std::function<void(
+		uint32_t heapIndex,
+		uint64_t bytes)> EvictionCallback;
+
 	struct AllocationProperties
 	{
 		uint32_t Alignment;
@@ -29,25 +110,143 @@ public:
 		VkDeviceMemory Memory;
 		uint32_t Size;
 		uint32_t Offset;
+		uint32_t Block;
+		SizeClass Class;
 		AllocationProperties Properties;
-
+		ResourceTag Tag;
+		// CPU address for host visible memory types, null otherwise.
+		// Mapped once per page, writes need no map or unmap. The
+		// engine only asks for host coherent memory, so no flushes.
+		uint8_t* Mapped;
 	};
 
-	MemorySystem(VkDevice device);
+	// Default limits when limits is null. memoryBudget tells that
+	// VK_EXT_memory_budget and VK_KHR_get_physical_device_properties2
+	// are enabled.
+	MemorySystem(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		const Limits* limits = nullptr,
+		bool memoryBudget = false);
+	// Logs the report.
 	~MemorySystem();
 
 	Allocation Allocate(
 		uint32_t size,
 		AllocationProperties properties,
-		uint32_t domain = 0);
+		uint32_t domain = 0,
+		ResourceTag tag = ResourceTag::Other);
 	void Free(Allocation allocation, uint32_t domain = 0);
 
+	Stats GetStats(SizeClass sizeClass);
+	Stats GetDomainStats(uint32_t domain);
+	Stats GetTypeStats(uint32_t memoryTypeIndex);
+	Stats GetTagStats(ResourceTag tag);
+
+	uint32_t GetHeapCount()
+	{
+		return _memoryProperties.memoryHeapCount;
+	}
+
+	// As of the last Update.
+	HeapBudget GetHeapBudget(uint32_t heapIndex);
+
+	// Caps the budget of a heap, 0 removes the cap.
+	void SetHeapLimit(uint32_t heapIndex, uint64_t bytes);
+	// Fraction of the budget above which eviction callbacks run.
+	void SetEvictionThreshold(float threshold);
+
+	uint32_t AddEvictionCallback(EvictionCallback callback);
+	void RemoveEvictionCallback(uint32_t id);
+
+	void SetTrimPolicy(uint32_t sparePages, uint32_t gracePeriodMS);
+	// Releases every empty page now, for instance after a level was
+	// unloaded. Returns the bytes given back to the driver.
+	uint64_t Trim();
+
+	// Releases pages per the trim policy, refreshes the heap budgets
+	// and runs the eviction callbacks for every heap over the
+	// threshold, after dropping all empty pages did not help. Once per
+	// frame on the render thread.
+	void Update();
+
+	// Logs every non-empty class, domain, type, tag and heap with
+	// their high-water marks.
+	void LogReport();
+
+	// Picks the emptiest small or pooled page of domain 0 using at
+	// most maxUsage of its size and starts evacuating it: allocations
+	// avoid the page and it is released once its last range is freed.
+	// One page at a time, VK_NULL_HANDLE when none qualifies.
+	VkDeviceMemory BeginEvacuation(
+		float maxUsage,
+		const std::set<VkDeviceMemory>& exclude);
+	// Returns true when the page has been released.
+	bool EndEvacuation();
+
+	const Limits& GetLimits()
+	{
+		return _limits;
+	}
+
 private:
 	typedef std::map<AllocationProperties, MemoryManager*> Domain;
 	VkDevice _device;
+	VkPhysicalDeviceMemoryProperties _memoryProperties;
+	Limits _limits;
 
 	std::map<uint32_t, Domain> _domains;
 	Domain _managers;
+	Domain _slabManagers;
+	std::mutex _mutex;
+
+	Stats _stats[3];
+	std::map<uint32_t, Stats> _domainStats;
+	Stats _typeStats[VK_MAX_MEMORY_TYPES];
+	Stats _tagStats[(int)ResourceTag::Count];
+
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR
+		_getMemoryProperties2;
+	VkPhysicalDevice _physicalDevice;
+	uint64_t _dedicatedBytes[VK_MAX_MEMORY_HEAPS];
+	uint64_t _heapLimits[VK_MAX_MEMORY_HEAPS];
+	HeapBudget _budgets[VK_MAX_MEMORY_HEAPS];
+	float _evictionThreshold;
+
+	std::map<uint32_t, EvictionCallback> _evictionCallbacks;
+	uint32_t _nextCallbackId;
+
+	uint32_t _sparePages;
+	std::chrono::milliseconds _trimGracePeriod;
+
+	MemoryManager* _evacuating;
+	VkDeviceMemory _evacuatingPage;
+
+	SizeClass Classify(uint32_t size, uint32_t domain);
+	bool IsHostVisible(uint32_t memoryTypeIndex);
+	uint32_t GetHeapIndex(uint32_t memoryTypeIndex);
+	MemoryManager* GetManager(
+		SizeClass sizeClass,
+		AllocationProperties properties,
+		uint32_t domain);
+
+	Allocation AllocateDedicated(
+		uint32_t size,
+		AllocationProperties properties);
+	void FreeDedicated(Allocation allocation);
+
+	void AddStats(
+		const Allocation& allocation,
+		uint32_t domain,
+		int64_t allocations,
+		int64_t bytes);
+	void QueryBudget();
+	bool FindEvictions(
+		std::vector<std::pair<uint32_t, uint64_t>>& evictions);
+	uint64_t TrimPages(
+		uint32_t sparePages,
+		std::chrono::milliseconds gracePeriod);
+	std::vector<Domain*> GetAllDomains();
 };
 
 #endif
@@ -13,6 +13,8 @@
 #include "MemorySystem.h"
 #include "BufferHelper.h"
 #include "ImageHelper.h"
+#include "GeometryArena.h"
+#include "InstanceStream.h"
 
 struct ModelDescriptor
 {
@@ -24,13 +26,18 @@ struct ModelDescriptor
 	};
 
 	uint32_t VertexCount;
-	BufferHelper::Buffer VertexBuffer;
-
 	uint32_t IndexCount;
-	BufferHelper::Buffer IndexBuffer;
-
 	uint32_t InstanceCount;
-	BufferHelper::Buffer InstanceBuffer;
+
+	// Ranges of the vertices, indices and instances in the scene's
+	// geometry arena.
+	GeometryArena::Allocation Geometry;
+
+	// Set once the instances changed after registration, they are
+	// then drawn from the scene's instance stream. The range in the
+	// geometry arena stays until the model is removed.
+	bool DynamicInstances;
+	InstanceStream::Allocation Instances;
 
 	std::vector<uint32_t> Textures;
 
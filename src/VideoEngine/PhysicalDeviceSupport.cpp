@@ -91,6 +91,17 @@ PhysicalDeviceSupport::FindQueueFamilies()
 			indices.presentFamily = i;
 		}
 
+		VkQueueFlags flags = queueFamily.queueFlags;
+
+		// Families without compute are the pure copy engines.
+		if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+			!(flags & VK_QUEUE_GRAPHICS_BIT) &&
+			(!indices.transferFamily ||
+				!(flags & VK_QUEUE_COMPUTE_BIT)))
+		{
+			indices.transferFamily = i;
+		}
+
 		++i;
 	}
 
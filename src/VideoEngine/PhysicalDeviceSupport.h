@@ -13,6 +13,8 @@ public:
 	{
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		// A family that copies but cannot draw, a DMA engine.
+		std::optional<uint32_t> transferFamily;
 	};
 
 	struct SwapchainSupportDetails
@@ -3,6 +3,7 @@
 
 #include <set>
 #include <mutex>
+#include <functional>
 
 #include "model.h"
 #include "ModelDescriptor.h"
@@ -10,6 +11,7 @@
 #include "skybox.h"
 #include "light.h"
 #include "TextureHandler.h"
+#include "Defragmenter.h"
 
 struct SceneDescriptor
 {
@@ -19,6 +21,10 @@ struct SceneDescriptor
 	Skybox skybox;
 
 	TextureHandler* Textures;
+	GeometryArena* Geometry;
+	InstanceStream* DynamicInstances;
+	// Updated on the render thread after every frame.
+	Defragmenter* MemoryDefragmenter;
 
 	double FOV;
 	glm::vec3 CameraPosition;
@@ -26,6 +32,9 @@ struct SceneDescriptor
 	glm::vec3 CameraUp;
 
 	std::mutex* SceneMutex;
+
+	// Runs on the render thread between frames.
+	std::function<void()> FrameCallback;
 };
 
 #endif
@@ -0,0 +1,617 @@
+#include "StagingRing.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "../Utils/Metrics.h"
+
+// Covers the texel block sizes of every texture format used.
+#define STAGING_RANGE_ALIGNMENT 16
+
+StagingRing::StagingRing(
+	VkDevice device,
+	MemorySystem* memorySystem,
+	PhysicalDeviceSupport* deviceSupport,
+	CommandPool* commandPool,
+	VkQueue queue,
+	CommandPool* transferCommandPool,
+	VkQueue transferQueue,
+	uint32_t size)
+{
+	_device = device;
+	_memorySystem = memorySystem;
+	_deviceSupport = deviceSupport;
+	_commandPool = commandPool;
+	_queue = queue;
+
+	PhysicalDeviceSupport::QueueFamilyIndices indices =
+		_deviceSupport->FindQueueFamilies();
+
+	_separateTransfer = transferCommandPool &&
+		transferQueue != VK_NULL_HANDLE &&
+		indices.transferFamily.has_value();
+
+	_graphicsFamily = indices.graphicsFamily.value();
+
+	if (_separateTransfer) {
+		_transferCommandPool = transferCommandPool;
+		_transferQueue = transferQueue;
+		_transferFamily = indices.transferFamily.value();
+	} else {
+		_transferCommandPool = _commandPool;
+		_transferQueue = _queue;
+		_transferFamily = _graphicsFamily;
+	}
+
+	_size = size / STAGING_RANGE_ALIGNMENT * STAGING_RANGE_ALIGNMENT;
+
+	if (_size == 0) {
+		throw std::runtime_error("Staging ring size is too small.");
+	}
+
+	_buffer = BufferHelper::CreateBuffer(
+		_device,
+		_size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		_memorySystem,
+		_deviceSupport,
+		0,
+		MemorySystem::ResourceTag::Staging);
+
+	_head = 0;
+	_tail = 0;
+
+	_submitted = 0;
+	_completed = 0;
+
+	_recording.CommandBuffer = VK_NULL_HANDLE;
+	_recording.GraphicsCommandBuffer = VK_NULL_HANDLE;
+}
+
+StagingRing::~StagingRing()
+{
+	Finish();
+
+	for (auto fence : _unusedFences) {
+		vkDestroyFence(_device, fence, nullptr);
+	}
+
+	for (auto semaphore : _unusedSemaphores) {
+		vkDestroySemaphore(_device, semaphore, nullptr);
+	}
+
+	BufferHelper::DestroyBuffer(_device, _buffer, _memorySystem);
+}
+
+void StagingRing::CopyToBuffer(
+	BufferHelper::Buffer buffer,
+	const void* data,
+	size_t size,
+	VkDeviceSize offset)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VkBufferCopy region{};
+	region.dstOffset = offset;
+	region.size = size;
+
+	VkBuffer source = Stage(data, size, region.srcOffset);
+
+	vkCmdCopyBuffer(
+		GetGraphicsCommandBuffer(),
+		source,
+		buffer.Buffer,
+		1,
+		&region);
+}
+
+void StagingRing::CopyToImage(
+	ImageHelper::Image image,
+	const void* data,
+	size_t size,
+	const std::vector<VkBufferImageCopy>& regions,
+	uint32_t mipLevels,
+	uint32_t layerCount,
+	VkImageLayout finalLayout)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VkDeviceSize offset;
+	VkBuffer source = Stage(data, size, offset);
+
+	std::vector<VkBufferImageCopy> stagedRegions = regions;
+
+	for (auto& region : stagedRegions) {
+		region.bufferOffset += offset;
+	}
+
+	VkCommandBuffer commandBuffer = GetCommandBuffer();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image.Image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = layerCount;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&barrier);
+
+	vkCmdCopyBufferToImage(
+		commandBuffer,
+		source,
+		image.Image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(stagedRegions.size()),
+		stagedRegions.data());
+
+	if (finalLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
+		!_separateTransfer)
+	{
+		return;
+	}
+
+	// With a separate transfer queue this is the release half of the
+	// ownership transfer, the layout changes as part of it.
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = finalLayout;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	if (_separateTransfer) {
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = _transferFamily;
+		barrier.dstQueueFamilyIndex = _graphicsFamily;
+	} else {
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	}
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		_separateTransfer ?
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT :
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&barrier);
+
+	if (_separateTransfer) {
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT |
+			VK_ACCESS_TRANSFER_WRITE_BIT;
+		_recording.ImageAcquires.push_back(barrier);
+	}
+}
+
+void StagingRing::RecordGraphics(
+	std::function<void(VkCommandBuffer)> record)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VkCommandBuffer commandBuffer = GetGraphicsCommandBuffer();
+
+	AddImageAcquires(commandBuffer);
+	record(commandBuffer);
+}
+
+uint64_t StagingRing::Submit()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	SubmitRecording();
+	Reclaim(false);
+
+	return _submitted;
+}
+
+bool StagingRing::IsComplete(uint64_t ticket)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Reclaim(false);
+
+	return _completed >= ticket;
+}
+
+void StagingRing::Wait(uint64_t ticket)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (ticket > _submitted) {
+		SubmitRecording();
+	}
+
+	while (_completed < ticket && !_inFlight.empty()) {
+		Reclaim(true);
+	}
+}
+
+void StagingRing::Finish()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	SubmitRecording();
+
+	while (!_inFlight.empty()) {
+		Reclaim(true);
+	}
+}
+
+VkCommandBuffer StagingRing::GetCommandBuffer()
+{
+	if (_recording.CommandBuffer == VK_NULL_HANDLE) {
+		_recording.CommandBuffer =
+			BeginCommandBuffer(_transferCommandPool);
+	}
+
+	return _recording.CommandBuffer;
+}
+
+VkCommandBuffer StagingRing::GetGraphicsCommandBuffer()
+{
+	if (!_separateTransfer) {
+		return GetCommandBuffer();
+	}
+
+	if (_recording.GraphicsCommandBuffer == VK_NULL_HANDLE) {
+		_recording.GraphicsCommandBuffer =
+			BeginCommandBuffer(_commandPool);
+	}
+
+	return _recording.GraphicsCommandBuffer;
+}
+
+VkCommandBuffer StagingRing::BeginCommandBuffer(CommandPool* commandPool)
+{
+	VkCommandBuffer commandBuffer = commandPool->CreateCommandBuffer();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	return commandBuffer;
+}
+
+bool StagingRing::IsRecording()
+{
+	return _recording.CommandBuffer != VK_NULL_HANDLE ||
+		_recording.GraphicsCommandBuffer != VK_NULL_HANDLE;
+}
+
+VkBuffer StagingRing::Stage(
+	const void* data,
+	size_t size,
+	VkDeviceSize& offset)
+{
+	METRIC_COUNTER_ADD("staging.bytes", size);
+
+	if (size > _size) {
+		BufferHelper::Buffer buffer = BufferHelper::CreateBuffer(
+			_device,
+			size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			_memorySystem,
+			_deviceSupport,
+			0,
+			MemorySystem::ResourceTag::Staging);
+
+		memcpy(buffer.Allocation.Mapped, data, size);
+
+		_recording.Dedicated.push_back(buffer);
+
+		offset = 0;
+		return buffer.Buffer;
+	}
+
+	offset = Reserve(size);
+	memcpy(_buffer.Allocation.Mapped + offset, data, size);
+
+	return _buffer.Buffer;
+}
+
+uint64_t StagingRing::Reserve(uint32_t size)
+{
+	while (true) {
+		uint64_t start = (_head + STAGING_RANGE_ALIGNMENT - 1) /
+			STAGING_RANGE_ALIGNMENT * STAGING_RANGE_ALIGNMENT;
+
+		// Ranges never wrap, the rest of the ring is skipped.
+		if (start % _size + size > _size) {
+			start = (start / _size + 1) * _size;
+		}
+
+		if (start + size - _tail <= _size) {
+			_head = start + size;
+			return start % _size;
+		}
+
+		if (_inFlight.empty() && !IsRecording()) {
+			// Nothing uses the ring, start over at its beginning.
+			_head = 0;
+			_tail = 0;
+			continue;
+		}
+
+		if (_inFlight.empty()) {
+			SubmitRecording();
+		}
+
+		METRIC_COUNTER_ADD("staging.stalls", 1);
+
+		Reclaim(true);
+	}
+}
+
+void StagingRing::SubmitRecording()
+{
+	if (!IsRecording()) {
+		return;
+	}
+
+	_recording.Semaphore = VK_NULL_HANDLE;
+
+	if (_separateTransfer) {
+		if (_recording.CommandBuffer != VK_NULL_HANDLE) {
+			SubmitTransfer();
+		}
+
+		SubmitGraphics();
+	} else {
+		AddVisibilityBarrier(_recording.CommandBuffer);
+		vkEndCommandBuffer(_recording.CommandBuffer);
+
+		_recording.Fence = GetFence();
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &_recording.CommandBuffer;
+
+		VkResult res = vkQueueSubmit(
+			_queue,
+			1,
+			&submitInfo,
+			_recording.Fence);
+
+		if (res != VK_SUCCESS) {
+			throw std::runtime_error(
+				"Failed to submit staging copies.");
+		}
+	}
+
+	METRIC_COUNTER_ADD("staging.batches", 1);
+
+	_recording.Ticket = ++_submitted;
+	_recording.End = _head;
+	_inFlight.push_back(std::move(_recording));
+
+	_recording = Batch();
+	_recording.CommandBuffer = VK_NULL_HANDLE;
+	_recording.GraphicsCommandBuffer = VK_NULL_HANDLE;
+}
+
+// Image copies of the batch, signals its semaphore.
+void StagingRing::SubmitTransfer()
+{
+	vkEndCommandBuffer(_recording.CommandBuffer);
+
+	if (_unusedSemaphores.empty()) {
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		VkResult res = vkCreateSemaphore(
+			_device,
+			&semaphoreInfo,
+			nullptr,
+			&_recording.Semaphore);
+
+		if (res != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create semaphore.");
+		}
+	} else {
+		_recording.Semaphore = _unusedSemaphores.back();
+		_unusedSemaphores.pop_back();
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &_recording.CommandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &_recording.Semaphore;
+
+	VkResult res = vkQueueSubmit(
+		_transferQueue,
+		1,
+		&submitInfo,
+		VK_NULL_HANDLE);
+
+	if (res != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit staging copies.");
+	}
+}
+
+// Buffer copies of the batch and the acquires of its images. Waiting on
+// the semaphore holds the buffer copies back too, the batch is retired
+// as a whole anyway. The barriers chain the wait to every later
+// graphics submission.
+void StagingRing::SubmitGraphics()
+{
+	VkCommandBuffer commandBuffer = GetGraphicsCommandBuffer();
+
+	AddImageAcquires(commandBuffer);
+	AddVisibilityBarrier(commandBuffer);
+	vkEndCommandBuffer(commandBuffer);
+
+	_recording.Fence = GetFence();
+
+	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	if (_recording.Semaphore != VK_NULL_HANDLE) {
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &_recording.Semaphore;
+		submitInfo.pWaitDstStageMask = &waitStage;
+	}
+
+	VkResult res = vkQueueSubmit(
+		_queue,
+		1,
+		&submitInfo,
+		_recording.Fence);
+
+	if (res != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit staging copies.");
+	}
+}
+
+// Acquire half of the ownership transfers of the images copied since the
+// last call, empty without a separate transfer queue.
+void StagingRing::AddImageAcquires(VkCommandBuffer commandBuffer)
+{
+	if (_recording.ImageAcquires.empty()) {
+		return;
+	}
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast<uint32_t>(_recording.ImageAcquires.size()),
+		_recording.ImageAcquires.data());
+
+	_recording.ImageAcquires.clear();
+}
+
+// Makes the copies recorded so far visible to everything after them on
+// the graphics queue.
+void StagingRing::AddVisibilityBarrier(VkCommandBuffer commandBuffer)
+{
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask =
+		VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		0,
+		1,
+		&barrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+}
+
+void StagingRing::Reclaim(bool wait)
+{
+	if (wait && !_inFlight.empty()) {
+		vkWaitForFences(
+			_device,
+			1,
+			&_inFlight.front().Fence,
+			VK_TRUE,
+			UINT64_MAX);
+	}
+
+	while (!_inFlight.empty()) {
+		Batch& batch = _inFlight.front();
+
+		if (vkGetFenceStatus(_device, batch.Fence) != VK_SUCCESS) {
+			break;
+		}
+
+		Retire(batch);
+		_inFlight.pop_front();
+	}
+}
+
+void StagingRing::Retire(Batch& batch)
+{
+	if (batch.CommandBuffer != VK_NULL_HANDLE) {
+		_transferCommandPool->DestroyCommandBuffer(batch.CommandBuffer);
+	}
+
+	if (batch.GraphicsCommandBuffer != VK_NULL_HANDLE) {
+		_commandPool->DestroyCommandBuffer(
+			batch.GraphicsCommandBuffer);
+	}
+
+	// The fence signals after the semaphore wait, so the semaphore is
+	// unsignaled and free again.
+	if (batch.Semaphore != VK_NULL_HANDLE) {
+		_unusedSemaphores.push_back(batch.Semaphore);
+	}
+
+	vkResetFences(_device, 1, &batch.Fence);
+	_unusedFences.push_back(batch.Fence);
+
+	for (auto& buffer : batch.Dedicated) {
+		BufferHelper::DestroyBuffer(_device, buffer, _memorySystem);
+	}
+
+	_tail = batch.End;
+	_completed = batch.Ticket;
+}
+
+VkFence StagingRing::GetFence()
+{
+	if (!_unusedFences.empty()) {
+		VkFence fence = _unusedFences.back();
+		_unusedFences.pop_back();
+
+		return fence;
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkFence fence;
+
+	VkResult res = vkCreateFence(_device, &fenceInfo, nullptr, &fence);
+
+	if (res != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create fence.");
+	}
+
+	return fence;
+}
@@ -0,0 +1,152 @@
+#ifndef _STAGING_RING_H
+#define _STAGING_RING_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+
+#include <vulkan/vulkan.h>
+
+#include "BufferHelper.h"
+#include "ImageHelper.h"
+#include "MemorySystem.h"
+#include "PhysicalDeviceSupport.h"
+#include "CommandPool.h"
+
+#define STAGING_RING_SIZE (16 * 1024 * 1024)
+
+// One persistently mapped staging buffer shared by all uploads. Copies
+// take the next free range of the ring and are recorded into a single
+// command buffer, Submit sends that batch off with a fence and does not
+// wait. Ranges of a batch are reused once its fence has signaled, the
+// ring only blocks when it runs out of space.
+//
+// Every batch ends with a barrier making its writes visible to any work
+// submitted to the graphics queue after it, so uploaded resources can be
+// used right after Submit. Uploads larger than the ring get a staging
+// buffer of their own that lives as long as their batch.
+//
+// Given a transfer queue of another family, image copies run there and
+// each batch hands its images over to the graphics family: a release
+// barrier on the transfer queue, then a graphics submission waiting on
+// a semaphore of the batch and acquiring them. Images are freshly
+// created, nothing else uses them yet. Buffer copies always go to the
+// graphics queue, their destinations are ranges of buffers that are in
+// use there and whose ownership can not be handed over.
+class StagingRing
+{
+public:
+	StagingRing(
+		VkDevice device,
+		MemorySystem* memorySystem,
+		PhysicalDeviceSupport* deviceSupport,
+		CommandPool* commandPool,
+		VkQueue queue,
+		CommandPool* transferCommandPool = nullptr,
+		VkQueue transferQueue = VK_NULL_HANDLE,
+		uint32_t size = STAGING_RING_SIZE);
+	StagingRing(const StagingRing& ring) = delete;
+	// Waits for all batches.
+	~StagingRing();
+
+	void CopyToBuffer(
+		BufferHelper::Buffer buffer,
+		const void* data,
+		size_t size,
+		VkDeviceSize offset = 0);
+
+	// Region buffer offsets are relative to data. The image goes from
+	// an undefined layout to finalLayout, all of its levels and layers
+	// are transitioned.
+	void CopyToImage(
+		ImageHelper::Image image,
+		const void* data,
+		size_t size,
+		const std::vector<VkBufferImageCopy>& regions,
+		uint32_t mipLevels,
+		uint32_t layerCount,
+		VkImageLayout finalLayout);
+
+	// Records work on the uploaded resources into the graphics queue
+	// part of the batch, such as mip generation. Images copied so far
+	// are owned by the graphics queue there and in the layout their
+	// copy left them in.
+	void RecordGraphics(std::function<void(VkCommandBuffer)> record);
+
+	// Submits the copies recorded so far. Returns a ticket for them,
+	// tickets grow with every batch.
+	uint64_t Submit();
+	bool IsComplete(uint64_t ticket);
+	// Submits the ticket's batch first if it is still being recorded.
+	void Wait(uint64_t ticket);
+	// Submits and waits for every batch to finish.
+	void Finish();
+
+private:
+	struct Batch
+	{
+		// Image copies.
+		VkCommandBuffer CommandBuffer;
+		// Separate transfer queue only, buffer copies, the image
+		// acquires and RecordGraphics work on the graphics queue.
+		VkCommandBuffer GraphicsCommandBuffer;
+		VkSemaphore Semaphore;
+		std::vector<VkImageMemoryBarrier> ImageAcquires;
+
+		// Signals once the batch can be retired.
+		VkFence Fence;
+		uint64_t Ticket;
+		// Ring position after the last range of the batch.
+		uint64_t End;
+		std::vector<BufferHelper::Buffer> Dedicated;
+	};
+
+	VkDevice _device;
+	MemorySystem* _memorySystem;
+	PhysicalDeviceSupport* _deviceSupport;
+
+	CommandPool* _commandPool;
+	VkQueue _queue;
+	CommandPool* _transferCommandPool;
+	VkQueue _transferQueue;
+	bool _separateTransfer;
+	uint32_t _graphicsFamily;
+	uint32_t _transferFamily;
+
+	BufferHelper::Buffer _buffer;
+	uint32_t _size;
+
+	// Positions grow forever, the ring offset is position % _size.
+	uint64_t _head;
+	uint64_t _tail;
+
+	Batch _recording;
+	std::deque<Batch> _inFlight;
+	std::vector<VkFence> _unusedFences;
+	std::vector<VkSemaphore> _unusedSemaphores;
+
+	uint64_t _submitted;
+	uint64_t _completed;
+
+	std::mutex _mutex;
+
+	VkCommandBuffer GetCommandBuffer();
+	VkCommandBuffer GetGraphicsCommandBuffer();
+	VkCommandBuffer BeginCommandBuffer(CommandPool* commandPool);
+	bool IsRecording();
+	// Returns the source buffer and the offset in it to copy from.
+	VkBuffer Stage(const void* data, size_t size, VkDeviceSize& offset);
+	uint64_t Reserve(uint32_t size);
+	void SubmitRecording();
+	void SubmitTransfer();
+	void SubmitGraphics();
+	void AddImageAcquires(VkCommandBuffer commandBuffer);
+	void AddVisibilityBarrier(VkCommandBuffer commandBuffer);
+	// Retires finished batches, waits for the oldest one if wait.
+	void Reclaim(bool wait);
+	void Retire(Batch& batch);
+	VkFence GetFence();
+};
+
+#endif
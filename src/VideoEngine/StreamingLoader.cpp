@@ -0,0 +1,162 @@
+#include "StreamingLoader.h"
+
+#include "../Logger/logger.h"
+#include "../Utils/Profiler.h"
+
+StreamingLoader::StreamingLoader(
+	TextureHandler* textures,
+	uint32_t threadCount,
+	uint32_t uploadsPerUpdate) :
+	_queueSemaphore(0)
+{
+	_textures = textures;
+	_uploadsPerUpdate = uploadsPerUpdate;
+	_pendingCount = 0;
+	_nextSequence = 0;
+	_work = true;
+
+	_threads.resize(threadCount);
+
+	for (size_t i = 0; i < _threads.size(); ++i) {
+		_threads[i] = new std::thread(
+			&StreamingLoader::ThreadFunction,
+			this);
+	}
+}
+
+StreamingLoader::~StreamingLoader()
+{
+	_queueMutex.lock();
+	_work = false;
+	_queueMutex.unlock();
+
+	for (size_t i = 0; i < _threads.size(); ++i) {
+		_queueSemaphore.release();
+	}
+
+	for (size_t i = 0; i < _threads.size(); ++i) {
+		_threads[i]->join();
+		delete _threads[i];
+	}
+}
+
+uint32_t StreamingLoader::RequestTexture(std::string file, Priority priority)
+{
+	// Opaque mid grey, close to the average of most textures.
+	static const uint8_t placeholder[4] = {128, 128, 128, 255};
+
+	Request request;
+	request.Level = priority;
+	request.File = file;
+	request.Texture = _textures->AddTexture(
+		1,
+		1,
+		placeholder,
+		sizeof(placeholder));
+
+	Enqueue(request);
+
+	return request.Texture;
+}
+
+void StreamingLoader::Update()
+{
+	PROFILE_ZONE("StreamingLoader::Update");
+
+	for (auto texture = _uploading.begin(); texture != _uploading.end();) {
+		if (_textures->IsUploaded(*texture)) {
+			texture = _uploading.erase(texture);
+			--_pendingCount;
+		} else {
+			++texture;
+		}
+	}
+
+	for (uint32_t i = 0; i < _uploadsPerUpdate; ++i) {
+		_resultMutex.lock();
+
+		if (_results.empty()) {
+			_resultMutex.unlock();
+			break;
+		}
+
+		Result result = std::move(_results.front());
+		_results.pop_front();
+		_resultMutex.unlock();
+
+		bool uploading = false;
+
+		try {
+			uploading = Apply(result);
+		} catch (std::exception& e) {
+			LOG_ERROR << "Uploading " << result.Origin.File <<
+				" failed: " << e.what();
+		}
+
+		if (uploading) {
+			_uploading.push_back(result.Origin.Texture);
+		} else {
+			--_pendingCount;
+		}
+	}
+}
+
+void StreamingLoader::Enqueue(Request request)
+{
+	_queueMutex.lock();
+	request.Sequence = _nextSequence++;
+	_queue.push(request);
+	_queueMutex.unlock();
+
+	++_pendingCount;
+	_queueSemaphore.release();
+}
+
+void StreamingLoader::ThreadFunction()
+{
+	Profiler::SetThreadName("StreamingLoader");
+
+	while (true) {
+		_queueSemaphore.acquire();
+
+		_queueMutex.lock();
+
+		if (!_work || _queue.empty()) {
+			_queueMutex.unlock();
+			break;
+		}
+
+		Result result;
+		result.Origin = _queue.top();
+		_queue.pop();
+		_queueMutex.unlock();
+
+		try {
+			PROFILE_ZONE("StreamingLoader::Decode");
+
+			result.Texture = Loader::LoadTexture(
+				result.Origin.File);
+		} catch (std::exception& e) {
+			result.Error = e.what();
+		}
+
+		_resultMutex.lock();
+		_results.push_back(std::move(result));
+		_resultMutex.unlock();
+	}
+}
+
+bool StreamingLoader::Apply(Result& result)
+{
+	const Request& request = result.Origin;
+
+	if (!result.Error.empty()) {
+		LOG_ERROR << "Streaming " << request.File << " failed: " <<
+			result.Error;
+		return false;
+	}
+
+	_textures->ReplaceTexture(request.Texture, result.Texture);
+
+	return true;
+}
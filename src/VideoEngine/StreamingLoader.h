@@ -0,0 +1,113 @@
+#ifndef _STREAMING_LOADER_H
+#define _STREAMING_LOADER_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <queue>
+#include <semaphore>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include "TextureHandler.h"
+#include "../Utils/loader.h"
+#include "../Utils/ImageDecoder.h"
+#include "../Utils/TextureContainer.h"
+
+// Loads textures in the background so a scene can be drawn before all
+// of its images are in. Requests return at once, worker threads decode
+// the most urgent ones first and Update, called on the render thread
+// between frames, uploads a few finished ones per call.
+// Uploads go through the staging ring and are polled, never waited for.
+class StreamingLoader
+{
+public:
+	enum class Priority : uint32_t
+	{
+		High = 0,
+		Normal = 1,
+		Low = 2
+	};
+
+	StreamingLoader(
+		TextureHandler* textures,
+		uint32_t threadCount,
+		uint32_t uploadsPerUpdate = 2);
+	StreamingLoader(const StreamingLoader& loader) = delete;
+	// Requests still queued are dropped.
+	~StreamingLoader();
+
+	// Returns a texture index bound to a 1x1 placeholder until the
+	// image has been decoded and uploaded. DDS and KTX2 files, and the
+	// cooked outputs found through CookedAssets, are uploaded with
+	// their stored mips and block compression. Must be called on the
+	// render thread, or before the render loop starts.
+	uint32_t RequestTexture(
+		std::string file,
+		Priority priority = Priority::Normal);
+
+	void Update();
+
+	// Requests whose data is not on the GPU yet.
+	uint32_t GetPendingCount()
+	{
+		return _pendingCount;
+	}
+
+private:
+	struct Request
+	{
+		Priority Level;
+		uint64_t Sequence;
+		std::string File;
+		uint32_t Texture;
+	};
+
+	struct RequestOrder
+	{
+		bool operator()(const Request& a, const Request& b) const
+		{
+			if (a.Level != b.Level) {
+				return a.Level > b.Level;
+			}
+
+			return a.Sequence > b.Sequence;
+		}
+	};
+
+	struct Result
+	{
+		Request Origin;
+		std::string Error;
+
+		Loader::LoadedTexture Texture;
+	};
+
+	TextureHandler* _textures;
+	uint32_t _uploadsPerUpdate;
+	std::atomic<uint32_t> _pendingCount;
+	uint64_t _nextSequence;
+
+	std::priority_queue<Request, std::vector<Request>, RequestOrder>
+		_queue;
+	std::mutex _queueMutex;
+	std::counting_semaphore<> _queueSemaphore;
+
+	std::list<Result> _results;
+	std::mutex _resultMutex;
+
+	// Textures replaced by Update whose upload is still in flight.
+	std::vector<uint32_t> _uploading;
+
+	std::vector<std::thread*> _threads;
+	bool _work;
+
+	void Enqueue(Request request);
+	void ThreadFunction();
+	// True when a texture upload was started.
+	bool Apply(Result& result);
+};
+
+#endif
@@ -1,28 +1,36 @@
 #include "TextureHandler.h"
 
 #include <cmath>
-#include <cstring>
+
+#include "../Utils/Profiler.h"
+#include "../Utils/Metrics.h"
 
 TextureHandler::TextureHandler(
 	VkDevice device,
 	PhysicalDeviceSupport* deviceSupport,
 	MemorySystem* memorySystem,
 	VkDescriptorSetLayout descriptorSetLayout,
-	CommandPool* commandPool,
-	VkQueue graphicsQueue)
+	StagingRing* stagingRing,
+	uint32_t framesInFlight)
 {
 	_device = device;
 	_memorySystem = memorySystem;
 	_descriptorSetLayout = descriptorSetLayout;
 	_deviceSupport = deviceSupport;
-	_commandPool = commandPool;
-	_graphicsQueue = graphicsQueue;
+	_stagingRing = stagingRing;
+
+	_framesInFlight = framesInFlight;
 
 	_lastIndex = 0;
+	_frame = 0;
 }
 
 TextureHandler::~TextureHandler()
 {
+	for (auto& retired : _retired) {
+		DestroyTextureDescriptor(retired.Descriptor);
+	}
+
 	for (auto& texture : _textures) {
 		DestroyTextureDescriptor(texture.second);
 	}
@@ -36,50 +44,391 @@ uint32_t TextureHandler::AddTexture(
 	VkImageCreateFlagBits flags,
 	uint32_t layerCount)
 {
-	uint32_t index = _lastIndex + 1;
-
-	while (_textures.find(index) != _textures.end()) {
-		++index;
-	}
+	return AddTexture(
+		width,
+		height,
+		texture.data(),
+		texture.size(),
+		type,
+		flags,
+		layerCount);
+}
 
-	_lastIndex = index;
+uint32_t TextureHandler::AddTexture(
+	uint32_t width,
+	uint32_t height,
+	const uint8_t* texture,
+	size_t size,
+	TextureType type,
+	VkImageCreateFlagBits flags,
+	uint32_t layerCount)
+{
+	PROFILE_ZONE("TextureHandler::AddTexture");
 
-	_textures[index] = CreateTextureDescriptor(
+	TextureDescriptor descriptor = CreateTextureDescriptor(
 		type,
 		width,
 		height,
 		texture,
+		size,
 		flags,
 		layerCount);
 
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	uint32_t index = GetFreeIndex();
+	_textures[index] = descriptor;
+
 	return index;
 }
 
+uint32_t TextureHandler::AddTexture(const TextureContainer::Texture& texture)
+{
+	PROFILE_ZONE("TextureHandler::AddTexture");
+
+	TextureDescriptor descriptor = CreateTextureDescriptor(texture);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	uint32_t index = GetFreeIndex();
+	_textures[index] = descriptor;
+
+	return index;
+}
+
+uint32_t TextureHandler::AddTexture(const Loader::LoadedTexture& texture)
+{
+	if (texture.IsContainer) {
+		return AddTexture(texture.Container);
+	}
+
+	return AddTexture(
+		texture.Image.GetWidth(),
+		texture.Image.GetHeight(),
+		texture.Image.GetData(),
+		texture.Image.GetSize());
+}
+
+void TextureHandler::ReplaceTexture(
+	uint32_t index,
+	uint32_t width,
+	uint32_t height,
+	const uint8_t* texture,
+	size_t size)
+{
+	PROFILE_ZONE("TextureHandler::ReplaceTexture");
+
+	ReplaceTextureDescriptor(
+		index,
+		CreateTextureDescriptor(
+			TextureType::T2D,
+			width,
+			height,
+			texture,
+			size));
+}
+
+void TextureHandler::ReplaceTexture(
+	uint32_t index,
+	const TextureContainer::Texture& texture)
+{
+	PROFILE_ZONE("TextureHandler::ReplaceTexture");
+
+	ReplaceTextureDescriptor(index, CreateTextureDescriptor(texture));
+}
+
+void TextureHandler::ReplaceTexture(
+	uint32_t index,
+	const Loader::LoadedTexture& texture)
+{
+	if (texture.IsContainer) {
+		ReplaceTexture(index, texture.Container);
+		return;
+	}
+
+	ReplaceTexture(
+		index,
+		texture.Image.GetWidth(),
+		texture.Image.GetHeight(),
+		texture.Image.GetData(),
+		texture.Image.GetSize());
+}
+
+bool TextureHandler::IsUploaded(uint32_t index)
+{
+	uint64_t upload;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto texture = _textures.find(index);
+
+		if (texture == _textures.end()) {
+			return true;
+		}
+
+		upload = texture->second.Upload;
+	}
+
+	return _stagingRing->IsComplete(upload);
+}
+
 void TextureHandler::RemoveTexture(uint32_t index)
 {
-	DestroyTextureDescriptor(_textures[index]);
-	_textures.erase(index);
+	TextureDescriptor descriptor;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		descriptor = _textures[index];
+		_textures.erase(index);
+	}
+
+	DestroyTextureDescriptor(descriptor);
+}
+
+std::vector<uint32_t> TextureHandler::GetTexturesIn(VkDeviceMemory memory)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::vector<uint32_t> indices;
+
+	for (auto& texture : _textures) {
+		if (texture.second.Image.Allocation.Memory == memory) {
+			indices.push_back(texture.first);
+		}
+	}
+
+	return indices;
+}
+
+bool TextureHandler::MoveTexture(
+	uint32_t index,
+	VkCommandBuffer commandBuffer,
+	TextureDescriptor& old)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto texture = _textures.find(index);
+
+	if (texture == _textures.end()) {
+		return false;
+	}
+
+	old = texture->second;
+
+	VkImageCreateFlagBits flags = old.Type == TextureType::TCube ?
+		VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT :
+		(VkImageCreateFlagBits)0;
+
+	ImageHelper::Image image = ImageHelper::CreateImage(
+		_device,
+		old.Width,
+		old.Height,
+		old.MipLevels,
+		VK_SAMPLE_COUNT_1_BIT,
+		old.Image.Format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+		VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		_memorySystem,
+		_deviceSupport,
+		flags,
+		old.LayerCount,
+		MemorySystem::ResourceTag::Texture);
+
+	VkImageMemoryBarrier barriers[2]{};
+
+	for (auto& barrier : barriers) {
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask =
+			VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = old.MipLevels;
+		barrier.subresourceRange.layerCount = old.LayerCount;
+	}
+
+	barriers[0].image = old.Image.Image;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	barriers[1].image = image.Image;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].srcAccessMask = 0;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		2,
+		barriers);
+
+	std::vector<VkImageCopy> regions(old.MipLevels);
+
+	for (uint32_t level = 0; level < old.MipLevels; ++level) {
+		VkImageCopy& region = regions[level];
+		region = VkImageCopy{};
+
+		region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.srcSubresource.mipLevel = level;
+		region.srcSubresource.baseArrayLayer = 0;
+		region.srcSubresource.layerCount = old.LayerCount;
+		region.dstSubresource = region.srcSubresource;
+
+		region.extent = {
+			std::max(old.Width >> level, 1u),
+			std::max(old.Height >> level, 1u),
+			1
+		};
+	}
+
+	vkCmdCopyImage(
+		commandBuffer,
+		old.Image.Image,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		image.Image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()),
+		regions.data());
+
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&barriers[1]);
+
+	texture->second = CreateTextureDescriptor(
+		old.Type,
+		image,
+		old.Width,
+		old.Height,
+		old.MipLevels,
+		old.LayerCount);
+
+	return true;
+}
+
+uint32_t TextureHandler::GetFreeIndex()
+{
+	uint32_t index = _lastIndex + 1;
+
+	while (_textures.find(index) != _textures.end()) {
+		++index;
+	}
+
+	_lastIndex = index;
+
+	return index;
 }
 
 TextureHandler::TextureDescriptor TextureHandler::CreateTextureDescriptor(
 	TextureType type,
 	uint32_t width,
 	uint32_t height,
-	const std::vector<uint8_t>& texture,
+	const uint8_t* texture,
+	size_t size,
 	VkImageCreateFlagBits flags,
 	uint32_t layerCount)
 {
-	TextureDescriptor descriptor;
-
 	uint32_t mipLevels;
-	descriptor.Image = CreateTextureImage(
+	ImageHelper::Image image = CreateTextureImage(
 		width,
 		height,
 		texture,
+		size,
 		mipLevels,
 		flags,
 		layerCount);
 
+	TextureDescriptor descriptor = CreateTextureDescriptor(
+		type,
+		image,
+		width,
+		height,
+		mipLevels,
+		layerCount);
+	descriptor.Upload = _stagingRing->Submit();
+
+	return descriptor;
+}
+
+TextureHandler::TextureDescriptor TextureHandler::CreateTextureDescriptor(
+	const TextureContainer::Texture& texture)
+{
+	TextureType type = texture.Cube ?
+		TextureType::TCube :
+		TextureType::T2D;
+
+	bool generateMips = texture.MipLevels == 1 &&
+		texture.LayerCount == 1 &&
+		texture.Format == TextureContainer::TextureFormat::RGBA8_SRGB;
+
+	if (generateMips) {
+		return CreateTextureDescriptor(
+			type,
+			texture.Width,
+			texture.Height,
+			texture.Data.data(),
+			texture.Data.size());
+	}
+
+	TextureDescriptor descriptor = CreateTextureDescriptor(
+		type,
+		CreateTextureImage(texture),
+		texture.Width,
+		texture.Height,
+		texture.MipLevels,
+		texture.LayerCount);
+	descriptor.Upload = _stagingRing->Submit();
+
+	return descriptor;
+}
+
+TextureHandler::TextureDescriptor TextureHandler::CreateTextureDescriptor(
+	TextureType type,
+	ImageHelper::Image image,
+	uint32_t width,
+	uint32_t height,
+	uint32_t mipLevels,
+	uint32_t layerCount)
+{
+	TextureDescriptor descriptor;
+	descriptor.Image = image;
+	descriptor.Type = type;
+	descriptor.Width = width;
+	descriptor.Height = height;
+	descriptor.MipLevels = mipLevels;
+	descriptor.LayerCount = layerCount;
+	descriptor.Upload = 0;
+
+	METRIC_COUNTER_ADD("texture.count", 1);
+	METRIC_COUNTER_ADD(
+		"texture.bytes",
+		descriptor.Image.Allocation.Size);
+
 	VkImageViewType vType = VK_IMAGE_VIEW_TYPE_2D;
 
 	switch (type) {
@@ -94,7 +443,7 @@ TextureHandler::TextureDescriptor TextureHandler::CreateTextureDescriptor(
 	descriptor.ImageView = ImageHelper::CreateImageView(
 		_device,
 		descriptor.Image.Image,
-		VK_FORMAT_R8G8B8A8_SRGB,
+		descriptor.Image.Format,
 		VK_IMAGE_ASPECT_COLOR_BIT,
 		mipLevels,
 		vType,
@@ -110,11 +459,34 @@ TextureHandler::TextureDescriptor TextureHandler::CreateTextureDescriptor(
 	return descriptor;
 }
 
+void TextureHandler::ReplaceTextureDescriptor(
+	uint32_t index,
+	TextureDescriptor descriptor)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto old = _textures.find(index);
+
+	if (old == _textures.end()) {
+		DestroyTextureDescriptor(descriptor);
+		throw std::runtime_error("Replacing unknown texture.");
+	}
+
+	// Frames in flight may still sample the old image.
+	_retired.push_back({old->second, _frame});
+	old->second = descriptor;
+}
+
 void TextureHandler::DestroyTextureDescriptor(
 	TextureDescriptor& descriptor)
 {
 	DestroyDescriptorSets(&descriptor);
 
+	METRIC_COUNTER_ADD("texture.count", -1);
+	METRIC_COUNTER_ADD(
+		"texture.bytes",
+		-(int64_t)descriptor.Image.Allocation.Size);
+
 	ImageHelper::DestroyImageSampler(_device, descriptor.Sampler);
 
 	ImageHelper::DestroyImageView(_device, descriptor.ImageView);
@@ -122,6 +494,30 @@ void TextureHandler::DestroyTextureDescriptor(
 	ImageHelper::DestroyImage(_device, descriptor.Image, _memorySystem);
 }
 
+// Frames finish in order, so once the fence of this frame's slot has
+// signaled every frame recorded before the previous one is done.
+void TextureHandler::BeginFrame()
+{
+	std::vector<TextureDescriptor> expired;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		++_frame;
+
+		while (!_retired.empty() &&
+			_retired.front().Frame + _framesInFlight <= _frame)
+		{
+			expired.push_back(_retired.front().Descriptor);
+			_retired.pop_front();
+		}
+	}
+
+	for (auto& descriptor : expired) {
+		DestroyTextureDescriptor(descriptor);
+	}
+}
+
 void TextureHandler::CreateDescriptorSets(TextureDescriptor* descriptor)
 {
 	VkDescriptorPoolSize poolSize{};
@@ -190,16 +586,23 @@ void TextureHandler::DestroyDescriptorSets(TextureDescriptor* descriptor)
 ImageHelper::Image TextureHandler::CreateTextureImage(
 	uint32_t width,
 	uint32_t height,
-	const std::vector<uint8_t>& texture,
+	const uint8_t* texture,
+	size_t size,
 	uint32_t& mipLevels,
 	VkImageCreateFlagBits flags,
 	uint32_t layerCount)
 {
+	PROFILE_ZONE("TextureHandler::CreateTextureImage");
+
 	uint32_t texWidth = width;
 	uint32_t texHeight = height;
 
 	uint32_t imageSize = texWidth * texHeight * 4;
 
+	if (size != (size_t)imageSize * layerCount) {
+		throw std::runtime_error("Texture data size mismatch.");
+	}
+
 	mipLevels = static_cast<uint32_t>(
 		std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
@@ -222,54 +625,30 @@ ImageHelper::Image TextureHandler::CreateTextureImage(
 		_memorySystem,
 		_deviceSupport,
 		flags,
-		layerCount);
-
-	BufferHelper::Buffer stagingBuffer = BufferHelper::CreateBuffer(
-		_device,
-		imageSize * layerCount,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		_memorySystem,
-		_deviceSupport);
-
-	uint32_t* imageData;
-	vkMapMemory(
-		_device,
-		stagingBuffer.Allocation.Memory,
-		stagingBuffer.Allocation.Offset,
-		stagingBuffer.Allocation.Size,
-		0,
-		reinterpret_cast<void**>(&imageData));
-
-	memcpy(imageData, texture.data(), texture.size());
-
-	vkUnmapMemory(
-		_device,
-		stagingBuffer.Allocation.Memory);
-
-	ImageHelper::ChangeImageLayout(
+		layerCount,
+		MemorySystem::ResourceTag::Texture);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = layerCount;
+	region.imageOffset = {0, 0, 0};
+	region.imageExtent = {texWidth, texHeight, 1};
+
+	// Mip generation reads the copied level, so it stays a transfer
+	// destination until then.
+	_stagingRing->CopyToImage(
 		textureImage,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		texture,
+		size,
+		{region},
 		mipLevels,
-		_commandPool,
-		_graphicsQueue,
-		layerCount);
-
-	ImageHelper::CopyBufferToImage(
-		stagingBuffer,
-		textureImage,
-		texWidth,
-		texHeight,
-		_commandPool,
-		_graphicsQueue,
-		layerCount);
-
-	BufferHelper::DestroyBuffer(
-		_device,
-		stagingBuffer,
-		_memorySystem);
+		layerCount,
+		layerCount == 1 ?
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL :
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 	if (layerCount == 1) {
 		GenerateMipmaps(
@@ -277,20 +656,127 @@ ImageHelper::Image TextureHandler::CreateTextureImage(
 			texWidth,
 			texHeight,
 			mipLevels);
-	} else {
-		ImageHelper::ChangeImageLayout(
-			textureImage,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			mipLevels,
-			_commandPool,
-			_graphicsQueue,
-			layerCount);
 	}
 
 	return textureImage;
 }
 
+ImageHelper::Image TextureHandler::CreateTextureImage(
+	const TextureContainer::Texture& texture)
+{
+	PROFILE_ZONE("TextureHandler::CreateTextureImage");
+
+	VkFormat format = GetFormat(texture.Format);
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(
+		_deviceSupport->GetPhysicalDevice(),
+		format,
+		&formatProperties);
+
+	if (!(formatProperties.optimalTilingFeatures &
+		VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+	{
+		throw std::runtime_error(
+			"Texture format is not supported by the device.");
+	}
+
+	uint64_t size = TextureContainer::GetLayerSize(texture) *
+		texture.LayerCount;
+
+	if (texture.Data.size() != size) {
+		throw std::runtime_error("Texture data size mismatch.");
+	}
+
+	VkImageCreateFlagBits flags = texture.Cube ?
+		VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT :
+		(VkImageCreateFlagBits)0;
+
+	ImageHelper::Image textureImage = ImageHelper::CreateImage(
+		_device,
+		texture.Width,
+		texture.Height,
+		texture.MipLevels,
+		VK_SAMPLE_COUNT_1_BIT,
+		format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+		VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		_memorySystem,
+		_deviceSupport,
+		flags,
+		texture.LayerCount,
+		MemorySystem::ResourceTag::Texture);
+
+	// The staged data keeps the container layout, every level of
+	// every layer is copied from its own offset.
+	std::vector<VkBufferImageCopy> regions;
+
+	for (uint32_t layer = 0; layer < texture.LayerCount; ++layer) {
+		for (uint32_t level = 0; level < texture.MipLevels; ++level) {
+			VkBufferImageCopy region{};
+			region.bufferOffset = TextureContainer::GetLevelOffset(
+				texture,
+				layer,
+				level);
+
+			region.imageSubresource.aspectMask =
+				VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.baseArrayLayer = layer;
+			region.imageSubresource.layerCount = 1;
+
+			region.imageOffset = {0, 0, 0};
+			region.imageExtent = {
+				std::max(texture.Width >> level, 1u),
+				std::max(texture.Height >> level, 1u),
+				1
+			};
+
+			regions.push_back(region);
+		}
+	}
+
+	_stagingRing->CopyToImage(
+		textureImage,
+		texture.Data.data(),
+		size,
+		regions,
+		texture.MipLevels,
+		texture.LayerCount,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	return textureImage;
+}
+
+VkFormat TextureHandler::GetFormat(TextureContainer::TextureFormat format)
+{
+	using TextureContainer::TextureFormat;
+
+	switch (format) {
+	case TextureFormat::RGBA8_SRGB:
+		return VK_FORMAT_R8G8B8A8_SRGB;
+	case TextureFormat::BC1_UNORM:
+		return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case TextureFormat::BC1_SRGB:
+		return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+	case TextureFormat::BC3_UNORM:
+		return VK_FORMAT_BC3_UNORM_BLOCK;
+	case TextureFormat::BC3_SRGB:
+		return VK_FORMAT_BC3_SRGB_BLOCK;
+	case TextureFormat::BC5_UNORM:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	case TextureFormat::BC7_UNORM:
+		return VK_FORMAT_BC7_UNORM_BLOCK;
+	case TextureFormat::BC7_SRGB:
+		return VK_FORMAT_BC7_SRGB_BLOCK;
+	}
+
+	throw std::runtime_error("Unknown texture format.");
+}
+
 void TextureHandler::GenerateMipmaps(
 	ImageHelper::Image image,
 	uint32_t width,
@@ -310,9 +796,20 @@ void TextureHandler::GenerateMipmaps(
 			"Image format does not support linear blitting.");
 	}
 
-	VkCommandBuffer commandBuffer =
-		_commandPool->StartOneTimeBuffer();
+	_stagingRing->RecordGraphics(
+		[image, width, height, mipLevels](VkCommandBuffer commandBuffer)
+	{
+		RecordMipmaps(commandBuffer, image, width, height, mipLevels);
+	});
+}
 
+void TextureHandler::RecordMipmaps(
+	VkCommandBuffer commandBuffer,
+	ImageHelper::Image image,
+	uint32_t width,
+	uint32_t height,
+	uint32_t mipLevels)
+{
 	VkImageMemoryBarrier barrier{};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	barrier.image = image.Image;
@@ -419,6 +916,4 @@ void TextureHandler::GenerateMipmaps(
 		nullptr,
 		1,
 		&barrier);
-
-	_commandPool->EndOneTimeBuffer(commandBuffer, _graphicsQueue);
 }
@@ -1,9 +1,16 @@
 #ifndef _TEXTURE_HANDLER_H
 #define _TEXTURE_HANDLER_H
 
+#include <map>
+#include <deque>
+#include <mutex>
+
 #include "ImageHelper.h"
 #include "PhysicalDeviceSupport.h"
 #include "CommandPool.h"
+#include "StagingRing.h"
+#include "../Utils/TextureContainer.h"
+#include "../Utils/loader.h"
 
 class TextureHandler
 {
@@ -22,6 +29,16 @@ public:
 
 		VkDescriptorPool DescriptorPool;
 		VkDescriptorSet DescriptorSet;
+
+		// What the image was created with, to recreate it.
+		TextureType Type;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t MipLevels;
+		uint32_t LayerCount;
+
+		// Staging ring ticket of the upload, see IsUploaded.
+		uint64_t Upload;
 	};
 
 	TextureHandler(
@@ -29,8 +46,8 @@ public:
 		PhysicalDeviceSupport* deviceSupport,
 		MemorySystem* memorySystem,
 		VkDescriptorSetLayout descriptorSetLayout,
-		CommandPool* commandPool,
-		VkQueue graphicsQueue);
+		StagingRing* stagingRing,
+		uint32_t framesInFlight);
 	~TextureHandler();
 
 	uint32_t AddTexture(
@@ -40,34 +57,118 @@ public:
 		TextureType type = TextureType::T2D,
 		VkImageCreateFlagBits flags = (VkImageCreateFlagBits)0,
 		uint32_t layerCount = 1);
+	// RGBA8 pixels of every layer, copied straight into the staging
+	// buffer. size must be width * height * 4 * layerCount.
+	uint32_t AddTexture(
+		uint32_t width,
+		uint32_t height,
+		const uint8_t* texture,
+		size_t size,
+		TextureType type = TextureType::T2D,
+		VkImageCreateFlagBits flags = (VkImageCreateFlagBits)0,
+		uint32_t layerCount = 1);
+	// Uploads the levels stored in the container as they are, block
+	// compressed ones included, cube containers become cube textures.
+	// Single level RGBA8 2D textures get their mips generated.
+	uint32_t AddTexture(const TextureContainer::Texture& texture);
+	// Either of the above, decoded pixels are staged straight from the
+	// decoder's buffer.
+	uint32_t AddTexture(const Loader::LoadedTexture& texture);
+
+	// Swaps the image behind index, models keep drawing through the
+	// same index. The old image is destroyed once the frames in flight
+	// are done with it.
+	void ReplaceTexture(
+		uint32_t index,
+		uint32_t width,
+		uint32_t height,
+		const uint8_t* texture,
+		size_t size);
+	void ReplaceTexture(
+		uint32_t index,
+		const TextureContainer::Texture& texture);
+	void ReplaceTexture(
+		uint32_t index,
+		const Loader::LoadedTexture& texture);
+
+	// Uploads never block. A texture can be drawn right away, frames
+	// submitted later wait for its upload on the GPU. Polls whether
+	// that upload has finished, true for removed textures.
+	bool IsUploaded(uint32_t index);
 
 	void RemoveTexture(uint32_t index);
 
-	TextureDescriptor& GetTexture(uint32_t index)
+	// Textures whose image lives in memory.
+	std::vector<uint32_t> GetTexturesIn(VkDeviceMemory memory);
+	// Records a copy of the image behind index into newly allocated
+	// memory and swaps the copy in. Hands out the old descriptor, the
+	// caller destroys it with DestroyTextureDescriptor once the copy
+	// and every frame recorded before have finished. False when the
+	// texture has been removed in the meantime.
+	bool MoveTexture(
+		uint32_t index,
+		VkCommandBuffer commandBuffer,
+		TextureDescriptor& old);
+	void DestroyTextureDescriptor(TextureDescriptor& descriptor);
+
+	// Once per frame, after its fence was waited for. Destroys the
+	// replaced textures no frame in flight can use anymore.
+	void BeginFrame();
+
+	// A copy, other threads may replace the texture right after.
+	TextureDescriptor GetTexture(uint32_t index)
 	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
 		return _textures[index];
 	}
 
 private:
+	struct Retired
+	{
+		TextureDescriptor Descriptor;
+		uint64_t Frame;
+	};
+
+	// Textures are added and removed by the game and loader threads
+	// while the render thread reads and moves them.
 	std::map<uint32_t, TextureDescriptor> _textures;
 	uint32_t _lastIndex;
+	std::deque<Retired> _retired;
+	uint64_t _frame;
+	uint32_t _framesInFlight;
+	std::mutex _mutex;
 
 	VkDevice _device;
 	PhysicalDeviceSupport* _deviceSupport;
 	MemorySystem* _memorySystem;
-	CommandPool* _commandPool;
-	VkQueue _graphicsQueue;
+	StagingRing* _stagingRing;
 
 	VkDescriptorSetLayout _descriptorSetLayout;
 
+	// Expects the mutex held.
+	uint32_t GetFreeIndex();
+
 	TextureDescriptor CreateTextureDescriptor(
 		TextureType type,
 		uint32_t width,
 		uint32_t height,
-		const std::vector<uint8_t>& texture,
+		const uint8_t* texture,
+		size_t size,
 		VkImageCreateFlagBits flags = (VkImageCreateFlagBits)0,
 		uint32_t layerCount = 1);
-	void DestroyTextureDescriptor(TextureDescriptor& descriptor);
+	TextureDescriptor CreateTextureDescriptor(
+		const TextureContainer::Texture& texture);
+	TextureDescriptor CreateTextureDescriptor(
+		TextureType type,
+		ImageHelper::Image image,
+		uint32_t width,
+		uint32_t height,
+		uint32_t mipLevels,
+		uint32_t layerCount);
+	void ReplaceTextureDescriptor(
+		uint32_t index,
+		TextureDescriptor descriptor);
 
 	void CreateDescriptorSets(TextureDescriptor* descriptor);
 	void DestroyDescriptorSets(TextureDescriptor* descriptor);
@@ -75,16 +176,28 @@ private:
 	ImageHelper::Image CreateTextureImage(
 		uint32_t width,
 		uint32_t height,
-		const std::vector<uint8_t>& texture,
+		const uint8_t* texture,
+		size_t size,
 		uint32_t& mipLevels,
 		VkImageCreateFlagBits flags = (VkImageCreateFlagBits)0,
 		uint32_t layerCount = 1);
+	ImageHelper::Image CreateTextureImage(
+		const TextureContainer::Texture& texture);
+
+	static VkFormat GetFormat(TextureContainer::TextureFormat format);
 
+	// Recorded into the staging batch that copied the first level.
 	void GenerateMipmaps(
 		ImageHelper::Image image,
 		uint32_t width,
 		uint32_t height,
 		uint32_t mipLevels);
+	static void RecordMipmaps(
+		VkCommandBuffer commandBuffer,
+		ImageHelper::Image image,
+		uint32_t width,
+		uint32_t height,
+		uint32_t mipLevels);
 };
 
 #endif
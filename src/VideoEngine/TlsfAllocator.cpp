@@ -0,0 +1,268 @@
+#include "TlsfAllocator.h"
+
+#include <bit>
+#include <algorithm>
+#include <stdexcept>
+
+TlsfAllocator::TlsfAllocator(uint32_t size, uint32_t granularity)
+{
+	if (granularity == 0 || size < granularity) {
+		throw std::runtime_error(
+			"Allocator range is smaller than a granule.");
+	}
+
+	_granularity = granularity;
+	_size = size / granularity * granularity;
+	_freeSize = _size;
+
+	_firstLevelBitmap = 0;
+
+	for (uint32_t first = 0; first < FirstLevelCount; ++first) {
+		_secondLevelBitmaps[first] = 0;
+
+		for (uint32_t second = 0; second < SecondLevelCount; ++second) {
+			_freeLists[first][second] = NoBlock;
+		}
+	}
+
+	InsertFree(CreateBlock(0, _size / granularity));
+}
+
+uint32_t TlsfAllocator::Allocate(uint32_t size, uint32_t& offset)
+{
+	uint32_t granules = std::max<uint64_t>(
+		((uint64_t)size + _granularity - 1) / _granularity,
+		1);
+
+	uint32_t block = FindFree(granules);
+
+	if (block == NoBlock) {
+		return NoBlock;
+	}
+
+	RemoveFree(block);
+
+	// The tail goes back as a free block of its own.
+	if (_blocks[block].Size > granules) {
+		uint32_t rest = CreateBlock(
+			_blocks[block].Offset + granules,
+			_blocks[block].Size - granules);
+		uint32_t next = _blocks[block].NextPhysical;
+
+		_blocks[rest].PreviousPhysical = block;
+		_blocks[rest].NextPhysical = next;
+
+		if (next != NoBlock) {
+			_blocks[next].PreviousPhysical = rest;
+		}
+
+		_blocks[block].NextPhysical = rest;
+		_blocks[block].Size = granules;
+
+		InsertFree(rest);
+	}
+
+	_blocks[block].Free = false;
+	_freeSize -= granules * _granularity;
+
+	offset = _blocks[block].Offset * _granularity;
+
+	return block;
+}
+
+void TlsfAllocator::Free(uint32_t block)
+{
+	if (block >= _blocks.size() || _blocks[block].Free) {
+		throw std::runtime_error("Tried to free invalid memory block.");
+	}
+
+	_blocks[block].Free = true;
+	_freeSize += _blocks[block].Size * _granularity;
+
+	uint32_t previous = _blocks[block].PreviousPhysical;
+
+	if (previous != NoBlock && _blocks[previous].Free) {
+		RemoveFree(previous);
+		Merge(previous, block);
+		block = previous;
+	}
+
+	uint32_t next = _blocks[block].NextPhysical;
+
+	if (next != NoBlock && _blocks[next].Free) {
+		RemoveFree(next);
+		Merge(block, next);
+	}
+
+	InsertFree(block);
+}
+
+// Sizes below SecondLevelCount granules get a list each, above that every
+// power of two is split into SecondLevelCount lists.
+void TlsfAllocator::Mapping(
+	uint32_t size,
+	uint32_t& firstLevel,
+	uint32_t& secondLevel)
+{
+	if (size < SecondLevelCount) {
+		firstLevel = 0;
+		secondLevel = size;
+		return;
+	}
+
+	uint32_t top = std::bit_width(size) - 1;
+
+	firstLevel = top - SecondLevelBits + 1;
+	secondLevel = (size >> (top - SecondLevelBits)) - SecondLevelCount;
+}
+
+uint32_t TlsfAllocator::CreateBlock(uint32_t offset, uint32_t size)
+{
+	uint32_t index;
+
+	if (_unusedBlocks.empty()) {
+		index = _blocks.size();
+		_blocks.emplace_back();
+	} else {
+		index = _unusedBlocks.back();
+		_unusedBlocks.pop_back();
+	}
+
+	Block& block = _blocks[index];
+	block.Offset = offset;
+	block.Size = size;
+	block.PreviousPhysical = NoBlock;
+	block.NextPhysical = NoBlock;
+	block.PreviousFree = NoBlock;
+	block.NextFree = NoBlock;
+	block.Free = true;
+
+	return index;
+}
+
+void TlsfAllocator::DestroyBlock(uint32_t block)
+{
+	_blocks[block].Free = true;
+	_unusedBlocks.push_back(block);
+}
+
+void TlsfAllocator::InsertFree(uint32_t block)
+{
+	uint32_t first;
+	uint32_t second;
+	Mapping(_blocks[block].Size, first, second);
+
+	uint32_t head = _freeLists[first][second];
+
+	_blocks[block].PreviousFree = NoBlock;
+	_blocks[block].NextFree = head;
+
+	if (head != NoBlock) {
+		_blocks[head].PreviousFree = block;
+	}
+
+	_freeLists[first][second] = block;
+	_firstLevelBitmap |= 1u << first;
+	_secondLevelBitmaps[first] |= 1u << second;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t block)
+{
+	uint32_t first;
+	uint32_t second;
+	Mapping(_blocks[block].Size, first, second);
+
+	uint32_t previous = _blocks[block].PreviousFree;
+	uint32_t next = _blocks[block].NextFree;
+
+	if (previous != NoBlock) {
+		_blocks[previous].NextFree = next;
+	}
+
+	if (next != NoBlock) {
+		_blocks[next].PreviousFree = previous;
+	}
+
+	if (_freeLists[first][second] != block) {
+		return;
+	}
+
+	_freeLists[first][second] = next;
+
+	if (next == NoBlock) {
+		_secondLevelBitmaps[first] &= ~(1u << second);
+
+		if (_secondLevelBitmaps[first] == 0) {
+			_firstLevelBitmap &= ~(1u << first);
+		}
+	}
+}
+
+uint32_t TlsfAllocator::FindFree(uint32_t size)
+{
+	// Rounded up to the next list, so any block found there fits.
+	uint64_t rounded = size;
+
+	if (size >= SecondLevelCount) {
+		uint32_t top = std::bit_width(size) - 1;
+		rounded += (1u << (top - SecondLevelBits)) - 1;
+	}
+
+	if (rounded > UINT32_MAX) {
+		return FindFreeExact(size);
+	}
+
+	uint32_t first;
+	uint32_t second;
+	Mapping(rounded, first, second);
+
+	uint32_t secondMap = _secondLevelBitmaps[first] & (~0u << second);
+
+	if (secondMap == 0) {
+		uint32_t firstMap = first + 1 < FirstLevelCount ?
+			_firstLevelBitmap & (~0u << (first + 1)) :
+			0;
+
+		if (firstMap == 0) {
+			return FindFreeExact(size);
+		}
+
+		first = std::countr_zero(firstMap);
+		secondMap = _secondLevelBitmaps[first];
+	}
+
+	second = std::countr_zero(secondMap);
+
+	return _freeLists[first][second];
+}
+
+// Blocks in the list of size itself may still fit. Only the head is tried,
+// which keeps this constant time.
+uint32_t TlsfAllocator::FindFreeExact(uint32_t size)
+{
+	uint32_t first;
+	uint32_t second;
+	Mapping(size, first, second);
+
+	uint32_t block = _freeLists[first][second];
+
+	if (block != NoBlock && _blocks[block].Size >= size) {
+		return block;
+	}
+
+	return NoBlock;
+}
+
+void TlsfAllocator::Merge(uint32_t block, uint32_t next)
+{
+	uint32_t after = _blocks[next].NextPhysical;
+
+	_blocks[block].Size += _blocks[next].Size;
+	_blocks[block].NextPhysical = after;
+
+	if (after != NoBlock) {
+		_blocks[after].PreviousPhysical = block;
+	}
+
+	DestroyBlock(next);
+}
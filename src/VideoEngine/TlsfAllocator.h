@@ -0,0 +1,85 @@
+#ifndef _TLSF_ALLOCATOR_H
+#define _TLSF_ALLOCATOR_H
+
+#include <vector>
+#include <cstdint>
+
+// Two level segregated fit allocator handing out ranges of an offset
+// space, the memory itself lives elsewhere. Free ranges are kept in lists
+// by size class with a bitmap over the lists, so Allocate and Free take
+// constant time. Offsets and sizes are multiples of the granularity.
+class TlsfAllocator
+{
+public:
+	static const uint32_t NoBlock = UINT32_MAX;
+
+	TlsfAllocator(uint32_t size, uint32_t granularity);
+
+	// Returns the block handle to free the range with, NoBlock when
+	// no free range is large enough.
+	uint32_t Allocate(uint32_t size, uint32_t& offset);
+	void Free(uint32_t block);
+
+	uint32_t GetSize()
+	{
+		return _size;
+	}
+
+	uint32_t GetFreeSize()
+	{
+		return _freeSize;
+	}
+
+	bool IsEmpty()
+	{
+		return _freeSize == _size;
+	}
+
+private:
+	// Second level lists per first level, a power of two.
+	static const uint32_t SecondLevelBits = 5;
+	static const uint32_t SecondLevelCount = 1 << SecondLevelBits;
+	static const uint32_t FirstLevelCount = 32;
+
+	struct Block
+	{
+		// In granules.
+		uint32_t Offset;
+		uint32_t Size;
+
+		uint32_t PreviousPhysical;
+		uint32_t NextPhysical;
+		uint32_t PreviousFree;
+		uint32_t NextFree;
+
+		bool Free;
+	};
+
+	uint32_t _size;
+	uint32_t _granularity;
+	uint32_t _freeSize;
+
+	std::vector<Block> _blocks;
+	std::vector<uint32_t> _unusedBlocks;
+
+	uint32_t _firstLevelBitmap;
+	uint32_t _secondLevelBitmaps[FirstLevelCount];
+	uint32_t _freeLists[FirstLevelCount][SecondLevelCount];
+
+	static void Mapping(
+		uint32_t size,
+		uint32_t& firstLevel,
+		uint32_t& secondLevel);
+
+	uint32_t CreateBlock(uint32_t offset, uint32_t size);
+	void DestroyBlock(uint32_t block);
+
+	void InsertFree(uint32_t block);
+	void RemoveFree(uint32_t block);
+	uint32_t FindFree(uint32_t size);
+	uint32_t FindFreeExact(uint32_t size);
+	// Joins block with the physical block after it.
+	void Merge(uint32_t block, uint32_t next);
+};
+
+#endif
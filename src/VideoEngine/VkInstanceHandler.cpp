@@ -1,5 +1,8 @@
 #include "VkInstanceHandler.h"
 
+#include <vector>
+#include <cstring>
+
 #include <GLFW/glfw3.h>
 
 namespace VkInstanceHandler
@@ -7,6 +10,36 @@ namespace VkInstanceHandler
 	static int _refCounter = 0;
 	static VkInstance _instance;
 	static std::string _appName;
+	static std::vector<const char*> _extensions;
+
+	// Enabled when present, the memory budget device extension needs
+	// it on a 1.0 instance.
+	static const char* _optionalExtensions[] = {
+		VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
+	};
+
+	static bool IsExtensionAvailable(const char* name)
+	{
+		uint32_t extensionCount = 0;
+		vkEnumerateInstanceExtensionProperties(
+			nullptr,
+			&extensionCount,
+			nullptr);
+
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateInstanceExtensionProperties(
+			nullptr,
+			&extensionCount,
+			extensions.data());
+
+		for (const auto& extension : extensions) {
+			if (strcmp(name, extension.extensionName) == 0) {
+				return true;
+			}
+		}
+
+		return false;
+	}
 
 	void CreateInstance()
 	{
@@ -26,8 +59,19 @@ namespace VkInstanceHandler
 		const char** glfwExtensions =
 			glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-		instanceInfo.enabledExtensionCount = glfwExtensionCount;
-		instanceInfo.ppEnabledExtensionNames = glfwExtensions;
+		_extensions.assign(
+			glfwExtensions,
+			glfwExtensions + glfwExtensionCount);
+
+		for (const char* extension : _optionalExtensions) {
+			if (IsExtensionAvailable(extension)) {
+				_extensions.push_back(extension);
+			}
+		}
+
+		instanceInfo.enabledExtensionCount =
+			static_cast<uint32_t>(_extensions.size());
+		instanceInfo.ppEnabledExtensionNames = _extensions.data();
 
 		instanceInfo.enabledLayerCount = 0;
 
@@ -47,6 +91,17 @@ namespace VkInstanceHandler
 		return _instance;
 	}
 
+	bool IsExtensionEnabled(const char* name)
+	{
+		for (const char* extension : _extensions) {
+			if (strcmp(name, extension) == 0) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	void IncRef()
 	{
 		if (_refCounter == 0) {
@@ -12,6 +12,8 @@ namespace VkInstanceHandler
 
 	VkInstance& GetInstance();
 
+	bool IsExtensionEnabled(const char* name);
+
 	void SetApplicationName(std::string name);
 }
 
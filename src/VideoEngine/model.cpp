@@ -1,9 +1,80 @@
 #include "model.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 Model::Model()
 {
+	_instancesChanged = false;
+	_changedFirst = 0;
+	_changedEnd = 0;
 }
 
 Model::~Model()
 {
 }
+
+void Model::SetModelInstances(const std::vector<glm::mat4>& instances)
+{
+	size_t common = std::min(instances.size(), _modelInstances.size());
+	size_t first = 0;
+	size_t end = instances.size();
+
+	while (first < common && instances[first] == _modelInstances[first]) {
+		++first;
+	}
+
+	if (instances.size() == _modelInstances.size()) {
+		while (end > first &&
+			instances[end - 1] == _modelInstances[end - 1])
+		{
+			--end;
+		}
+
+		if (first == end) {
+			return;
+		}
+	}
+
+	_modelInstances = instances;
+
+	MarkInstancesChanged(first, end);
+}
+
+void Model::SetModelInstance(uint32_t index, const glm::mat4& instance)
+{
+	if (index >= _modelInstances.size()) {
+		throw std::runtime_error("Model instance index out of range.");
+	}
+
+	_modelInstances[index] = instance;
+
+	MarkInstancesChanged(index, index + 1);
+}
+
+bool Model::_TakeInstanceChanges(uint32_t& first, uint32_t& end)
+{
+	if (!_instancesChanged) {
+		return false;
+	}
+
+	first = _changedFirst;
+	end = _changedEnd;
+
+	_instancesChanged = false;
+
+	return true;
+}
+
+void Model::MarkInstancesChanged(uint32_t first, uint32_t end)
+{
+	if (!_instancesChanged || _changedFirst >= _changedEnd) {
+		_changedFirst = first;
+		_changedEnd = end;
+	} else if (first < end) {
+		_changedFirst = std::min(_changedFirst, first);
+		_changedEnd = std::max(_changedEnd, end);
+	}
+
+	_instancesChanged = true;
+}
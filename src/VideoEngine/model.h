@@ -2,6 +2,7 @@
 #define _MODEL_H
 
 #include <vector>
+#include <memory>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
@@ -13,6 +14,11 @@
 
 #include "texturable.h"
 
+namespace MeshCache
+{
+	class Mesh;
+}
+
 class Model : public Texturable
 {
 public:
@@ -59,16 +65,34 @@ public:
 		_modelTexCoordBuffer = coords;
 	}
 
-	const std::vector<glm::mat4>& GetModelInstances()
+	// A cached mesh is uploaded straight from its mapping, its vertices
+	// are already interleaved. Replaces the separate arrays above.
+	const std::shared_ptr<MeshCache::Mesh>& GetModelMesh()
 	{
-		return _modelInstances;
+		return _modelMesh;
+	}
+
+	void SetModelMesh(std::shared_ptr<MeshCache::Mesh> mesh)
+	{
+		_modelMesh = mesh;
 	}
 
-	void SetModelInstances(const std::vector<glm::mat4>& instances)
+	const std::vector<glm::mat4>& GetModelInstances()
 	{
-		_modelInstances = instances;
+		return _modelInstances;
 	}
 
+	// Once registered, changed instances are streamed to the GPU with
+	// the next frame, only the span that differs is sent. The model
+	// locks nothing, the caller holds the scene mutex, from a tick
+	// through Universe::Defer.
+	void SetModelInstances(const std::vector<glm::mat4>& instances);
+	void SetModelInstance(uint32_t index, const glm::mat4& instance);
+
+	// Range of instances changed since the last call, false when none
+	// changed. A changed count alone gives an empty range.
+	bool _TakeInstanceChanges(uint32_t& first, uint32_t& end);
+
 	virtual const glm::mat4& GetModelInnerMatrix()
 	{
 		return _modelInnerMatrix;
@@ -94,7 +118,13 @@ private:
 	std::vector<glm::vec3> _modelNormalBuffer;
 	std::vector<uint32_t> _modelIndexBuffer;
 	std::vector<glm::vec2> _modelTexCoordBuffer;
+	std::shared_ptr<MeshCache::Mesh> _modelMesh;
 	std::vector<glm::mat4> _modelInstances;
+	bool _instancesChanged;
+	uint32_t _changedFirst;
+	uint32_t _changedEnd;
+
+	void MarkInstancesChanged(uint32_t first, uint32_t end);
 
 	glm::mat4 _modelMatrix;
 	glm::mat4 _modelInnerMatrix;
@@ -243,7 +243,7 @@ Pipeline::Pipeline(InitInfo* initInfo)
 		DestroyShaderModule(geomShaderModule);
 	}
 
-	Logger::Verbose() << "Created pipeline.";
+	LOG_VERBOSE << "Created pipeline.";
 }
 
 Pipeline::~Pipeline()
@@ -251,7 +251,7 @@ Pipeline::~Pipeline()
 	vkDestroyPipeline(_device, _pipeline, nullptr);
 	DestroyRenderPass();
 	vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
-	Logger::Verbose() << "Destroyed pipeline.";
+	LOG_VERBOSE << "Destroyed pipeline.";
 }
 
 VkShaderModule Pipeline::CreateShaderModule(const uint8_t* data, size_t size)
@@ -273,7 +273,7 @@ VkShaderModule Pipeline::CreateShaderModule(const uint8_t* data, size_t size)
 		throw std::runtime_error("Failed to create shader module.");
 	}
 
-	Logger::Verbose() << "Created shader module.";
+	LOG_VERBOSE << "Created shader module.";
 
 	return shaderModule;
 }
@@ -281,7 +281,7 @@ VkShaderModule Pipeline::CreateShaderModule(const uint8_t* data, size_t size)
 void Pipeline::DestroyShaderModule(VkShaderModule shaderModule)
 {
 	vkDestroyShaderModule(_device, shaderModule, nullptr);
-	Logger::Verbose() << "Destroyed shader module.";
+	LOG_VERBOSE << "Destroyed shader module.";
 }
 
 void Pipeline::CreateRenderPass(InitInfo* initInfo)
@@ -4,6 +4,8 @@
 #include <cstring>
 
 #include "../Logger/logger.h"
+#include "../Utils/Profiler.h"
+#include "../Utils/Metrics.h"
 #include "mvp.h"
 
 #include "shaders/spir-v/ObjectShader_vert.spv"
@@ -51,7 +53,7 @@ Swapchain::Swapchain(
 
 	_hdrImageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
 
-	Logger::Verbose() << "Swapchain constructor called.";
+	LOG_VERBOSE << "Swapchain constructor called.";
 
 	_initialized = false;
 }
@@ -121,7 +123,7 @@ VkExtent2D Swapchain::ChooseExtent(VkSurfaceCapabilitiesKHR capabilities)
 
 void Swapchain::Create()
 {
-	Logger::Verbose() << "Create swapchain called.";
+	LOG_VERBOSE << "Create swapchain called.";
 
 	if (_initialized) {
 		Destroy();
@@ -139,7 +141,7 @@ void Swapchain::Create()
 
 	_extent = ChooseExtent(supportDetails.capabilities);
 
-	Logger::Verbose() <<
+	LOG_VERBOSE <<
 		"Extent: " << _extent.width << "x" << _extent.height;
 
 	_transferCommandPool = new CommandPool(
@@ -255,12 +257,12 @@ void Swapchain::Destroy()
 
 	vkDestroySwapchainKHR(_device, _swapchain, nullptr);
 	_initialized = false;
-	Logger::Verbose() << "Swapchain destroyed.";
+	LOG_VERBOSE << "Swapchain destroyed.";
 }
 
 void Swapchain::CreateRenderingImages()
 {
-	Logger::Verbose() << "Swapchain image format: " << _imageFormat;
+	LOG_VERBOSE << "Swapchain image format: " << _imageFormat;
 
 	_colorImage = ImageHelper::CreateImage(
 		_device,
@@ -274,7 +276,10 @@ void Swapchain::CreateRenderingImages()
                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 _memorySystem,
-                _deviceSupport);
+                _deviceSupport,
+                (VkImageCreateFlagBits)0,
+                1,
+                MemorySystem::ResourceTag::Attachment);
 
 	_colorImageView = ImageHelper::CreateImageView(
 		_device,
@@ -304,7 +309,10 @@ void Swapchain::CreateRenderingImages()
                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 _memorySystem,
-                _deviceSupport);
+                _deviceSupport,
+                (VkImageCreateFlagBits)0,
+                1,
+                MemorySystem::ResourceTag::Attachment);
 
 	_depthImageView = ImageHelper::CreateImageView(
 		_device,
@@ -340,7 +348,7 @@ void Swapchain::CreateRenderingImages()
 		VK_FORMAT_FEATURE_TRANSFER_DST_BIT |
 		VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 
-	Logger::Verbose() << "Shadow image format: " << _shadowFormat;
+	LOG_VERBOSE << "Shadow image format: " << _shadowFormat;
 
 	for (uint32_t i = 0; i < _maxLightCount; ++i) {
 		_shadowMapImages[i] = ImageHelper::CreateImage(
@@ -357,7 +365,8 @@ void Swapchain::CreateRenderingImages()
 			_memorySystem,
 			_deviceSupport,
 			VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
-			layerCount);
+			layerCount,
+			MemorySystem::ResourceTag::Shadow);
 
 		_shadowMapCubeImageViews[i] = ImageHelper::CreateImageView(
 			_device,
@@ -443,7 +452,10 @@ void Swapchain::CreateHDRResources()
 			VK_IMAGE_USAGE_SAMPLED_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			_memorySystem,
-			_deviceSupport);
+			_deviceSupport,
+			(VkImageCreateFlagBits)0,
+			1,
+			MemorySystem::ResourceTag::Hdr);
 
 		_hdrImageViews[i] = ImageHelper::CreateImageView(
 			_device,
@@ -469,7 +481,9 @@ void Swapchain::CreateHDRResources()
 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		_memorySystem,
-		_deviceSupport);
+		_deviceSupport,
+		0,
+		MemorySystem::ResourceTag::Hdr);
 
 	VkDescriptorSetLayoutBinding hdrSamplerLayoutBinding{};
 	hdrSamplerLayoutBinding.binding = 0;
@@ -972,15 +986,10 @@ void Swapchain::CreateLightBuffers()
 			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			_memorySystem,
 			_deviceSupport,
-			i + 1);
+			i + 1,
+			MemorySystem::ResourceTag::Uniform);
 
-		vkMapMemory(
-			_device,
-			_lightBuffers[i].Allocation.Memory,
-			0,
-			bufferSize,
-			0,
-			&_lightBufferMappings[i]);
+		_lightBufferMappings[i] = _lightBuffers[i].Allocation.Mapped;
 	}
 
 	for (size_t i = 0; i < _images.size(); ++i) {
@@ -1051,8 +1060,6 @@ void Swapchain::DestroyLightBuffers()
 		nullptr);
 
 	for (size_t i = 0; i < _images.size(); ++i) {
-		vkUnmapMemory(_device, _lightBuffers[i].Allocation.Memory);
-
 		BufferHelper::DestroyBuffer(
 			_device,
 			_lightBuffers[i],
@@ -1065,6 +1072,8 @@ void Swapchain::RecordCommandBuffer(
 	VkCommandBuffer commandBuffer,
 	uint32_t imageIndex)
 {
+	PROFILE_ZONE("Swapchain::RecordCommandBuffer");
+
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = 0; // Optional
@@ -1127,7 +1136,7 @@ void Swapchain::RecordCommandBuffer(
 			sizeof(Skybox::ShaderData),
 			&shaderData);
 
-		auto& tex = _scene->Textures->GetTexture(
+		auto tex = _scene->Textures->GetTexture(
 			_scene->skybox.Descriptor.Textures[0]);
 
 		vkCmdBindDescriptorSets(
@@ -1141,6 +1150,8 @@ void Swapchain::RecordCommandBuffer(
 			nullptr);
 
 		vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+		METRIC_COUNTER_ADD("render.draw_calls", 1);
+		METRIC_COUNTER_ADD("render.triangles", 2);
 	}
 
 	vkCmdEndRenderPass(commandBuffer);
@@ -1275,6 +1286,10 @@ void Swapchain::RecordCommandBuffer(
 		vkCmdSetViewport(commandBuffer, 5, 1, &shadowViewport);
 		vkCmdSetScissor(commandBuffer, 5, 1, &shadowScissor);
 
+		// Most scenes fit one chunk, bound once per pass.
+		uint32_t boundChunk = UINT32_MAX;
+		uint32_t boundInstances = UINT32_MAX;
+
 		for (auto& model : _scene->Models) {
 			if (!model.first->IsDrawEnabled()) {
 				continue;
@@ -1287,24 +1302,11 @@ void Swapchain::RecordCommandBuffer(
 			mvp.Model = model.first->GetModelMatrix();
 			mvp.InnerModel = model.first->GetModelInnerMatrix();
 
-			VkBuffer vertexBuffers[] = {
-				model.second.VertexBuffer.Buffer,
-				model.second.InstanceBuffer.Buffer
-			};
-
-			VkDeviceSize offsets[] = {0, 0};
-			vkCmdBindVertexBuffers(
+			uint32_t firstInstance = BindGeometry(
 				commandBuffer,
-				0,
-				2,
-				vertexBuffers,
-				offsets);
-
-			vkCmdBindIndexBuffer(
-				commandBuffer,
-				model.second.IndexBuffer.Buffer,
-				0,
-				VK_INDEX_TYPE_UINT32);
+				model.second,
+				boundChunk,
+				boundInstances);
 
 			vkCmdPushConstants(
 				commandBuffer,
@@ -1340,9 +1342,15 @@ void Swapchain::RecordCommandBuffer(
 				commandBuffer,
 				model.second.IndexCount,
 				model.second.InstanceCount,
-				0,
-				0,
-				0);
+				model.second.Geometry.FirstIndex,
+				model.second.Geometry.VertexOffset,
+				firstInstance);
+
+			METRIC_COUNTER_ADD("render.draw_calls", 1);
+			METRIC_COUNTER_ADD(
+				"render.triangles",
+				model.second.IndexCount / 3 *
+					model.second.InstanceCount);
 		}
 
 		vkCmdEndRenderPass(commandBuffer);
@@ -1354,6 +1362,9 @@ void Swapchain::RecordCommandBuffer(
 	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
+	uint32_t boundChunk = UINT32_MAX;
+	uint32_t boundInstances = UINT32_MAX;
+
 	for (auto& model : _scene->Models) {
 		if (!model.first->IsDrawEnabled()) {
 			continue;
@@ -1362,24 +1373,11 @@ void Swapchain::RecordCommandBuffer(
 		mvp.Model = model.first->GetModelMatrix();
 		mvp.InnerModel = model.first->GetModelInnerMatrix();
 
-		VkBuffer vertexBuffers[] = {
-			model.second.VertexBuffer.Buffer,
-			model.second.InstanceBuffer.Buffer
-		};
-
-		VkDeviceSize offsets[] = {0, 0};
-		vkCmdBindVertexBuffers(
-			commandBuffer,
-			0,
-			2,
-			vertexBuffers,
-			offsets);
-
-		vkCmdBindIndexBuffer(
+		uint32_t firstInstance = BindGeometry(
 			commandBuffer,
-			model.second.IndexBuffer.Buffer,
-			0,
-			VK_INDEX_TYPE_UINT32);
+			model.second,
+			boundChunk,
+			boundInstances);
 
 		vkCmdPushConstants(
 			commandBuffer,
@@ -1420,10 +1418,10 @@ void Swapchain::RecordCommandBuffer(
 				&lightMultiplier);
 		}
 
-		auto& texDiff = _scene->Textures->GetTexture(
+		auto texDiff = _scene->Textures->GetTexture(
 			model.second.Textures[0]);
 
-		auto& texSpec = model.second.Textures.size() > 1 ?
+		auto texSpec = model.second.Textures.size() > 1 ?
 			_scene->Textures->GetTexture(model.second.Textures[1]) :
 			texDiff;
 
@@ -1447,9 +1445,15 @@ void Swapchain::RecordCommandBuffer(
 			commandBuffer,
 			model.second.IndexCount,
 			model.second.InstanceCount,
-			0,
-			0,
-			0);
+			model.second.Geometry.FirstIndex,
+			model.second.Geometry.VertexOffset,
+			firstInstance);
+
+		METRIC_COUNTER_ADD("render.draw_calls", 1);
+		METRIC_COUNTER_ADD(
+			"render.triangles",
+			model.second.IndexCount / 3 *
+				model.second.InstanceCount);
 	}
 
 	vkCmdEndRenderPass(commandBuffer);
@@ -1489,7 +1493,7 @@ void Swapchain::RecordCommandBuffer(
 			sizeof(glm::vec4) * 2,
 			rectData.data());
 
-		auto& tex = _scene->Textures->GetTexture(
+		auto tex = _scene->Textures->GetTexture(
 			rectangle.second.Textures[0]);
 
 		vkCmdBindDescriptorSets(
@@ -1503,6 +1507,8 @@ void Swapchain::RecordCommandBuffer(
 			nullptr);
 
 		vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+		METRIC_COUNTER_ADD("render.draw_calls", 1);
+		METRIC_COUNTER_ADD("render.triangles", 2);
 	}
 
 	vkCmdEndRenderPass(commandBuffer);
@@ -1548,6 +1554,8 @@ void Swapchain::RecordCommandBuffer(
 		nullptr);
 
 	vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+	METRIC_COUNTER_ADD("render.draw_calls", 1);
+	METRIC_COUNTER_ADD("render.triangles", 2);
 
 	vkCmdEndRenderPass(commandBuffer);
 
@@ -1559,8 +1567,89 @@ void Swapchain::RecordCommandBuffer(
 	}
 }
 
+void Swapchain::UpdateDynamicInstances()
+{
+	PROFILE_ZONE("Swapchain::UpdateDynamicInstances");
+
+	InstanceStream* stream = _scene->DynamicInstances;
+
+	for (auto& model : _scene->Models) {
+		ModelDescriptor& descriptor = model.second;
+		auto& instances = model.first->GetModelInstances();
+
+		uint32_t first;
+		uint32_t end;
+
+		if (model.first->_TakeInstanceChanges(first, end)) {
+			uint32_t count = instances.size();
+
+			// Grown models get headroom so they do not move on
+			// every added instance.
+			if (!descriptor.DynamicInstances ||
+				count > descriptor.Instances.Capacity)
+			{
+				if (descriptor.DynamicInstances) {
+					stream->Free(descriptor.Instances);
+				}
+
+				descriptor.Instances =
+					stream->Add(count + count / 2);
+				descriptor.DynamicInstances = true;
+			} else {
+				stream->MarkDirty(
+					descriptor.Instances,
+					first,
+					end);
+			}
+
+			descriptor.InstanceCount = count;
+		}
+
+		if (descriptor.DynamicInstances) {
+			stream->Write(
+				descriptor.Instances,
+				_currentFrame,
+				instances.data(),
+				descriptor.InstanceCount);
+		}
+	}
+}
+
+// Static instances come with the geometry chunk, dynamic ones replace
+// binding 1 with the stream.
+uint32_t Swapchain::BindGeometry(
+	VkCommandBuffer commandBuffer,
+	const ModelDescriptor& model,
+	uint32_t& boundChunk,
+	uint32_t& boundInstances)
+{
+	uint32_t chunk = model.Geometry.Chunk;
+
+	if (chunk != boundChunk ||
+		(!model.DynamicInstances && boundInstances != UINT32_MAX))
+	{
+		_scene->Geometry->Bind(commandBuffer, chunk);
+		boundChunk = chunk;
+		boundInstances = UINT32_MAX;
+	}
+
+	if (!model.DynamicInstances) {
+		return model.Geometry.FirstInstance;
+	}
+
+	if (model.Instances.Chunk != boundInstances) {
+		_scene->DynamicInstances->Bind(
+			commandBuffer,
+			_currentFrame,
+			model.Instances.Chunk);
+		boundInstances = model.Instances.Chunk;
+	}
+
+	return model.Instances.FirstInstance;
+}
+
 void Swapchain::MainLoop() {
-	Logger::Verbose() << "Video main loop called.";
+	LOG_VERBOSE << "Video main loop called.";
 
 	_work = true;
 
@@ -1568,17 +1657,31 @@ void Swapchain::MainLoop() {
 	auto refTime = std::chrono::high_resolution_clock::now();
 
 	while (!glfwWindowShouldClose(_window) && _work) {
+		auto frameStart = std::chrono::high_resolution_clock::now();
+
 		glfwPollEvents();
 		DrawFrame();
 
+		if (_scene->FrameCallback) {
+			_scene->FrameCallback();
+		}
+
+		_scene->MemoryDefragmenter->Update();
+		_memorySystem->Update();
+
 		++frameCount;
 		auto currTime = std::chrono::high_resolution_clock::now();
+
+		METRIC_HISTOGRAM_RECORD(
+			"render.frame_us",
+			std::chrono::duration_cast<std::chrono::microseconds>(
+				currTime - frameStart).count());
 		uint32_t dur = std::chrono::duration_cast
 			<std::chrono::milliseconds>(currTime - refTime).count();
 
 		if (dur >= 1000) {
 			refTime = currTime;
-			Logger::Verbose() << "FPS " << frameCount;
+			LOG_VERBOSE << "FPS " << frameCount;
 			frameCount = 0;
 		}
 	}
@@ -1593,6 +1696,9 @@ void Swapchain::Stop()
 
 void Swapchain::DrawFrame()
 {
+	PROFILE_ZONE("Swapchain::DrawFrame");
+	METRIC_COUNTER_ADD("render.frames", 1);
+
 	vkWaitForFences(
 		_device,
 		1,
@@ -1622,11 +1728,15 @@ void Swapchain::DrawFrame()
 	vkResetFences(_device, 1, &_inFlightFences[_currentFrame]);
 	vkResetCommandBuffer(_commandBuffers[_currentFrame], 0);
 
+	_scene->DynamicInstances->BeginFrame();
+	_scene->Textures->BeginFrame();
+
 	if (_scene->SceneMutex) {
 		_scene->SceneMutex->lock();
 	}
 
 	try {
+		UpdateDynamicInstances();
 		RecordCommandBuffer(_commandBuffers[_currentFrame], imageIndex);
 	}
 	catch(...)
@@ -16,6 +16,8 @@
 #include "SceneDescriptor.h"
 #include "LightDescriptor.h"
 
+#define MAX_FRAMES_IN_FLIGHT 2
+
 class Swapchain
 {
 public:
@@ -47,7 +49,7 @@ public:
 	}
 
 private:
-	const uint32_t _maxFramesInFlight = 2;
+	const uint32_t _maxFramesInFlight = MAX_FRAMES_IN_FLIGHT;
 
 	VkDevice _device;
 	VkExtent2D _extent;
@@ -131,6 +133,14 @@ private:
 	void RecordCommandBuffer(
 		VkCommandBuffer commandBuffer,
 		uint32_t imageIndex);
+	void UpdateDynamicInstances();
+	// Binds what the model is drawn from unless already bound and
+	// returns its first instance.
+	uint32_t BindGeometry(
+		VkCommandBuffer commandBuffer,
+		const ModelDescriptor& model,
+		uint32_t& boundChunk,
+		uint32_t& boundInstances);
 
 	bool _work;
 
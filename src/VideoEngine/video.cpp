@@ -3,8 +3,21 @@
 #include <vector>
 #include <set>
 #include <cstring>
+#include <cstddef>
 
 #include "../Logger/logger.h"
+#include "../Utils/Profiler.h"
+#include "../Utils/MeshCache.h"
+#include "../Utils/ImageTransform.h"
+
+// Cached meshes are laid out for direct upload.
+static_assert(sizeof(MeshCache::Vertex) == sizeof(ModelDescriptor::Vertex));
+static_assert(
+	offsetof(MeshCache::Vertex, Normal) ==
+	offsetof(ModelDescriptor::Vertex, Normal));
+static_assert(
+	offsetof(MeshCache::Vertex, TexCoord) ==
+	offsetof(ModelDescriptor::Vertex, TexCoord));
 
 Video::Video(
 	int width,
@@ -38,6 +51,25 @@ Video::Video(
 		&_deviceSupport,
 		_memorySystem,
 		_descriptorSetLayout,
+		_stagingRing,
+		MAX_FRAMES_IN_FLIGHT);
+	_scene.Geometry = new GeometryArena(
+		_device,
+		_memorySystem,
+		&_deviceSupport,
+		_stagingRing,
+		sizeof(ModelDescriptor::Vertex),
+		sizeof(glm::mat4));
+	_scene.DynamicInstances = new InstanceStream(
+		_device,
+		_memorySystem,
+		&_deviceSupport,
+		sizeof(glm::mat4),
+		MAX_FRAMES_IN_FLIGHT);
+	_scene.MemoryDefragmenter = new Defragmenter(
+		_device,
+		_memorySystem,
+		_scene.Textures,
 		_transferCommandPool,
 		_graphicsQueue);
 
@@ -51,6 +83,9 @@ Video::~Video()
 	RemoveAllModels();
 	DestroySkybox();
 
+	delete _scene.MemoryDefragmenter;
+	delete _scene.DynamicInstances;
+	delete _scene.Geometry;
 	delete _scene.Textures;
 	DestroyDescriptorSetLayout();
 	DestroyCommandPools();
@@ -113,19 +148,19 @@ void Video::SelectPhysicalDevice()
 			_msaaSamples = GetMaxSampleCount();
 
 			if (_msaaSamples == VK_SAMPLE_COUNT_64_BIT) {
-				Logger::Verbose() << "MSAA 64";
+				LOG_VERBOSE << "MSAA 64";
 			} else if (_msaaSamples == VK_SAMPLE_COUNT_32_BIT) {
-				Logger::Verbose() << "MSAA 32";
+				LOG_VERBOSE << "MSAA 32";
 			} else if (_msaaSamples == VK_SAMPLE_COUNT_16_BIT) {
-				Logger::Verbose() << "MSAA 16";
+				LOG_VERBOSE << "MSAA 16";
 			} else if (_msaaSamples == VK_SAMPLE_COUNT_8_BIT) {
-				Logger::Verbose() << "MSAA 8";
+				LOG_VERBOSE << "MSAA 8";
 			} else if (_msaaSamples == VK_SAMPLE_COUNT_4_BIT) {
-				Logger::Verbose() << "MSAA 4";
+				LOG_VERBOSE << "MSAA 4";
 			} else if (_msaaSamples == VK_SAMPLE_COUNT_2_BIT) {
-				Logger::Verbose() << "MSAA 2";
+				LOG_VERBOSE << "MSAA 2";
 			} else if (_msaaSamples == VK_SAMPLE_COUNT_1_BIT) {
-				Logger::Verbose() << "MSAA 1";
+				LOG_VERBOSE << "MSAA 1";
 			}
 
 			break;
@@ -147,8 +182,8 @@ bool Video::IsDeviceSuitable(VkPhysicalDevice device)
 	vkGetPhysicalDeviceProperties(device, &deviceProperties);
 	vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
-	Logger::Verbose() << deviceProperties.deviceName;
-	Logger::Verbose() << "Push constant size: " <<
+	LOG_VERBOSE << deviceProperties.deviceName;
+	LOG_VERBOSE << "Push constant size: " <<
 		deviceProperties.limits.maxPushConstantsSize;
 
 	bool extensionsSupported = CheckDeviceExtensionSupport(device);
@@ -170,6 +205,7 @@ bool Video::IsDeviceSuitable(VkPhysicalDevice device)
 		swapchainAdequate &&
 		deviceFeatures.geometryShader &&
 		deviceFeatures.samplerAnisotropy &&
+		deviceFeatures.textureCompressionBC &&
 		deviceFeatures.shaderUniformBufferArrayDynamicIndexing &&
 		_deviceSupport.FindQueueFamilies().graphicsFamily.has_value() &&
 		_deviceSupport.FindQueueFamilies().presentFamily.has_value();
@@ -213,6 +249,19 @@ VkSampleCountFlagBits Video::GetMaxSampleCount()
 }
 
 bool Video::CheckDeviceExtensionSupport(VkPhysicalDevice device)
+{
+	for (const char* requiredExtension : _deviceExtensions) {
+		if (!IsDeviceExtensionSupported(device, requiredExtension)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Video::IsDeviceExtensionSupported(
+	VkPhysicalDevice device,
+	const char* name)
 {
 	uint32_t extensionCount = 0;
 	vkEnumerateDeviceExtensionProperties(
@@ -228,26 +277,13 @@ bool Video::CheckDeviceExtensionSupport(VkPhysicalDevice device)
 		&extensionCount,
 		availableExtensions.data());
 
-	for (const char* requiredExtension : _deviceExtensions) {
-		bool extensionFound = false;
-
-		for (const auto& extension : availableExtensions) {
-			int cmp = strcmp(
-				requiredExtension,
-				extension.extensionName);
-
-			if (cmp == 0) {
-				extensionFound = true;
-				break;
-			}
-		}
-
-		if (!extensionFound) {
-			return false;
+	for (const auto& extension : availableExtensions) {
+		if (strcmp(name, extension.extensionName) == 0) {
+			return true;
 		}
 	}
 
-	return true;
+	return false;
 }
 
 void Video::CreateDevice()
@@ -264,6 +300,10 @@ void Video::CreateDevice()
 		indices.presentFamily.value()
 	};
 
+	if (indices.transferFamily) {
+		uniqueQueueFamilies.insert(indices.transferFamily.value());
+	}
+
 	float queuePriority = 1.0f;
 
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -277,9 +317,22 @@ void Video::CreateDevice()
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	// Driver side heap budgets, optional.
+	bool memoryBudget = VkInstanceHandler::IsExtensionEnabled(
+		VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) &&
+		IsDeviceExtensionSupported(
+			_physicalDevice,
+			VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+	if (memoryBudget) {
+		_deviceExtensions.push_back(
+			VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.sampleRateShading = VK_TRUE;
+	deviceFeatures.textureCompressionBC = VK_TRUE;
 
 	VkDeviceCreateInfo deviceInfo{};
 	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -314,7 +367,21 @@ void Video::CreateDevice()
 		0,
 		&_presentQueue);
 
-	_memorySystem = new MemorySystem(_device);
+	_uploadQueue = VK_NULL_HANDLE;
+
+	if (indices.transferFamily) {
+		vkGetDeviceQueue(
+			_device,
+			indices.transferFamily.value(),
+			0,
+			&_uploadQueue);
+	}
+
+	_memorySystem = new MemorySystem(
+		_device,
+		_physicalDevice,
+		_settingsValid ? _settings.MemoryLimits : nullptr,
+		memoryBudget);
 }
 
 void Video::DestroyDevice()
@@ -332,10 +399,30 @@ void Video::CreateCommandPools()
 		_device,
 		indices.graphicsFamily.value(),
 		VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+	_uploadCommandPool = nullptr;
+
+	if (indices.transferFamily) {
+		_uploadCommandPool = new CommandPool(
+			_device,
+			indices.transferFamily.value(),
+			VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	}
+
+	_stagingRing = new StagingRing(
+		_device,
+		_memorySystem,
+		&_deviceSupport,
+		_transferCommandPool,
+		_graphicsQueue,
+		_uploadCommandPool,
+		_uploadQueue);
 }
 
 void Video::DestroyCommandPools()
 {
+	delete _stagingRing;
+	delete _uploadCommandPool;
 	delete _transferCommandPool;
 }
 
@@ -432,89 +519,63 @@ void Video::RemoveAllModels()
 
 ModelDescriptor Video::CreateModelDescriptor(Model* model)
 {
+	PROFILE_ZONE("Video::CreateModelDescriptor");
+
 	ModelDescriptor descriptor;
 
-	// Vertex buffer creation.
-	auto& vertices = model->GetModelVertices();
-	auto& texCoords = model->GetModelTexCoords();
-	auto& normals = model->GetModelNormals();
+	auto& mesh = model->GetModelMesh();
+	auto& instances = model->GetModelInstances();
 
-	std::vector<ModelDescriptor::Vertex> vertexData(vertices.size());
+	if (mesh) {
+		// Uploaded from the mapping, laid out as Vertex already.
+		descriptor.Geometry = _scene.Geometry->Add(
+			mesh->GetVertices(),
+			mesh->GetVertexCount(),
+			mesh->GetIndices(),
+			mesh->GetIndexCount(),
+			instances.data(),
+			instances.size());
+
+		descriptor.VertexCount = mesh->GetVertexCount();
+		descriptor.IndexCount = mesh->GetIndexCount();
+	} else {
+		auto& vertices = model->GetModelVertices();
+		auto& texCoords = model->GetModelTexCoords();
+		auto& normals = model->GetModelNormals();
+		auto& indices = model->GetModelIndices();
+
+		std::vector<ModelDescriptor::Vertex> vertexData(
+			vertices.size());
+
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			vertexData[i].Pos = vertices[i];
+			vertexData[i].TexCoord = texCoords[i];
+			vertexData[i].Normal = normals[i];
+		}
 
-	descriptor.VertexBuffer = BufferHelper::CreateBuffer(
-		_device,
-		sizeof(ModelDescriptor::Vertex) * vertices.size(),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		_memorySystem,
-		&_deviceSupport);
+		descriptor.Geometry = _scene.Geometry->Add(
+			vertexData.data(),
+			vertexData.size(),
+			indices.data(),
+			indices.size(),
+			instances.data(),
+			instances.size());
 
-	for (size_t i = 0; i < vertices.size(); ++i) {
-		vertexData[i].Pos = vertices[i];
-		vertexData[i].TexCoord = texCoords[i];
-		vertexData[i].Normal = normals[i];
+		descriptor.VertexCount = vertices.size();
+		descriptor.IndexCount = indices.size();
 	}
 
-	BufferHelper::LoadDataToBuffer(
-		_device,
-		descriptor.VertexBuffer,
-		vertexData.data(),
-		vertexData.size() * sizeof(ModelDescriptor::Vertex),
-		_memorySystem,
-		&_deviceSupport,
-		_transferCommandPool,
-		_graphicsQueue);
-
-	descriptor.VertexCount = vertices.size();
-
-	// Index buffer creation.
-	auto& indices = model->GetModelIndices();
-
-	descriptor.IndexBuffer = BufferHelper::CreateBuffer(
-		_device,
-		sizeof(uint32_t) * indices.size(),
-		VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		_memorySystem,
-		&_deviceSupport);
-
-	BufferHelper::LoadDataToBuffer(
-		_device,
-		descriptor.IndexBuffer,
-		indices.data(),
-		indices.size() * sizeof(uint32_t),
-		_memorySystem,
-		&_deviceSupport,
-		_transferCommandPool,
-		_graphicsQueue);
-
-	descriptor.IndexCount = indices.size();
-
-	// Instance buffer.
-	auto& instances = model->GetModelInstances();
-
-	descriptor.InstanceBuffer = BufferHelper::CreateBuffer(
-		_device,
-		sizeof(glm::mat4) * instances.size(),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		_memorySystem,
-		&_deviceSupport);
+	descriptor.InstanceCount = instances.size();
+	descriptor.DynamicInstances = false;
 
-	BufferHelper::LoadDataToBuffer(
-		_device,
-		descriptor.InstanceBuffer,
-		instances.data(),
-		instances.size() * sizeof(glm::mat4),
-		_memorySystem,
-		&_deviceSupport,
-		_transferCommandPool,
-		_graphicsQueue);
+	// Uploaded with the geometry, later changes are streamed.
+	uint32_t first;
+	uint32_t end;
+	model->_TakeInstanceChanges(first, end);
 
-	descriptor.InstanceCount = instances.size();
+	// The copies go out in one batch, the model can be drawn right
+	// away since later frames are submitted after it.
+	_stagingRing->Submit();
 
 	// Texture image.
 	descriptor.Textures = model->GetTextures();
@@ -524,20 +585,11 @@ ModelDescriptor Video::CreateModelDescriptor(Model* model)
 
 void Video::DestroyModelDescriptor(ModelDescriptor descriptor)
 {
-	BufferHelper::DestroyBuffer(
-		_device,
-		descriptor.VertexBuffer,
-		_memorySystem);
-
-	BufferHelper::DestroyBuffer(
-		_device,
-		descriptor.IndexBuffer,
-		_memorySystem);
+	_scene.Geometry->Free(descriptor.Geometry);
 
-	BufferHelper::DestroyBuffer(
-		_device,
-		descriptor.InstanceBuffer,
-		_memorySystem);
+	if (descriptor.DynamicInstances) {
+		_scene.DynamicInstances->Free(descriptor.Instances);
+	}
 }
 
 void Video::RegisterRectangle(Rectangle* rectangle)
@@ -617,87 +669,31 @@ void Video::CreateSkybox(
 	uint32_t texHeight,
 	const std::vector<uint8_t>& texData)
 {
-	DestroySkybox();
-
-	uint32_t layerCount = 6;
-
-	// Texture layout transformation.
-	texWidth /= layerCount;
-	std::vector<uint8_t> texDataTransformed(texData.size(), 100);
-
-	for (uint32_t layer = 0; layer < layerCount; ++layer) {
-		for (uint32_t y = 0; y < texHeight; ++y) {
-			for (uint32_t x = 0; x < texWidth; ++x) {
-				for (uint32_t c = 0; c < 4; ++c) {
-					texDataTransformed[
-						(texWidth * texHeight * layer +
-						texWidth * y +
-						x) * 4 + c] =
-					texData[(texWidth * layer +
-						x +
-						texWidth * layerCount * y) *
-						4 + c];
-				}
-			}
-		}
-	}
-
-	// 1.
-	ImageHelper::RotateClockWise(
-		texDataTransformed.data(),
+	TextureContainer::Texture cube;
+	cube.Format = TextureContainer::TextureFormat::RGBA8_SRGB;
+	cube.Width = texWidth / 6;
+	cube.Height = texHeight;
+	cube.LayerCount = 6;
+	cube.MipLevels = 1;
+	cube.Cube = true;
+	cube.Data = ImageTransform::SkyboxToCube(
 		texWidth,
-		texHeight);
-	ImageHelper::FlipHorizontally(
-		texDataTransformed.data(),
-		texHeight,
-		texWidth);
-
-	// 2.
-	ImageHelper::FlipHorizontally(
-		texDataTransformed.data() + texWidth * texHeight * 4,
 		texHeight,
-		texWidth);
+		texData.data(),
+		texData.size());
 
-	// 3.
-	ImageHelper::RotateCounterClockWise(
-		texDataTransformed.data() + texWidth * texHeight * 4 * 2,
-		texWidth,
-		texHeight);
-	ImageHelper::FlipHorizontally(
-		texDataTransformed.data() + texWidth * texHeight * 4 * 2,
-		texHeight,
-		texWidth);
+	CreateSkybox(cube);
+}
 
-	// 4.
-	ImageHelper::FlipVertically(
-		texDataTransformed.data() + texWidth * texHeight * 4 * 3,
-		texHeight,
-		texWidth);
+void Video::CreateSkybox(const TextureContainer::Texture& cube)
+{
+	if (!cube.Cube || cube.LayerCount != 6) {
+		throw std::runtime_error("Skybox needs a six layer cube map.");
+	}
 
-	// Ordering.
-	ImageHelper::Swap(
-		texDataTransformed.data() + texWidth * texHeight * 4 * 2,
-		texDataTransformed.data() + texWidth * texHeight * 4,
-		texWidth,
-		texHeight);
-	ImageHelper::Swap(
-		texDataTransformed.data() + texWidth * texHeight * 4 * 3,
-		texDataTransformed.data() + texWidth * texHeight * 4 * 2,
-		texWidth,
-		texHeight);
-	ImageHelper::Swap(
-		texDataTransformed.data() + texWidth * texHeight * 4 * 4,
-		texDataTransformed.data() + texWidth * texHeight * 4 * 5,
-		texWidth,
-		texHeight);
+	DestroySkybox();
 
-	uint32_t skyboxTexture = _scene.Textures->AddTexture(
-		texWidth,
-		texHeight,
-		texDataTransformed,
-		TextureHandler::TextureType::TCube,
-		VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
-		layerCount);
+	uint32_t skyboxTexture = _scene.Textures->AddTexture(cube);
 	_scene.skybox.Descriptor.Textures = {skyboxTexture};
 
 	_scene.skybox._SetDrawReady(true);
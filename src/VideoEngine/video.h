@@ -13,8 +13,10 @@
 #include "MemorySystem.h"
 #include "ModelDescriptor.h"
 #include "BufferHelper.h"
+#include "StagingRing.h"
 #include "InputControl.h"
 #include "SceneDescriptor.h"
+#include "../Utils/TextureContainer.h"
 
 class Video
 {
@@ -22,6 +24,8 @@ public:
 	struct GraphicsSettings
 	{
 		uint32_t MsaaLimit;
+		// Null keeps the default size class limits.
+		const MemorySystem::Limits* MemoryLimits;
 	};
 
 	Video(
@@ -78,10 +82,14 @@ public:
 		return _inputControl;
 	}
 
+	// texData is a horizontal strip of the six faces.
 	void CreateSkybox(
 		uint32_t texWidth,
 		uint32_t texHeight,
 		const std::vector<uint8_t>& texData);
+	// Faces already in cube layout, see Loader::LoadSkybox. The
+	// cube may carry mips and be block compressed, as assetcook writes.
+	void CreateSkybox(const TextureContainer::Texture& cube);
 	void DestroySkybox();
 	void SetSkyboxColor(glm::vec3 color)
 	{
@@ -93,6 +101,13 @@ public:
 		_scene.SceneMutex = mutex;
 	}
 
+	// Called on the render thread after every frame, the place for
+	// work that has to touch GPU resources while the scene is drawn.
+	void SetFrameCallback(std::function<void()> callback)
+	{
+		_scene.FrameCallback = callback;
+	}
+
 	float GetScreenRatio()
 	{
 		return _swapchain->GetScreenRatio();
@@ -103,6 +118,12 @@ public:
 		return _scene.Textures;
 	}
 
+	// Memory accounting, heap budgets and eviction callbacks.
+	MemorySystem* GetMemorySystem()
+	{
+		return _memorySystem;
+	}
+
 private:
 	Window _window;
 
@@ -120,16 +141,23 @@ private:
 	bool IsDeviceSuitable(VkPhysicalDevice device);
 	VkSampleCountFlagBits GetMaxSampleCount();
 	bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+	bool IsDeviceExtensionSupported(
+		VkPhysicalDevice device,
+		const char* name);
 	PhysicalDeviceSupport _deviceSupport;
 
 	VkDevice _device;
 	VkQueue _graphicsQueue;
 	VkQueue _presentQueue;
+	// Null without a transfer only queue family.
+	VkQueue _uploadQueue;
 	MemorySystem* _memorySystem;
 	void CreateDevice();
 	void DestroyDevice();
 
 	CommandPool* _transferCommandPool;
+	CommandPool* _uploadCommandPool;
+	StagingRing* _stagingRing;
 	void CreateCommandPools();
 	void DestroyCommandPools();
 